@@ -0,0 +1,207 @@
+/**
+ * @file arena.c
+ * @brief Block allocator with a free list per size class
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/**
+ * @brief Creates an arena with no block
+ * @return Pointer to the newly created arena
+ */
+Arena* criar_arena(void) {
+    Arena* arena = (Arena*)calloc(1, sizeof(Arena));
+
+    if (!arena) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    return arena;
+}
+
+#ifdef ARENA_MALLOC
+/**
+ * @brief Frees the arena; its objects were freed one by one
+ * @param arena Pointer to the arena, or NULL
+ */
+void free_arena(Arena* arena) {
+    free(arena);
+}
+
+/**
+ * @brief Allocates an object with malloc
+ * @param arena Pointer to the arena, unused
+ * @param tamanho Bytes of the object
+ * @return Pointer to the object
+ */
+void* arena_reservar(Arena* arena, size_t tamanho) {
+    void* objeto = malloc(tamanho);
+
+    (void)arena;
+    if (!objeto) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    return objeto;
+}
+
+/**
+ * @brief Frees an object with free
+ * @param objeto Object returned by arena_reservar
+ * @param tamanho Bytes it was allocated with, unused
+ */
+void arena_libertar(void* objeto, size_t tamanho) {
+    (void)tamanho;
+    free(objeto);
+}
+#else
+/**
+ * @brief Rounds a size up to a multiple of ARENA_ALINHAMENTO
+ * @param tamanho Bytes of an object
+ * @return Bytes it takes in the arena
+ */
+static size_t arredondar(size_t tamanho) {
+    if (tamanho == 0) tamanho = 1;
+    return (tamanho + ARENA_ALINHAMENTO - 1) &
+           ~(size_t)(ARENA_ALINHAMENTO - 1);
+}
+
+/**
+ * @brief Allocates a block and links it to the arena
+ * @param arena Pointer to the arena
+ * @param tamanho Bytes of the block, a multiple of ARENA_BLOCO
+ * @return Pointer to the block
+ */
+static BlocoArena* novo_bloco(Arena* arena, size_t tamanho) {
+    BlocoArena* bloco = (BlocoArena*)aligned_alloc(ARENA_BLOCO, tamanho);
+
+    if (!bloco) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    bloco->arena = arena;
+    bloco->tamanho = tamanho;
+    bloco->anterior = NULL;
+    bloco->seguinte = arena->blocos;
+    if (arena->blocos) {
+        arena->blocos->anterior = bloco;
+    }
+    arena->blocos = bloco;
+    arena->reservado += tamanho;
+
+    return bloco;
+}
+
+/**
+ * @brief Frees every block of an arena, and with them its objects
+ * @param arena Pointer to the arena, or NULL
+ */
+void free_arena(Arena* arena) {
+    BlocoArena* bloco;
+
+    if (!arena) return;
+
+    while ((bloco = arena->blocos) != NULL) {
+        arena->blocos = bloco->seguinte;
+        free(bloco);
+    }
+    free(arena);
+}
+
+/**
+ * @brief Allocates an object
+ *
+ * A freed object of the same size class is reused first; otherwise the
+ * object is carved from the current block, and a new block is started
+ * when it does not fit, leaving the rest of the old one unused.
+ *
+ * @param arena Pointer to the arena
+ * @param tamanho Bytes of the object
+ * @return Pointer to the object, aligned to ARENA_ALINHAMENTO
+ */
+void* arena_reservar(Arena* arena, size_t tamanho) {
+    size_t t = arredondar(tamanho);
+    size_t classe = t / ARENA_ALINHAMENTO - 1;
+    void* objeto;
+
+    if (t > ARENA_MAXIMO) {
+        size_t bloco = (sizeof(BlocoArena) + t + ARENA_BLOCO - 1) &
+                       ~(size_t)(ARENA_BLOCO - 1);
+
+        arena->em_uso += t;
+        return novo_bloco(arena, bloco) + 1;
+    }
+
+    if ((objeto = arena->livres[classe]) != NULL) {
+        arena->livres[classe] = *(void**)objeto;
+    } else {
+        if (!arena->proximo || arena->fim - arena->proximo < (ptrdiff_t)t) {
+            BlocoArena* bloco = novo_bloco(arena, ARENA_BLOCO);
+
+            arena->proximo = (char*)(bloco + 1);
+            arena->fim = (char*)bloco + ARENA_BLOCO;
+        }
+        objeto = arena->proximo;
+        arena->proximo += t;
+    }
+    arena->em_uso += t;
+
+    return objeto;
+}
+
+/**
+ * @brief Frees an object for its arena to hand out again
+ *
+ * An object larger than ARENA_MAXIMO frees its own block.
+ *
+ * @param objeto Object returned by arena_reservar
+ * @param tamanho Bytes it was allocated with
+ */
+void arena_libertar(void* objeto, size_t tamanho) {
+    size_t t = arredondar(tamanho);
+    BlocoArena* bloco = (BlocoArena*)((uintptr_t)objeto &
+                                      ~(uintptr_t)(ARENA_BLOCO - 1));
+    Arena* arena = bloco->arena;
+
+    arena->em_uso -= t;
+    if (t > ARENA_MAXIMO) {
+        if (bloco->anterior) {
+            bloco->anterior->seguinte = bloco->seguinte;
+        } else {
+            arena->blocos = bloco->seguinte;
+        }
+        if (bloco->seguinte) {
+            bloco->seguinte->anterior = bloco->anterior;
+        }
+        arena->reservado -= bloco->tamanho;
+        free(bloco);
+        return;
+    }
+
+    *(void**)objeto = arena->livres[t / ARENA_ALINHAMENTO - 1];
+    arena->livres[t / ARENA_ALINHAMENTO - 1] = objeto;
+}
+#endif
+
+/**
+ * @brief Copies a string into an arena
+ * @param arena Pointer to the arena
+ * @param texto String to copy
+ * @param len Its length, without the null byte
+ * @return The copy, freed with arena_libertar(copia, len + 1)
+ */
+char* arena_copiar(Arena* arena, const char* texto, size_t len) {
+    char* copia = (char*)arena_reservar(arena, len + 1);
+
+    memcpy(copia, texto, len);
+    copia[len] = '\0';
+    return copia;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file arena.h
+ * @brief Block allocator that frees everything it holds at once
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Built with -DARENA_MALLOC, as make debug does, every object is a
+ * malloc of its own and teardown frees them one by one, so a leak
+ * checker still sees each object that is never freed.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**< Bytes of each block, and their alignment (a power of two) */
+#define ARENA_BLOCO (1 << 18)
+
+/**< Sizes are rounded up to a multiple of this */
+#define ARENA_ALINHAMENTO 16
+
+/**< Largest object carved from the blocks; larger ones get their own */
+#define ARENA_MAXIMO 1024
+
+/**< Number of size classes, one free list each */
+#define ARENA_CLASSES (ARENA_MAXIMO / ARENA_ALINHAMENTO)
+
+#ifdef ARENA_MALLOC
+/**< 1 if teardown must free the objects one by one */
+#define ARENA_POR_OBJETO 1
+#else
+#define ARENA_POR_OBJETO 0
+#endif
+
+/**
+ * @brief Start of a block, followed by the objects carved from it
+ *
+ * Blocks are aligned to ARENA_BLOCO, so the block of an object in one
+ * is found by masking its address. An object larger than ARENA_MAXIMO
+ * comes right after the start of a block of its own.
+ */
+typedef struct BlocoArena {
+    struct Arena* arena;            /**< Arena the block belongs to */
+    struct BlocoArena* anterior;    /**< Previous block of the arena */
+    struct BlocoArena* seguinte;    /**< Next block of the arena */
+    size_t tamanho;                 /**< Bytes of the block */
+} BlocoArena;
+
+/**
+ * @brief Objects carved from large blocks, freed with them
+ *
+ * Freed objects are kept in a list per size class and handed out again
+ * before the current block is carved further. Only the thread that
+ * changes the system allocates and frees.
+ */
+typedef struct Arena {
+    void* livres[ARENA_CLASSES];    /**< Freed objects of each size */
+    char* proximo;                  /**< First byte not carved yet */
+    char* fim;                      /**< End of the current block */
+    BlocoArena* blocos;             /**< Every block, newest first */
+    size_t reservado;               /**< Bytes of every block */
+    size_t em_uso;                  /**< Bytes of the objects in use */
+} Arena;
+
+/**
+ * @brief Creates an arena with no block
+ * @return Pointer to the newly created arena
+ */
+Arena* criar_arena(void);
+
+/**
+ * @brief Frees every block of an arena, and with them its objects
+ * @param arena Pointer to the arena, or NULL
+ */
+void free_arena(Arena* arena);
+
+/**
+ * @brief Allocates an object
+ * @param arena Pointer to the arena
+ * @param tamanho Bytes of the object
+ * @return Pointer to the object, aligned to ARENA_ALINHAMENTO
+ */
+void* arena_reservar(Arena* arena, size_t tamanho);
+
+/**
+ * @brief Frees an object for its arena to hand out again
+ * @param objeto Object returned by arena_reservar
+ * @param tamanho Bytes it was allocated with
+ */
+void arena_libertar(void* objeto, size_t tamanho);
+
+/**
+ * @brief Copies a string into an arena
+ * @param arena Pointer to the arena
+ * @param texto String to copy
+ * @param len Its length, without the null byte
+ * @return The copy, freed with arena_libertar(copia, len + 1)
+ */
+char* arena_copiar(Arena* arena, const char* texto, size_t len);
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file bloom.c
+ * @brief Counting Bloom filter used to reject unknown users quickly
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bloom.h"
+#include "hash.h"
+
+/**
+ * @brief Computes the counter positions of a name
+ *
+ * Derives all positions from the two halves of one 64-bit hash
+ * (double hashing), so the name is only read once.
+ *
+ * @param nome User's name
+ * @param posicoes Output array of BLOOM_HASHES counter indexes
+ */
+static void calcular_posicoes(const char* nome,
+                              unsigned int posicoes[BLOOM_HASHES]) {
+    unsigned long long hash = hash_texto(nome);
+    unsigned int h1, h2;
+    int i;
+
+    h1 = (unsigned int)hash;
+    h2 = (unsigned int)(hash >> 32) | 1;
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        posicoes[i] = (h1 + i * h2) & (BLOOM_CONTADORES - 1);
+    }
+}
+
+/**
+ * @brief Creates an empty filter
+ * @return Pointer to the newly created filter
+ */
+FiltroBloom* criar_filtro_bloom(void) {
+    FiltroBloom* filtro = (FiltroBloom*)malloc(sizeof(FiltroBloom));
+
+    if (!filtro || !(filtro->contadores =
+                     (unsigned char*)calloc(BLOOM_CONTADORES, 1))) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    return filtro;
+}
+
+/**
+ * @brief Frees all memory allocated for the filter
+ * @param filtro Pointer to the filter
+ */
+void free_filtro_bloom(FiltroBloom* filtro) {
+    if (!filtro) return;
+
+    free(filtro->contadores);
+    free(filtro);
+}
+
+/**
+ * @brief Counts one more application for a user
+ *
+ * Counters stop at BLOOM_SATURADO, trading a permanent
+ * false positive for never losing track of a user.
+ *
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ */
+void bloom_adicionar(FiltroBloom* filtro, const char* nome) {
+    unsigned int posicoes[BLOOM_HASHES];
+    int i;
+
+    calcular_posicoes(nome, posicoes);
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        if (filtro->contadores[posicoes[i]] < BLOOM_SATURADO) {
+            filtro->contadores[posicoes[i]]++;
+        }
+    }
+}
+
+/**
+ * @brief Counts one application less for a user
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ */
+void bloom_remover(FiltroBloom* filtro, const char* nome) {
+    unsigned int posicoes[BLOOM_HASHES];
+    int i;
+
+    calcular_posicoes(nome, posicoes);
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        if (filtro->contadores[posicoes[i]] < BLOOM_SATURADO) {
+            filtro->contadores[posicoes[i]]--;
+        }
+    }
+}
+
+/**
+ * @brief Checks if a user may have applications
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ * @return 0 if the user certainly has none, 1 otherwise
+ */
+int bloom_pode_conter(FiltroBloom* filtro, const char* nome) {
+    unsigned int posicoes[BLOOM_HASHES];
+    int i;
+
+    calcular_posicoes(nome, posicoes);
+    for (i = 0; i < BLOOM_HASHES; i++) {
+        if (filtro->contadores[posicoes[i]] == 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file bloom.h
+ * @brief Counting Bloom filter over the names of vaccinated users
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef BLOOM_H
+#define BLOOM_H
+
+/**< Number of counters in the filter (a power of two) */
+#define BLOOM_CONTADORES (1u << 20)
+
+/**< Number of counters each name maps to */
+#define BLOOM_HASHES 4
+
+/**< Value at which a counter saturates and is no longer decremented */
+#define BLOOM_SATURADO 255
+
+/**
+ * @brief Counting Bloom filter with one byte per counter
+ *
+ * A name that was never added, or whose applications were all deleted,
+ * is reported as absent except for rare false positives; a name with
+ * applications is never reported as absent.
+ */
+typedef struct FiltroBloom {
+    unsigned char* contadores;    /**< BLOOM_CONTADORES counters */
+} FiltroBloom;
+
+/**
+ * @brief Creates an empty filter
+ * @return Pointer to the newly created filter
+ */
+FiltroBloom* criar_filtro_bloom(void);
+
+/**
+ * @brief Frees all memory allocated for the filter
+ * @param filtro Pointer to the filter
+ */
+void free_filtro_bloom(FiltroBloom* filtro);
+
+/**
+ * @brief Counts one more application for a user
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ */
+void bloom_adicionar(FiltroBloom* filtro, const char* nome);
+
+/**
+ * @brief Counts one application less for a user
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ */
+void bloom_remover(FiltroBloom* filtro, const char* nome);
+
+/**
+ * @brief Checks if a user may have applications
+ * @param filtro Pointer to the filter
+ * @param nome User's name
+ * @return 0 if the user certainly has none, 1 otherwise
+ */
+int bloom_pode_conter(FiltroBloom* filtro, const char* nome);
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file data.c
+ * @brief Table-driven validation, conversion and formatting of dates
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "data.h"
+
+/**< Days in a 400-year Gregorian cycle */
+#define DIAS_POR_ERA 146097
+
+/**< Day number of 01-03-0000 relative to 01-01-1970 */
+#define DESVIO_EPOCA 719468
+
+/** Days in each month, indexed by [leap year][month] */
+static const int dias_no_mes[2][13] = {
+    {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+    {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}
+};
+
+/** Day of the year each month starts on, counting from the 1st of March */
+static const int inicio_mes_marco[13] = {
+    0, 306, 337, 0, 31, 61, 92, 122, 153, 184, 214, 245, 275
+};
+
+/** Two-digit decimal representations of 0 to 99 */
+static const char digitos_pares[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+/**
+ * @brief Checks if a year is a leap year
+ * @param ano Year to check
+ * @return 1 if leap year, 0 otherwise
+ */
+static int eh_bissexto(int ano) {
+    return ano % 4 == 0 && (ano % 100 != 0 || ano % 400 == 0);
+}
+
+/**
+ * @brief Checks if day, month and year form an existing calendar date
+ * @param dia Day component
+ * @param mes Month component
+ * @param ano Year component
+ * @return 1 if valid, 0 otherwise
+ */
+int data_eh_valida(int dia, int mes, int ano) {
+    if (mes < 1 || mes > 12) return 0;
+    return dia >= 1 && dia <= dias_no_mes[eh_bissexto(ano)][mes];
+}
+
+/**
+ * @brief Converts a valid calendar date to its day number
+ *
+ * Years are counted from March so the leap day falls at the end of the
+ * year, which turns the conversion into a table lookup plus arithmetic.
+ *
+ * @param dia Day component
+ * @param mes Month component
+ * @param ano Year component
+ * @return Number of days since 01-01-1970
+ */
+Data data_criar(int dia, int mes, int ano) {
+    int era, ano_da_era, dia_da_era;
+
+    if (mes <= 2) ano--;
+    era = (ano >= 0 ? ano : ano - 399) / 400;
+    ano_da_era = ano - era * 400;
+    dia_da_era = ano_da_era * 365 + ano_da_era / 4 - ano_da_era / 100 +
+                 inicio_mes_marco[mes] + dia - 1;
+
+    return era * DIAS_POR_ERA + dia_da_era - DESVIO_EPOCA;
+}
+
+/**
+ * @brief Converts a day number back to calendar components
+ * @param data Day number
+ * @param dia Output for day
+ * @param mes Output for month
+ * @param ano Output for year
+ */
+void data_componentes(Data data, int* dia, int* mes, int* ano) {
+    int z = data + DESVIO_EPOCA;
+    int era = (z >= 0 ? z : z - DIAS_POR_ERA + 1) / DIAS_POR_ERA;
+    int dia_da_era = z - era * DIAS_POR_ERA;
+    int ano_da_era = (dia_da_era - dia_da_era / 1460 + dia_da_era / 36524 -
+                      dia_da_era / (DIAS_POR_ERA - 1)) / 365;
+    int dia_do_ano = dia_da_era -
+                     (365 * ano_da_era + ano_da_era / 4 - ano_da_era / 100);
+    int mes_marco = (5 * dia_do_ano + 2) / 153;
+
+    *dia = dia_do_ano - (153 * mes_marco + 2) / 5 + 1;
+    *mes = mes_marco < 10 ? mes_marco + 3 : mes_marco - 9;
+    *ano = ano_da_era + era * 400 + (*mes <= 2);
+}
+
+/**
+ * @brief Formats a date as DD-MM-YYYY
+ *
+ * Four-digit years, the common case, are written from a digit-pair table;
+ * any other year falls back to sprintf.
+ *
+ * @param data Day number
+ * @param buffer Output buffer with at least DATA_TEXTO_MAX bytes
+ * @return Number of characters written, excluding the null byte
+ */
+int data_formatar(Data data, char* buffer) {
+    int dia, mes, ano;
+
+    data_componentes(data, &dia, &mes, &ano);
+    if (ano < 1000 || ano > 9999) {
+        return sprintf(buffer, "%02d-%02d-%d", dia, mes, ano);
+    }
+
+    memcpy(buffer, &digitos_pares[dia * 2], 2);
+    buffer[2] = '-';
+    memcpy(buffer + 3, &digitos_pares[mes * 2], 2);
+    buffer[5] = '-';
+    memcpy(buffer + 6, &digitos_pares[(ano / 100) * 2], 2);
+    memcpy(buffer + 8, &digitos_pares[(ano % 100) * 2], 2);
+    buffer[10] = '\0';
+    return 10;
+}
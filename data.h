@@ -0,0 +1,54 @@
+/**
+ * @file data.h
+ * @brief Compact date type stored as a number of days since an epoch
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef DATA_H
+#define DATA_H
+
+/**< Buffer size large enough for any formatted date incl. null byte */
+#define DATA_TEXTO_MAX 32
+
+/**
+ * @brief Date represented as the number of days since 01-01-1970
+ *
+ * Ordering two dates is a single integer comparison.
+ */
+typedef int Data;
+
+/**
+ * @brief Checks if day, month and year form an existing calendar date
+ * @param dia Day component
+ * @param mes Month component
+ * @param ano Year component
+ * @return 1 if valid, 0 otherwise
+ */
+int data_eh_valida(int dia, int mes, int ano);
+
+/**
+ * @brief Converts a valid calendar date to its day number
+ * @param dia Day component
+ * @param mes Month component
+ * @param ano Year component
+ * @return Number of days since 01-01-1970
+ */
+Data data_criar(int dia, int mes, int ano);
+
+/**
+ * @brief Converts a day number back to calendar components
+ * @param data Day number
+ * @param dia Output for day
+ * @param mes Output for month
+ * @param ano Output for year
+ */
+void data_componentes(Data data, int* dia, int* mes, int* ano);
+
+/**
+ * @brief Formats a date as DD-MM-YYYY
+ * @param data Day number
+ * @param buffer Output buffer with at least DATA_TEXTO_MAX bytes
+ * @return Number of characters written, excluding the null byte
+ */
+int data_formatar(Data data, char* buffer);
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file dias.c
+ * @brief Applications partitioned by the day they were given
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "dias.h"
+
+/**
+ * @brief Creates an empty day index
+ * @return Pointer to the newly created index
+ */
+IndiceDias* criar_indice_dias(void) {
+    IndiceDias* indice = (IndiceDias*)malloc(sizeof(IndiceDias));
+
+    if (!indice || !(indice->dias =
+                     (Dia*)malloc(DIAS_INICIAIS * sizeof(Dia)))) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    indice->num_dias = 0;
+    indice->total = 0;
+    indice->capacidade = DIAS_INICIAIS;
+    return indice;
+}
+
+/**
+ * @brief Frees the day index
+ * 
+ * Records belong to the user list and are freed by free_users.
+ * 
+ * @param indice Pointer to the index
+ */
+void free_indice_dias(IndiceDias* indice) {
+    if (!indice) return;
+
+    free(indice->dias);
+    free(indice);
+}
+
+/**
+ * @brief Finds the first day of the index that is not before a date
+ * @param indice Pointer to the index
+ * @param data Date looked for
+ * @return Its position, or num_dias if every day is before it
+ */
+int dias_posicao(const IndiceDias* indice, Data data) {
+    int e = 0, d = indice->num_dias;
+
+    while (e < d) {
+        int m = e + (d - e) / 2;
+
+        if (indice->dias[m].data < data) {
+            e = m + 1;
+        } else {
+            d = m;
+        }
+    }
+    return e;
+}
+
+/**
+ * @brief Returns the day of an application already in the index
+ *
+ * Most lookups are for the current date, the last day, which is
+ * checked before searching.
+ *
+ * @param indice Pointer to the index
+ * @param data Day of the application
+ * @return The day
+ */
+static Dia* dia_de(IndiceDias* indice, Data data) {
+    Dia* ultimo = &indice->dias[indice->num_dias - 1];
+
+    if (ultimo->data == data) {
+        return ultimo;
+    }
+    return &indice->dias[dias_posicao(indice, data)];
+}
+
+/**
+ * @brief Adds a new application to the end of its day
+ *
+ * A day not yet in the index is appended after the last one; the
+ * array doubles when it is full.
+ *
+ * @param indice Pointer to the index
+ * @param registo Record of the application
+ */
+void dias_adicionar(IndiceDias* indice, User* registo) {
+    Data data = registo->data_aplicacao;
+    Dia* dia;
+
+    if (indice->num_dias == 0 ||
+        indice->dias[indice->num_dias - 1].data != data) {
+        if (indice->num_dias == indice->capacidade) {
+            Dia* novo;
+
+            if (indice->capacidade > INT_MAX / 2) {
+                printf("No memory\n");
+                exit(1);
+            }
+            novo = (Dia*)realloc(indice->dias, 2 * (size_t)indice->capacidade *
+                                 sizeof(Dia));
+            if (!novo) {
+                printf("No memory\n");
+                exit(1);
+            }
+            indice->dias = novo;
+            indice->capacidade *= 2;
+        }
+
+        dia = &indice->dias[indice->num_dias++];
+        dia->data = data;
+        dia->aplicacoes = 0;
+        dia->primeiro = NULL;
+        dia->ultimo = NULL;
+    } else {
+        dia = &indice->dias[indice->num_dias - 1];
+    }
+
+    registo->anterior_dia = dia->ultimo;
+    registo->proximo_dia = NULL;
+    if (dia->ultimo) {
+        dia->ultimo->proximo_dia = registo;
+    } else {
+        dia->primeiro = registo;
+    }
+    dia->ultimo = registo;
+    dia->aplicacoes++;
+    indice->total++;
+}
+
+/**
+ * @brief Removes an application from its day before it is freed
+ * @param indice Pointer to the index
+ * @param registo Record of the application
+ */
+void dias_remover(IndiceDias* indice, User* registo) {
+    Dia* dia = dia_de(indice, registo->data_aplicacao);
+
+    if (registo->anterior_dia) {
+        registo->anterior_dia->proximo_dia = registo->proximo_dia;
+    } else {
+        dia->primeiro = registo->proximo_dia;
+    }
+    if (registo->proximo_dia) {
+        registo->proximo_dia->anterior_dia = registo->anterior_dia;
+    } else {
+        dia->ultimo = registo->anterior_dia;
+    }
+    registo->anterior_dia = NULL;
+    registo->proximo_dia = NULL;
+    dia->aplicacoes--;
+    indice->total--;
+}
+
+
+/**
+ * @brief Counts one application less on a day whose records were sealed
+ * 
+ * The day's list no longer holds the records, only their count.
+ * 
+ * @param indice Pointer to the index
+ * @param data Day of the deleted application
+ */
+void dias_descontar(IndiceDias* indice, Data data) {
+    dia_de(indice, data)->aplicacoes--;
+    indice->total--;
+}
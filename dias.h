@@ -0,0 +1,82 @@
+/**
+ * @file dias.h
+ * @brief Applications partitioned by the day they were given
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef DIAS_H
+#define DIAS_H
+
+#include "data.h"
+#include "user.h"
+
+/**< Days reserved when the day index is created */
+#define DIAS_INICIAIS 64
+
+/**
+ * @brief Applications given on one day
+ */
+typedef struct Dia {
+    Data data;                  /**< The day */
+    int aplicacoes;             /**< Number of applications */
+    User* primeiro;             /**< Oldest application */
+    User* ultimo;               /**< Newest application */
+} Dia;
+
+/**
+ * @brief Applications of every day that has had any
+ *
+ * Applications are only ever given on the current date, which never
+ * goes back, so a new day is always appended after the last one and
+ * the days stay sorted. Days that never had an application take no
+ * room, however far apart the dates are; a day is found by binary
+ * search.
+ */
+typedef struct IndiceDias {
+    Dia* dias;                  /**< Days with applications, by date */
+    int num_dias;               /**< Number of days */
+    long total;                 /**< Applications of every day */
+    int capacidade;             /**< Allocated number of days */
+} IndiceDias;
+
+/**
+ * @brief Creates an empty day index
+ * @return Pointer to the newly created index
+ */
+IndiceDias* criar_indice_dias(void);
+
+/**
+ * @brief Frees the day index (the records are not freed)
+ * @param indice Pointer to the index
+ */
+void free_indice_dias(IndiceDias* indice);
+
+/**
+ * @brief Adds a new application to the end of its day
+ * @param indice Pointer to the index
+ * @param registo Record of the application
+ */
+void dias_adicionar(IndiceDias* indice, User* registo);
+
+/**
+ * @brief Removes an application from its day before it is freed
+ * @param indice Pointer to the index
+ * @param registo Record of the application
+ */
+void dias_remover(IndiceDias* indice, User* registo);
+
+/**
+ * @brief Counts one application less on a day whose records were sealed
+ * @param indice Pointer to the index
+ * @param data Day of the deleted application
+ */
+void dias_descontar(IndiceDias* indice, Data data);
+
+/**
+ * @brief Finds the first day of the index that is not before a date
+ * @param indice Pointer to the index
+ * @param data Date looked for
+ * @return Its position, or num_dias if every day is before it
+ */
+int dias_posicao(const IndiceDias* indice, Data data);
+
+#endif
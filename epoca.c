@@ -0,0 +1,156 @@
+/**
+ * @file epoca.c
+ * @brief Epoch-based reclamation of records that readers may still hold
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoca.h"
+
+/**
+ * @brief Creates the epochs with no reader pinned
+ * @return Pointer to the newly created epochs
+ */
+Epocas* criar_epocas(void) {
+    Epocas* epocas = (Epocas*)calloc(1, sizeof(Epocas));
+
+    if (!epocas) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    epocas->atual = 1;
+    return epocas;
+}
+
+/**
+ * @brief Frees every retired record and the epochs
+ * @param epocas Epochs with no reader pinned
+ */
+void free_epocas(Epocas* epocas) {
+    if (!epocas) return;
+
+    epoca_recolher(epocas);
+    free(epocas);
+}
+
+/**
+ * @brief Pins the current epoch for a reader
+ * 
+ * The epoch is read again after the slot is taken: if a collection
+ * advanced it in between, that collection may not have seen the slot,
+ * so the newer epoch is pinned instead.
+ * 
+ * @param epocas Pointer to the epochs
+ * @return Slot to unpin once the reader holds no record
+ */
+int epoca_entrar(Epocas* epocas) {
+    while (1) {
+        int i;
+
+        for (i = 0; i < EPOCA_LEITORES; i++) {
+            unsigned long livre = 0;
+            unsigned long epoca = __atomic_load_n(&epocas->atual,
+                                                  __ATOMIC_SEQ_CST);
+            unsigned long agora;
+
+            if (!__atomic_compare_exchange_n(&epocas->fixadas[i], &livre,
+                                             epoca, 0, __ATOMIC_SEQ_CST,
+                                             __ATOMIC_RELAXED)) {
+                continue;
+            }
+
+            while ((agora = __atomic_load_n(&epocas->atual,
+                                            __ATOMIC_SEQ_CST)) != epoca) {
+                __atomic_store_n(&epocas->fixadas[i], agora,
+                                 __ATOMIC_SEQ_CST);
+                epoca = agora;
+            }
+            return i;
+        }
+
+        /* Every slot is pinned: let a reader finish */
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Unpins a reader's epoch
+ * @param epocas Pointer to the epochs
+ * @param leitor Slot returned by epoca_entrar
+ */
+void epoca_sair(Epocas* epocas, int leitor) {
+    __atomic_store_n(&epocas->fixadas[leitor], 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Hands an unlinked record over to be freed later
+ * @param epocas Pointer to the epochs
+ * @param registo Record no structure points to anymore
+ * @param libertar Function that frees it
+ */
+void epoca_retirar(Epocas* epocas, void* registo, void (*libertar)(void*)) {
+    Retirado* retirado = (Retirado*)malloc(sizeof(Retirado));
+
+    if (!retirado) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    retirado->registo = registo;
+    retirado->libertar = libertar;
+    retirado->epoca = __atomic_load_n(&epocas->atual, __ATOMIC_RELAXED);
+    retirado->next = epocas->retirados;
+    epocas->retirados = retirado;
+    epocas->num_retirados++;
+}
+
+/**
+ * @brief Advances the epoch and frees what no reader can still reach
+ * 
+ * A record retired in epoch e is freed once every pinned epoch is
+ * above e; with no reader pinned, everything retired so far goes.
+ * 
+ * @param epocas Pointer to the epochs
+ * @return Number of records freed
+ */
+int epoca_recolher(Epocas* epocas) {
+    Retirado** ligacao = &epocas->retirados;
+    Retirado* resto;
+    unsigned long minima;
+    int i, libertados = 0;
+
+    if (!epocas->retirados) {
+        return 0;
+    }
+
+    minima = __atomic_add_fetch(&epocas->atual, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < EPOCA_LEITORES; i++) {
+        unsigned long fixada = __atomic_load_n(&epocas->fixadas[i],
+                                               __ATOMIC_SEQ_CST);
+        if (fixada != 0 && fixada < minima) {
+            minima = fixada;
+        }
+    }
+
+    /* Newest first, so what can go is the tail of the list */
+    while (*ligacao && (*ligacao)->epoca >= minima) {
+        ligacao = &(*ligacao)->next;
+    }
+    resto = *ligacao;
+    *ligacao = NULL;
+
+    while (resto) {
+        Retirado* retirado = resto;
+
+        resto = retirado->next;
+        retirado->libertar(retirado->registo);
+        free(retirado);
+        libertados++;
+    }
+
+    epocas->num_retirados -= libertados;
+    return libertados;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file epoca.h
+ * @brief Epoch-based reclamation of records that readers may still hold
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef EPOCA_H
+#define EPOCA_H
+
+/**< Number of readers that can be pinned at the same time */
+#define EPOCA_LEITORES 64
+
+/**
+ * @brief A record taken out of every structure, waiting to be freed
+ */
+typedef struct Retirado {
+    void* registo;                  /**< Record to free */
+    void (*libertar)(void*);        /**< Function that frees it */
+    unsigned long epoca;            /**< Epoch it was retired in */
+    struct Retirado* next;          /**< Next retired record, older */
+} Retirado;
+
+/**
+ * @brief Epochs pinned by readers and the records they keep alive
+ *
+ * A reader pins the current epoch in a free slot before it reaches any
+ * record, and unpins it once it holds none; neither step takes a lock.
+ * The writer unlinks a record before retiring it, tagged with the
+ * current epoch, and frees it once every pinned epoch is newer: a
+ * reader that pinned after the record was unlinked cannot reach it.
+ * Only the writer retires and collects.
+ */
+typedef struct Epocas {
+    unsigned long atual;            /**< Current epoch, from 1 */
+
+    /**< Epoch pinned in each slot, or 0 if the slot is free */
+    unsigned long fixadas[EPOCA_LEITORES];
+
+    Retirado* retirados;            /**< Records not yet freed, newest first */
+    int num_retirados;              /**< Number of records in retirados */
+} Epocas;
+
+/**
+ * @brief Creates the epochs with no reader pinned
+ * @return Pointer to the newly created epochs
+ */
+Epocas* criar_epocas(void);
+
+/**
+ * @brief Frees every retired record and the epochs
+ * @param epocas Epochs with no reader pinned
+ */
+void free_epocas(Epocas* epocas);
+
+/**
+ * @brief Pins the current epoch for a reader
+ *
+ * Waits for a slot if all EPOCA_LEITORES are pinned.
+ *
+ * @param epocas Pointer to the epochs
+ * @return Slot to unpin once the reader holds no record
+ */
+int epoca_entrar(Epocas* epocas);
+
+/**
+ * @brief Unpins a reader's epoch
+ * @param epocas Pointer to the epochs
+ * @param leitor Slot returned by epoca_entrar
+ */
+void epoca_sair(Epocas* epocas, int leitor);
+
+/**
+ * @brief Hands an unlinked record over to be freed later
+ * @param epocas Pointer to the epochs
+ * @param registo Record no structure points to anymore
+ * @param libertar Function that frees it
+ */
+void epoca_retirar(Epocas* epocas, void* registo, void (*libertar)(void*));
+
+/**
+ * @brief Advances the epoch and frees what no reader can still reach
+ * @param epocas Pointer to the epochs
+ * @return Number of records freed
+ */
+int epoca_recolher(Epocas* epocas);
+
+#endif
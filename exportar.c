@@ -0,0 +1,486 @@
+/**
+ * @file exportar.c
+ * @brief Streaming export of batches and applications to CSV or columns
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Both formats walk the batches in the expiry schedule and the
+ * applications in the sealed segments and then in the day index, so
+ * nothing is copied or sorted and memory use does not grow with the
+ * number of records. Files are written through large stdio buffers,
+ * and each column of a row group goes out in a single write.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "exportar.h"
+
+/**< Code of an application whose batch no longer exists */
+#define EXPORTAR_SEM_LOTE 0xFFFFFFFFu
+
+/**
+ * @brief Code of every batch, found by its id
+ *
+ * A batch's code is its position in the expiry schedule, which is also
+ * its row in the exported batches. There are at most MAX_LOTES batches,
+ * so the table has a fixed size.
+ */
+typedef struct DicionarioLotes {
+    LoteVacina* lotes[EXPORTAR_DICIONARIO];  /**< Open addressing slots */
+    uint32_t codigos[EXPORTAR_DICIONARIO];   /**< Code of each slot */
+} DicionarioLotes;
+
+/**
+ * @brief Applications buffered before being written as one row group
+ */
+typedef struct GrupoAplicacoes {
+    uint32_t linhas;                         /**< Buffered applications */
+    uint32_t comprimentos[EXPORTAR_GRUPO];   /**< Length of each name */
+    uint32_t vacinas[EXPORTAR_GRUPO];        /**< Vaccine codes */
+    uint32_t lotes[EXPORTAR_GRUPO];          /**< Batch codes */
+    int32_t datas[EXPORTAR_GRUPO];           /**< Application dates */
+    char* nomes;                             /**< Names, back to back */
+    size_t usados;                           /**< Bytes used in nomes */
+    size_t capacidade;                       /**< Bytes allocated */
+} GrupoAplicacoes;
+
+/**
+ * @brief Opens <prefixo><sufixo> for writing with a large buffer
+ * @param prefixo Path without its suffix
+ * @param sufixo Suffix of the file
+ * @param buffer Output for the stdio buffer, freed by fechar_ficheiro
+ * @return Open file, or NULL if it could not be created
+ */
+static FILE* abrir_ficheiro(const char* prefixo, const char* sufixo,
+                            char** buffer) {
+    size_t len = strlen(prefixo);
+    char* caminho = (char*)malloc(len + strlen(sufixo) + 1);
+    FILE* ficheiro;
+
+    *buffer = (char*)malloc(EXPORTAR_BUFFER);
+    if (!caminho || !*buffer) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    memcpy(caminho, prefixo, len);
+    strcpy(caminho + len, sufixo);
+    ficheiro = fopen(caminho, "wb");
+    free(caminho);
+
+    if (!ficheiro) {
+        free(*buffer);
+        return NULL;
+    }
+
+    setvbuf(ficheiro, *buffer, _IOFBF, EXPORTAR_BUFFER);
+    return ficheiro;
+}
+
+/**
+ * @brief Closes a file opened by abrir_ficheiro
+ * @param ficheiro File to close
+ * @param buffer Its stdio buffer
+ * @return 1 if every write succeeded, 0 otherwise
+ */
+static int fechar_ficheiro(FILE* ficheiro, char* buffer) {
+    int ok = !ferror(ficheiro);
+
+    ok = (fclose(ficheiro) == 0) && ok;
+    free(buffer);
+    return ok;
+}
+
+/**
+ * @brief Fills the batch dictionary from the expiry schedule
+ * @param dicionario Dictionary to fill
+ * @param indice Batch index
+ */
+static void dicionario_criar(DicionarioLotes* dicionario,
+                             const IndiceLotes* indice) {
+    int i;
+
+    memset(dicionario->lotes, 0, sizeof(dicionario->lotes));
+    for (i = 0; i < indice->num_lotes; i++) {
+        LoteVacina* lote = indice->calendario[i];
+        unsigned int slot = hash_texto(lote->lote) &
+                            (EXPORTAR_DICIONARIO - 1);
+
+        while (dicionario->lotes[slot]) {
+            slot = (slot + 1) & (EXPORTAR_DICIONARIO - 1);
+        }
+        dicionario->lotes[slot] = lote;
+        dicionario->codigos[slot] = (uint32_t)i;
+    }
+}
+
+/**
+ * @brief Finds a batch by its id
+ * @param dicionario Batch dictionary
+ * @param id Batch id
+ * @param codigo Output for the batch code
+ * @return The batch, or NULL if it no longer exists
+ */
+static LoteVacina* dicionario_procurar(const DicionarioLotes* dicionario,
+                                       const char* id, uint32_t* codigo) {
+    unsigned int slot = hash_texto(id) & (EXPORTAR_DICIONARIO - 1);
+
+    while (dicionario->lotes[slot]) {
+        if (strcmp(dicionario->lotes[slot]->lote, id) == 0) {
+            *codigo = dicionario->codigos[slot];
+            return dicionario->lotes[slot];
+        }
+        slot = (slot + 1) & (EXPORTAR_DICIONARIO - 1);
+    }
+
+    *codigo = EXPORTAR_SEM_LOTE;
+    return NULL;
+}
+
+/**
+ * @brief Writes one CSV field, quoted only if it needs to be
+ * @param ficheiro File to write to
+ * @param texto Value of the field
+ */
+static void escrever_campo(FILE* ficheiro, const char* texto) {
+    if (strpbrk(texto, ",\"\r\n") == NULL) {
+        fputs(texto, ficheiro);
+        return;
+    }
+
+    putc('"', ficheiro);
+    for (; *texto; texto++) {
+        if (*texto == '"') {
+            putc('"', ficheiro);
+        }
+        putc(*texto, ficheiro);
+    }
+    putc('"', ficheiro);
+}
+
+/**
+ * @brief Formats the date column that ends an application's CSV line
+ * @param data Date of the application
+ * @param texto_data Output buffer of DATA_TEXTO_MAX bytes
+ * @return Number of bytes written, without a terminator
+ */
+static int formatar_data_csv(Data data, char* texto_data) {
+    int len;
+
+    texto_data[0] = ',';
+    len = data_formatar(data, texto_data + 1) + 1;
+    texto_data[len++] = '\n';
+    return len;
+}
+
+/**
+ * @brief Writes one application as a CSV line
+ * @param ficheiro File to write to
+ * @param registo Application to write
+ * @param texto_data Date column from formatar_data_csv
+ * @param len Length of texto_data
+ */
+static void escrever_aplicacao_csv(FILE* ficheiro, const User* registo,
+                                   const char* texto_data, int len) {
+    escrever_campo(ficheiro, registo->nome);
+    putc(',', ficheiro);
+    escrever_campo(ficheiro, registo->nome_vacina);
+    putc(',', ficheiro);
+    escrever_campo(ficheiro, registo->lote_usado);
+    fwrite(texto_data, 1, len, ficheiro);
+}
+
+/**
+ * @brief Writes every batch and application as CSV
+ * @param sistema Pointer to the system
+ * @param prefixo Path of the files without their suffixes
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if a file could not be written
+ */
+int exportar_csv(Sistema* sistema, const char* prefixo,
+                 ResumoExportacao* resumo) {
+    IndiceLotes* indice = sistema->indice_lotes;
+    IndiceDias* dias = sistema->indice_dias;
+    char texto_data[DATA_TEXTO_MAX];
+    Data dia_formatado = INT_MIN;
+    CursorFrio cursor;
+    User* current;
+    char* buffer;
+    FILE* ficheiro;
+    int i, len = 0;
+
+    resumo->lotes = 0;
+    resumo->aplicacoes = 0;
+
+    ficheiro = abrir_ficheiro(prefixo, ".lotes.csv", &buffer);
+    if (!ficheiro) {
+        return 0;
+    }
+
+    fputs("vacina,lote,validade,doses_disponiveis,aplicacoes\n", ficheiro);
+    for (i = 0; i < indice->num_lotes; i++) {
+        LoteVacina* lote = indice->calendario[i];
+
+        data_formatar(lote->data_expiracao, texto_data);
+        escrever_campo(ficheiro, lote->nome);
+        putc(',', ficheiro);
+        escrever_campo(ficheiro, lote->lote);
+        fprintf(ficheiro, ",%s,%d,%d\n", texto_data,
+                lote->dosas_disponiveis, lote->total_aplicacoes);
+    }
+    resumo->lotes = indice->num_lotes;
+
+    if (!fechar_ficheiro(ficheiro, buffer)) {
+        return 0;
+    }
+
+    ficheiro = abrir_ficheiro(prefixo, ".aplicacoes.csv", &buffer);
+    if (!ficheiro) {
+        return 0;
+    }
+
+    fputs("utente,vacina,lote,data\n", ficheiro);
+
+    /* Sealed applications are older than any in memory */
+    cursor_frio_abrir(&cursor, sistema->frio, sistema->frio ?
+                      sistema->frio->num_segmentos : 0, INT_MIN, INT_MAX,
+                      sistema->versao);
+    while ((current = cursor_frio_proximo(&cursor)) != NULL) {
+        if (current->data_aplicacao != dia_formatado) {
+            dia_formatado = current->data_aplicacao;
+            len = formatar_data_csv(dia_formatado, texto_data);
+        }
+        escrever_aplicacao_csv(ficheiro, current, texto_data, len);
+        resumo->aplicacoes++;
+    }
+    cursor_frio_fechar(&cursor);
+
+    for (i = 0; i < dias->num_dias; i++) {
+        current = dias->dias[i].primeiro;
+
+        if (!current) {
+            continue;
+        }
+
+        /* Every application of the day shares the date */
+        len = formatar_data_csv(dias->dias[i].data, texto_data);
+
+        for (; current != NULL; current = current->proximo_dia) {
+            escrever_aplicacao_csv(ficheiro, current, texto_data, len);
+            resumo->aplicacoes++;
+        }
+    }
+
+    return fechar_ficheiro(ficheiro, buffer);
+}
+
+/**
+ * @brief Writes one unsigned 32-bit value
+ * @param ficheiro File to write to
+ * @param valor Value to write
+ */
+static void escrever_u32(FILE* ficheiro, uint32_t valor) {
+    fwrite(&valor, sizeof(valor), 1, ficheiro);
+}
+
+/**
+ * @brief Writes the buffered applications as one row group
+ * @param ficheiro File to write to
+ * @param grupo Buffered applications, emptied afterwards
+ */
+static void escrever_grupo(FILE* ficheiro, GrupoAplicacoes* grupo) {
+    uint32_t n = grupo->linhas;
+
+    escrever_u32(ficheiro, n);
+    fwrite(grupo->comprimentos, sizeof(uint32_t), n, ficheiro);
+    fwrite(grupo->nomes, 1, grupo->usados, ficheiro);
+    fwrite(grupo->vacinas, sizeof(uint32_t), n, ficheiro);
+    fwrite(grupo->lotes, sizeof(uint32_t), n, ficheiro);
+    fwrite(grupo->datas, sizeof(int32_t), n, ficheiro);
+
+    grupo->linhas = 0;
+    grupo->usados = 0;
+}
+
+/**
+ * @brief Buffers one application, writing the group first if it is full
+ * @param ficheiro File to write to
+ * @param grupo Buffered applications
+ * @param registo Application to add
+ * @param vacina Code of its vaccine
+ * @param lote Code of its batch
+ */
+static void adicionar_ao_grupo(FILE* ficheiro, GrupoAplicacoes* grupo,
+                               const User* registo, uint32_t vacina,
+                               uint32_t lote) {
+    size_t len = strlen(registo->nome);
+
+    if (grupo->linhas == EXPORTAR_GRUPO ||
+        grupo->usados + len > grupo->capacidade) {
+        if (grupo->linhas > 0) {
+            escrever_grupo(ficheiro, grupo);
+        }
+
+        /* Only a single name longer than the whole buffer grows it */
+        if (len > grupo->capacidade) {
+            char* novo = (char*)realloc(grupo->nomes, len);
+            if (!novo) {
+                printf("No memory\n");
+                exit(1);
+            }
+            grupo->nomes = novo;
+            grupo->capacidade = len;
+        }
+    }
+
+    memcpy(grupo->nomes + grupo->usados, registo->nome, len);
+    grupo->usados += len;
+    grupo->comprimentos[grupo->linhas] = (uint32_t)len;
+    grupo->vacinas[grupo->linhas] = vacina;
+    grupo->lotes[grupo->linhas] = lote;
+    grupo->datas[grupo->linhas] = registo->data_aplicacao;
+    grupo->linhas++;
+}
+
+/**
+ * @brief Buffers one application with the codes of its vaccine and batch
+ * @param ficheiro File row groups are written to
+ * @param grupo Row group being filled
+ * @param dicionario Codes of the batches
+ * @param indice Batch index, for applications whose batch is gone
+ * @param registo Application to add
+ */
+static void adicionar_aplicacao(FILE* ficheiro, GrupoAplicacoes* grupo,
+                                DicionarioLotes* dicionario,
+                                IndiceLotes* indice, const User* registo) {
+    uint32_t codigo;
+    LoteVacina* lote = dicionario_procurar(dicionario, registo->lote_usado,
+                                           &codigo);
+    const Vacina* da_vacina = lote ? lote->vacina :
+        procurar_vacina(indice, registo->nome_vacina);
+
+    adicionar_ao_grupo(ficheiro, grupo, registo, (uint32_t)da_vacina->id,
+                       codigo);
+}
+
+/**
+ * @brief Writes every batch and application in the columnar format
+ * @param sistema Pointer to the system
+ * @param ficheiro File to write to
+ * @param resumo Output for what was written
+ */
+void escrever_colunas(Sistema* sistema, FILE* ficheiro,
+                      ResumoExportacao* resumo) {
+    IndiceLotes* indice = sistema->indice_lotes;
+    IndiceDias* dias = sistema->indice_dias;
+    DicionarioLotes* dicionario;
+    GrupoAplicacoes* grupo;
+    Vacina* vacina;
+    CursorFrio cursor;
+    User* current;
+    int i;
+
+    resumo->lotes = 0;
+    resumo->aplicacoes = 0;
+
+    dicionario = (DicionarioLotes*)malloc(sizeof(DicionarioLotes));
+    grupo = (GrupoAplicacoes*)malloc(sizeof(GrupoAplicacoes));
+    if (!dicionario || !grupo ||
+        !(grupo->nomes = (char*)malloc(EXPORTAR_NOMES))) {
+        printf("No memory\n");
+        exit(1);
+    }
+    grupo->linhas = 0;
+    grupo->usados = 0;
+    grupo->capacidade = EXPORTAR_NOMES;
+    dicionario_criar(dicionario, indice);
+
+    fwrite(EXPORTAR_MAGIA, 1, sizeof(EXPORTAR_MAGIA) - 1, ficheiro);
+    escrever_u32(ficheiro, EXPORTAR_ORDEM);
+
+    /* Vaccine dictionary, in creation order so codes are the ids */
+    escrever_u32(ficheiro, (uint32_t)indice->num_vacinas);
+    for (vacina = indice->primeira_vacina; vacina != NULL;
+         vacina = vacina->proxima_criada) {
+        escrever_u32(ficheiro, (uint32_t)strlen(vacina->nome));
+    }
+    for (vacina = indice->primeira_vacina; vacina != NULL;
+         vacina = vacina->proxima_criada) {
+        fputs(vacina->nome, ficheiro);
+    }
+
+    /* Batches, one column at a time */
+    escrever_u32(ficheiro, (uint32_t)indice->num_lotes);
+    for (i = 0; i < indice->num_lotes; i++) {
+        escrever_u32(ficheiro, (uint32_t)strlen(indice->calendario[i]->lote));
+    }
+    for (i = 0; i < indice->num_lotes; i++) {
+        fputs(indice->calendario[i]->lote, ficheiro);
+    }
+    for (i = 0; i < indice->num_lotes; i++) {
+        escrever_u32(ficheiro, (uint32_t)indice->calendario[i]->vacina->id);
+    }
+    for (i = 0; i < indice->num_lotes; i++) {
+        int32_t valor = indice->calendario[i]->data_expiracao;
+        fwrite(&valor, sizeof(valor), 1, ficheiro);
+    }
+    for (i = 0; i < indice->num_lotes; i++) {
+        int32_t valor = indice->calendario[i]->dosas_disponiveis;
+        fwrite(&valor, sizeof(valor), 1, ficheiro);
+    }
+    for (i = 0; i < indice->num_lotes; i++) {
+        int32_t valor = indice->calendario[i]->total_aplicacoes;
+        fwrite(&valor, sizeof(valor), 1, ficheiro);
+    }
+    resumo->lotes = indice->num_lotes;
+
+    /* Applications, in row groups, the sealed ones first */
+    cursor_frio_abrir(&cursor, sistema->frio, sistema->frio ?
+                      sistema->frio->num_segmentos : 0, INT_MIN, INT_MAX,
+                      sistema->versao);
+    while ((current = cursor_frio_proximo(&cursor)) != NULL) {
+        adicionar_aplicacao(ficheiro, grupo, dicionario, indice, current);
+        resumo->aplicacoes++;
+    }
+    cursor_frio_fechar(&cursor);
+
+    for (i = 0; i < dias->num_dias; i++) {
+        for (current = dias->dias[i].primeiro; current != NULL;
+             current = current->proximo_dia) {
+            adicionar_aplicacao(ficheiro, grupo, dicionario, indice, current);
+            resumo->aplicacoes++;
+        }
+    }
+    if (grupo->linhas > 0) {
+        escrever_grupo(ficheiro, grupo);
+    }
+    escrever_u32(ficheiro, 0);
+
+    free(grupo->nomes);
+    free(grupo);
+    free(dicionario);
+}
+
+/**
+ * @brief Writes every batch and application to <prefixo>.col
+ * @param sistema Pointer to the system
+ * @param prefixo Path of the file without its suffix
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if the file could not be written
+ */
+int exportar_colunas(Sistema* sistema, const char* prefixo,
+                     ResumoExportacao* resumo) {
+    char* buffer;
+    FILE* ficheiro = abrir_ficheiro(prefixo, ".col", &buffer);
+
+    if (!ficheiro) {
+        resumo->lotes = 0;
+        resumo->aplicacoes = 0;
+        return 0;
+    }
+
+    escrever_colunas(sistema, ficheiro, resumo);
+    return fechar_ficheiro(ficheiro, buffer);
+}
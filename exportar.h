@@ -0,0 +1,88 @@
+/**
+ * @file exportar.h
+ * @brief Streaming export of batches and applications to CSV or columns
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef EXPORTAR_H
+#define EXPORTAR_H
+
+#include "sistema.h"
+
+/**< Bytes of the stdio buffer of each exported file */
+#define EXPORTAR_BUFFER (1 << 20)
+
+/**< Applications per row group of the columnar file */
+#define EXPORTAR_GRUPO 65536
+
+/**< Initial bytes of user names buffered per row group */
+#define EXPORTAR_NOMES (1 << 22)
+
+/**< Slots of the batch dictionary (a power of two above 2 * MAX_LOTES) */
+#define EXPORTAR_DICIONARIO 2048
+
+/**< First bytes of a columnar file */
+#define EXPORTAR_MAGIA "VACCOL1\n"
+
+/**< Written in host byte order so readers can tell which one it was */
+#define EXPORTAR_ORDEM 0x01020304u
+
+/**
+ * @brief What an export wrote
+ */
+typedef struct ResumoExportacao {
+    int lotes;                  /**< Number of batches */
+    long aplicacoes;            /**< Number of applications */
+} ResumoExportacao;
+
+/**
+ * @brief Writes every batch and application as CSV
+ *
+ * Batches go to <prefixo>.lotes.csv in l order, applications to
+ * <prefixo>.aplicacoes.csv in u order, each with a header line.
+ *
+ * @param sistema Pointer to the system
+ * @param prefixo Path of the files without their suffixes
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if a file could not be written
+ */
+int exportar_csv(Sistema* sistema, const char* prefixo,
+                 ResumoExportacao* resumo);
+
+/**
+ * @brief Writes every batch and application in the columnar format
+ *
+ * The stream holds, in host byte order:
+ * - EXPORTAR_MAGIA and EXPORTAR_ORDEM (u32);
+ * - the vaccine dictionary in creation order: count (u32) and the
+ *   names as a string column;
+ * - the batches in l order, which is also the batch dictionary: count
+ *   (u32), then the columns lote (string), vacina (u32 code),
+ *   validade (i32 days since 01-01-1970), doses and aplicacoes (i32);
+ * - the applications in u order, as row groups of up to EXPORTAR_GRUPO
+ *   rows: count (u32), then the columns utente (string), vacina and
+ *   lote (u32 codes) and data (i32). A count of 0 ends the file.
+ *
+ * A string column of n values is n lengths (u32) followed by the bytes
+ * of every value, without terminators.
+ *
+ * @param sistema Pointer to the system
+ * @param ficheiro File to write to; write errors are left in it
+ * @param resumo Output for what was written
+ */
+void escrever_colunas(Sistema* sistema, FILE* ficheiro,
+                      ResumoExportacao* resumo);
+
+/**
+ * @brief Writes every batch and application to <prefixo>.col
+ *
+ * The file is written by escrever_colunas.
+ *
+ * @param sistema Pointer to the system
+ * @param prefixo Path of the file without its suffix
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if the file could not be written
+ */
+int exportar_colunas(Sistema* sistema, const char* prefixo,
+                     ResumoExportacao* resumo);
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file hash.c
+ * @brief Word-at-a-time 64-bit string hash and chain statistics
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "hash.h"
+
+/**< Odd constant multiplied into each word (2^64 / golden ratio) */
+#define HASH_MULT 0x9E3779B97F4A7C15ULL
+
+/**< First multiplier of the final mix (splitmix64) */
+#define HASH_MISTURA1 0xBF58476D1CE4E5B9ULL
+
+/**< Second multiplier of the final mix (splitmix64) */
+#define HASH_MISTURA2 0x94D049BB133111EBULL
+
+/**
+ * @brief Spreads every input bit over the whole 64-bit value
+ * @param x Value to mix
+ * @return Mixed value
+ */
+static unsigned long long misturar(unsigned long long x) {
+    x = (x ^ (x >> 30)) * HASH_MISTURA1;
+    x = (x ^ (x >> 27)) * HASH_MISTURA2;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Hashes a byte string eight bytes at a time
+ *
+ * Each word costs one multiply and one shift; the final mix makes
+ * names that only differ in a few digits land far apart.
+ *
+ * @param dados Bytes to hash
+ * @param len Number of bytes
+ * @param semente Seed, or the hash of a previous key part
+ * @return 64-bit hash value
+ */
+unsigned long long hash_bytes(const void* dados, size_t len,
+                              unsigned long long semente) {
+    const unsigned char* p = (const unsigned char*)dados;
+    unsigned long long hash = semente ^ (len * HASH_MULT);
+    unsigned long long palavra;
+
+    while (len >= sizeof(palavra)) {
+        memcpy(&palavra, p, sizeof(palavra));
+        hash = (hash ^ palavra) * HASH_MULT;
+        hash ^= hash >> 32;
+        p += sizeof(palavra);
+        len -= sizeof(palavra);
+    }
+
+    if (len > 0) {
+        palavra = 0;
+        memcpy(&palavra, p, len);
+        hash = (hash ^ palavra) * HASH_MULT;
+    }
+
+    return misturar(hash);
+}
+
+/**
+ * @brief Hashes a null-terminated string
+ * @param texto String to hash
+ * @return 64-bit hash value
+ */
+unsigned long long hash_texto(const char* texto) {
+    return hash_bytes(texto, strlen(texto), HASH_SEMENTE);
+}
+
+/**
+ * @brief Accounts for one bucket in an occupancy report
+ * @param ocupacao Report being built, zeroed before the first bucket
+ * @param cadeia Number of entries in the bucket
+ */
+void ocupacao_contar(OcupacaoHash* ocupacao, unsigned long cadeia) {
+    ocupacao->buckets++;
+    ocupacao->entradas += cadeia;
+    if (cadeia > 0) ocupacao->ocupados++;
+    if (cadeia > ocupacao->maior_cadeia) ocupacao->maior_cadeia = cadeia;
+}
+
+/**
+ * @brief Prints an occupancy report on one line
+ * @param saida Stream to write to
+ * @param nome Name of the table
+ * @param ocupacao Report to print
+ */
+void ocupacao_imprimir(FILE* saida, const char* nome,
+                       const OcupacaoHash* ocupacao) {
+    double buckets = ocupacao->buckets ? ocupacao->buckets : 1;
+    double ocupados = ocupacao->ocupados ? ocupacao->ocupados : 1;
+
+    fprintf(saida, "%s: %lu entries, %lu buckets, load %.2f, "
+            "%.1f%% occupied, %.2f per used bucket, longest chain %lu\n",
+            nome, ocupacao->entradas, ocupacao->buckets,
+            ocupacao->entradas / buckets,
+            100.0 * ocupacao->ocupados / buckets,
+            ocupacao->entradas / ocupados, ocupacao->maior_cadeia);
+}
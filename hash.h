@@ -0,0 +1,58 @@
+/**
+ * @file hash.h
+ * @brief 64-bit string hash shared by every table, and chain statistics
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**< Seed of hashes of a single key */
+#define HASH_SEMENTE 0x243F6A8885A308D3ULL
+
+/**
+ * @brief Occupancy of the buckets of a chained hash table
+ */
+typedef struct OcupacaoHash {
+    unsigned long buckets;        /**< Number of buckets */
+    unsigned long ocupados;       /**< Buckets with at least one entry */
+    unsigned long entradas;       /**< Number of entries */
+    unsigned long maior_cadeia;   /**< Entries in the longest bucket */
+} OcupacaoHash;
+
+/**
+ * @brief Hashes a byte string eight bytes at a time
+ * @param dados Bytes to hash
+ * @param len Number of bytes
+ * @param semente Seed, or the hash of a previous key part
+ * @return 64-bit hash value
+ */
+unsigned long long hash_bytes(const void* dados, size_t len,
+                              unsigned long long semente);
+
+/**
+ * @brief Hashes a null-terminated string
+ * @param texto String to hash
+ * @return 64-bit hash value
+ */
+unsigned long long hash_texto(const char* texto);
+
+/**
+ * @brief Accounts for one bucket in an occupancy report
+ * @param ocupacao Report being built, zeroed before the first bucket
+ * @param cadeia Number of entries in the bucket
+ */
+void ocupacao_contar(OcupacaoHash* ocupacao, unsigned long cadeia);
+
+/**
+ * @brief Prints an occupancy report on one line
+ * @param saida Stream to write to
+ * @param nome Name of the table
+ * @param ocupacao Report to print
+ */
+void ocupacao_imprimir(FILE* saida, const char* nome,
+                       const OcupacaoHash* ocupacao);
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file mensagens.c
+ * @brief Catalog of the messages the commands print, in every language
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "mensagens.h"
+
+/**< Catalog entry for a string literal, with its length */
+#define MENSAGEM(texto) {texto, sizeof(texto) - 1}
+
+/** Program argument that selects each language, NULL for the default */
+static const char* const argumentos[NUM_IDIOMAS] = {
+    [IDIOMA_INGLES] = NULL,
+    [IDIOMA_PORTUGUES] = "pt"
+};
+
+/** Every message in every language */
+static const Mensagem catalogo[NUM_IDIOMAS][NUM_MENSAGENS] = {
+    [IDIOMA_INGLES] = {
+        [MSG_SEM_MEMORIA] = MENSAGEM("No memory\n"),
+        [MSG_LEITURA_FALHOU] = MENSAGEM("No memory.\n"),
+        [MSG_LOTE_INVALIDO] = MENSAGEM("invalid batch\n"),
+        [MSG_DATA_INVALIDA] = MENSAGEM("invalid date\n"),
+        [MSG_NOME_INVALIDO] = MENSAGEM("invalid name\n"),
+        [MSG_DEMASIADAS_VACINAS] = MENSAGEM("too many vaccines\n"),
+        [MSG_LOTE_DUPLICADO] = MENSAGEM("duplicate batch number\n"),
+        [MSG_QUANTIDADE_INVALIDA] = MENSAGEM("invalid quantity\n"),
+        [MSG_JA_VACINADO] = MENSAGEM("already vaccinated\n"),
+        [MSG_ESGOTADO] = MENSAGEM("no stock\n"),
+        [MSG_VACINA_INEXISTENTE] = MENSAGEM(": no such vaccine\n"),
+        [MSG_LOTE_INEXISTENTE] = MENSAGEM(": no such batch\n"),
+        [MSG_UTENTE_INEXISTENTE] = MENSAGEM(": no such user\n"),
+        [MSG_FORMATO_INVALIDO] = MENSAGEM("invalid format\n"),
+        [MSG_FICHEIRO_INACESSIVEL] = MENSAGEM(": cannot write file\n"),
+        [MSG_FICHEIRO_ILEGIVEL] = MENSAGEM(": cannot read file\n"),
+        [MSG_SALVAGUARDA_EM_CURSO] = MENSAGEM("checkpoint in progress\n"),
+        [MSG_FIM_ENTRADA] = MENSAGEM("buffer size reached\n")
+    },
+    [IDIOMA_PORTUGUES] = {
+        [MSG_SEM_MEMORIA] = MENSAGEM("sem memória\n"),
+        [MSG_LEITURA_FALHOU] = MENSAGEM("sem memória.\n"),
+        [MSG_LOTE_INVALIDO] = MENSAGEM("lote inválido\n"),
+        [MSG_DATA_INVALIDA] = MENSAGEM("data inválida\n"),
+        [MSG_NOME_INVALIDO] = MENSAGEM("nome inválido\n"),
+        [MSG_DEMASIADAS_VACINAS] = MENSAGEM("demasiadas vacinas\n"),
+        [MSG_LOTE_DUPLICADO] = MENSAGEM("número de lote duplicado\n"),
+        [MSG_QUANTIDADE_INVALIDA] = MENSAGEM("quantidade inválida\n"),
+        [MSG_JA_VACINADO] = MENSAGEM("já vacinado\n"),
+        [MSG_ESGOTADO] = MENSAGEM("esgotado\n"),
+        [MSG_VACINA_INEXISTENTE] = MENSAGEM(": vacina inexistente\n"),
+        [MSG_LOTE_INEXISTENTE] = MENSAGEM(": lote inexistente\n"),
+        [MSG_UTENTE_INEXISTENTE] = MENSAGEM(": utente inexistente\n"),
+        [MSG_FORMATO_INVALIDO] = MENSAGEM("formato inválido\n"),
+        [MSG_FICHEIRO_INACESSIVEL] = MENSAGEM(": ficheiro inacessível\n"),
+        [MSG_FICHEIRO_ILEGIVEL] = MENSAGEM(": ficheiro ilegível\n"),
+        [MSG_SALVAGUARDA_EM_CURSO] = MENSAGEM("salvaguarda em curso\n"),
+        [MSG_FIM_ENTRADA] = MENSAGEM("tamanho do buffer atingido\n")
+    }
+};
+
+/**
+ * @brief Finds the language selected by a program argument
+ * @param argumento Program argument, such as "pt"
+ * @param idioma Output for the language
+ * @return 1 if the argument names a language, 0 otherwise
+ */
+int idioma_por_argumento(const char* argumento, Idioma* idioma) {
+    int i;
+
+    for (i = 0; i < NUM_IDIOMAS; i++) {
+        if (argumentos[i] && strcmp(argumentos[i], argumento) == 0) {
+            *idioma = (Idioma)i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Returns the messages of a language, indexed by IdMensagem
+ * @param idioma Language
+ * @return Array of NUM_MENSAGENS messages
+ */
+const Mensagem* mensagens_do_idioma(Idioma idioma) {
+    return catalogo[idioma];
+}
+
+/**
+ * @brief Writes a message
+ * @param saida Stream to write to
+ * @param mensagens Messages of the selected language
+ * @param id Message to write
+ */
+void emitir_mensagem(FILE* saida, const Mensagem* mensagens, IdMensagem id) {
+    fwrite(mensagens[id].texto, 1, mensagens[id].len, saida);
+}
+
+/**
+ * @brief Writes a name followed by a message about it
+ * @param saida Stream to write to
+ * @param mensagens Messages of the selected language
+ * @param id Message to write
+ * @param nome User, batch or vaccine the message is about
+ */
+void emitir_mensagem_nome(FILE* saida, const Mensagem* mensagens,
+                          IdMensagem id, const char* nome) {
+    fputs(nome, saida);
+    fwrite(mensagens[id].texto, 1, mensagens[id].len, saida);
+}
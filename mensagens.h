@@ -0,0 +1,89 @@
+/**
+ * @file mensagens.h
+ * @brief Catalog of the messages the commands print, in every language
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef MENSAGENS_H
+#define MENSAGENS_H
+
+#include <stdio.h>
+
+/**
+ * @brief Identifier of each message in the catalog
+ *
+ * Messages about a named user, batch or vaccine are printed after the
+ * name and start with ": ".
+ */
+typedef enum IdMensagem {
+    MSG_SEM_MEMORIA,            /**< Allocation failed */
+    MSG_LEITURA_FALHOU,         /**< Arguments of c could not be read */
+    MSG_LOTE_INVALIDO,          /**< Batch id is too long or not hex */
+    MSG_DATA_INVALIDA,          /**< Date does not exist or is not allowed */
+    MSG_NOME_INVALIDO,          /**< Vaccine name is too long or has blanks */
+    MSG_DEMASIADAS_VACINAS,     /**< MAX_LOTES batches already exist */
+    MSG_LOTE_DUPLICADO,         /**< Batch id already exists */
+    MSG_QUANTIDADE_INVALIDA,    /**< Number of doses is not positive */
+    MSG_JA_VACINADO,            /**< Same user and vaccine on the same day */
+    MSG_ESGOTADO,               /**< No usable dose of the vaccine */
+    MSG_VACINA_INEXISTENTE,     /**< After a vaccine name */
+    MSG_LOTE_INEXISTENTE,       /**< After a batch id */
+    MSG_UTENTE_INEXISTENTE,     /**< After a user name */
+    MSG_FORMATO_INVALIDO,       /**< Export format is not known */
+    MSG_FICHEIRO_INACESSIVEL,   /**< After a file that cannot be written */
+    MSG_FICHEIRO_ILEGIVEL,      /**< After a file that cannot be read */
+    MSG_SALVAGUARDA_EM_CURSO,   /**< A checkpoint is still being written */
+    MSG_FIM_ENTRADA,            /**< Input ended before r's arguments */
+    NUM_MENSAGENS               /**< Number of messages */
+} IdMensagem;
+
+/**
+ * @brief Languages the messages are available in
+ */
+typedef enum Idioma {
+    IDIOMA_INGLES,              /**< Default language */
+    IDIOMA_PORTUGUES,           /**< Selected with the pt argument */
+    NUM_IDIOMAS                 /**< Number of languages */
+} Idioma;
+
+/**
+ * @brief One message, with its length known at compile time
+ */
+typedef struct Mensagem {
+    const char* texto;          /**< Text, including the final newline */
+    size_t len;                 /**< Number of bytes of texto */
+} Mensagem;
+
+/**
+ * @brief Finds the language selected by a program argument
+ * @param argumento Program argument, such as "pt"
+ * @param idioma Output for the language
+ * @return 1 if the argument names a language, 0 otherwise
+ */
+int idioma_por_argumento(const char* argumento, Idioma* idioma);
+
+/**
+ * @brief Returns the messages of a language, indexed by IdMensagem
+ * @param idioma Language
+ * @return Array of NUM_MENSAGENS messages
+ */
+const Mensagem* mensagens_do_idioma(Idioma idioma);
+
+/**
+ * @brief Writes a message
+ * @param saida Stream to write to
+ * @param mensagens Messages of the selected language
+ * @param id Message to write
+ */
+void emitir_mensagem(FILE* saida, const Mensagem* mensagens, IdMensagem id);
+
+/**
+ * @brief Writes a name followed by a message about it
+ * @param saida Stream to write to
+ * @param mensagens Messages of the selected language
+ * @param id Message to write
+ * @param nome User, batch or vaccine the message is about
+ */
+void emitir_mensagem_nome(FILE* saida, const Mensagem* mensagens,
+                          IdMensagem id, const char* nome);
+
+#endif
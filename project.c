@@ -5,8 +5,23 @@
  * @author ist1113656 (Taha Adar Ozsoy)
  */
 
+#include <limits.h>
+
+/* mallinfo2 reports what malloc holds, from glibc 2.33 on */
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+#include <malloc.h>
+#define PROJ_MALLINFO 1
+#endif
+#endif
+
 #include "vacina.h"
 #include "user.h"
+#include "sistema.h"
+#include "servidor.h"
+#include "exportar.h"
+#include "salvaguarda.h"
+#include "varrer.h"
 
  /**< Max length for batch name string incl. null byte */
 #define NOME_LOTE_MAX 21
@@ -14,12 +29,62 @@
 /**< Max length for vaccine name string incl. null byte */
 #define NOME_VACINA_MAX 51  
 
-/**< Buffer size for reading input lines */
-#define BUFFER_SIZE 65535
-
 /**< System limit for number of vaccine batches */
 #define MAX_LOTES 1000       
 
+/**
+ * @brief Arguments of the c command
+ */
+typedef struct DadosLote {
+    char lote[NOME_LOTE_MAX];       /**< Batch id */
+    char nome[NOME_VACINA_MAX];     /**< Vaccine name */
+    int dia, mes, ano;              /**< Expiry date */
+    int doses;                      /**< Number of doses */
+} DadosLote;
+
+/**
+ * @brief A batch as an l snapshot saw it
+ */
+typedef struct LinhaLote {
+    LoteVacina* lote;               /**< Batch, with its fixed name and id */
+    int doses;                      /**< Doses it had left */
+    int aplicacoes;                 /**< Doses it had given */
+} LinhaLote;
+
+/**
+ * @brief Snapshot of an l or u command
+ *
+ * l keeps the batches, sorted, with the counters they had.
+ * u only keeps the head of the application list: records are added in
+ * front of it, and records deleted after versao stay linked, marked,
+ * while the snapshot lives. Segments are not sealed while it lives,
+ * and deletions of sealed records carry their version too. The pinned
+ * epoch keeps every batch and record the snapshot can reach from being
+ * freed until it is answered.
+ */
+struct Consulta {
+    char comando;                   /**< l or u */
+    const Mensagem* mensagens;      /**< Messages of the system's language */
+    Epocas* epocas;                 /**< Epochs of the system */
+    int leitor;                     /**< Slot of the pinned epoch */
+    int fixada;                     /**< 1 until the epoch is unpinned */
+    int vazia;                      /**< 1 if the response is empty */
+    char* linha;                    /**< Copy of l's arguments */
+    char* nomes[10];                /**< Vaccines l is filtered by */
+    int num_nomes;                  /**< Number of names, 0 for all */
+    LinhaLote* lotes;               /**< Batches in l order */
+    int num_lotes;                  /**< Number of batches */
+    char* nome_usuario;             /**< User u is filtered by, or "" */
+    int utente_ausente;             /**< 1 if the filter ruled the user out */
+    User* aplicacoes;               /**< Head of the application list */
+    const ArquivoFrio* frio;        /**< Sealed applications, or NULL */
+    int num_segmentos;              /**< Segments sealed then */
+    unsigned long versao;           /**< Deletions the snapshot sees */
+    Traco* traco;                   /**< Trace of the system, or NULL */
+    TracoLocal traco_local;         /**< Spans recorded answering it */
+    struct Consulta* next;          /**< Next snapshot not yet released */
+};
+
 /**
  * @brief Checks if the vaccine batch list has reached maximum capacity
  * @param lista_vacina Pointer to the first vaccine batch
@@ -63,149 +128,294 @@ int eh_nome_valido(char* nome);
  * @param dia Day to check
  * @param mes Month to check
  * @param ano Year to check
- * @param dia_sistema Current system day
- * @param mes_sistema Current system month
- * @param ano_sistema Current system year
+ * @param data_sistema Current system date
  * @return 1 if valid, 0 otherwise
  */
-int eh_data_valido(int* dia, int* mes, int* ano, int* dia_sistema,
-                int* mes_sistema, int* ano_sistema);
+int eh_data_valido(int dia, int mes, int ano, Data data_sistema);
 
 /**
  * @brief Processes user input to create a new vaccine batch
  * 
  * Reads batch details, validates them, and adds to the system
  */
-void obter_dados_lote(LoteVacina** lista_vacinas, char* lote, int* dia, 
-            int* mes, int* ano, int dia_atual, int mes_atual, int ano_atual, 
-            int* num_dosas, char* noma_vacina, int use_portugues);
+void obter_dados_lote(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Reads the arguments of c from a line
+ * @param linha Line after the command letter
+ * @param dados Output for the arguments
+ * @param erro Output for the message to print when the line cannot be
+ * read, or NUM_MENSAGENS if c prints nothing for it
+ * @return 1 if every argument was read, 0 otherwise
+ */
+int ler_dados_lote(char* linha, DadosLote* dados, IdMensagem* erro);
+
+/**
+ * @brief Checks a new batch in the order c reports errors
+ * @param dados Arguments of the batch
+ * @param data_sistema Current system date
+ * @param cheio 1 if MAX_LOTES batches already exist
+ * @param duplicado 1 if the batch id is taken
+ * @return The first error, or NUM_MENSAGENS if the batch can be created
+ */
+IdMensagem validar_lote(DadosLote* dados, Data data_sistema, int cheio,
+                        int duplicado);
+
+/**
+ * @brief Creates every valid batch of a manifest at once
+ * 
+ * Reports the lines c would reject, with the same messages
+ */
+int importar_manifesto(Sistema* sistema, const char* caminho, FILE* saida);
+
+/**
+ * @brief Imports a batch manifest named on the command line
+ */
+void importar_lotes(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Lists vaccine batches based on user input
  * 
  * Can list all batches or filter by vaccine name(s)
  */
-void listar_vacinas(LoteVacina* lista_vacina, int use_portuguese);
+void listar_vacinas(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Applies a vaccine dose to a user
  * 
  * Selects the oldest valid batch and records application
  */
-void aplicar_dose_vacina(LoteVacina* lista_vacina, User** lista_user,
-                        HojeVaxTable* vax_table_hoje, int dia_atual,
-                        int mes_atual, int ano_atual, int use_portuguese);
+void aplicar_dose_vacina(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Removes availability of a specified batch
  * 
  * Either deletes batch or marks it as fully used
  */
-void retirar_disponibilidade(LoteVacina** lista_vacina, User* lista_user,
-                            int use_portuguese);
+void retirar_disponibilidade(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Advances system time
  * 
- * Updates the current date and refreshes the daily vaccination table
+ * Updates the current date and retires the batches
+ * that expired in between
  */
-void avancar_tempo(int* dia_sistema, int* mes_sistema, int* ano_sistema,
-                HojeVaxTable* vax_table_hoje, int use_portuguese);
+void avancar_tempo(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Deletes vaccination records based on criteria
  * 
  * Can delete by user, date, and/or batch
  */
-void apagar_aplicacoes(User** lista_user, LoteVacina* lista_vacina, 
-                        int dia_atual, int mes_atual, int ano_atual,
-                        int use_portuguese);
+void apagar_aplicacoes(Sistema* sistema, FILE* entrada, FILE* saida);
 
 /**
  * @brief Lists vaccination applications
  * 
  * Shows all applications or just those for specific user
  */
-void listar_aplicacoes(User* lista_user, int use_portuguese);
+void listar_aplicacoes(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Shows aggregate statistics
+ * 
+ * Prints the stock of each vaccine and the applications of each day
+ */
+void mostrar_estatisticas(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Lists the applications given between two dates
+ * 
+ * Optionally only those of one vaccine
+ */
+void listar_periodo(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Lists the batches with doses left that expire soon
+ * 
+ * Reports the doses at risk within the given number of days
+ */
+void listar_a_expirar(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Exports every batch and application to files
+ * 
+ * Writes CSV or the columnar binary format
+ */
+void exportar_registos(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Writes a checkpoint of the whole state in the background
+ * 
+ * Commands keep running while a child process writes it
+ */
+void salvaguardar_sistema(Sistema* sistema, FILE* entrada, FILE* saida);
+
+/**
+ * @brief Shows the size and health of the structures
+ * 
+ * Reads counters the commands keep, without walking any list
+ */
+void mostrar_estado(Sistema* sistema, FILE* entrada, FILE* saida);
 
+/* Tools in tools/ link the handlers with their own entry point */
+#ifndef PROJ_SEM_MAIN
 /**
  * @brief Program entry point
  * 
- * Initializes system and handles command processing
+ * Initializes system and handles command processing, either from
+ * standard input or, with --servidor, from clients of a local socket
  */
 int main(int argumento_num, char *argumento_val[]) {
-    LoteVacina* lista_vacinas = NULL;
-    User* lista_users = NULL;
-    HojeVaxTable* vax_table_hoje = NULL;
+    Sistema* sistema;
+    const char* endereco_servidor = NULL;
+    const char* diretorio_frio = "/tmp";
+    const char* caminho_traco = NULL;
+    int idade_frio = -1;
     char comando;
-    int dia, mes, ano, num_dosas;
-    char lote[NOME_LOTE_MAX], nome_vacina[NOME_VACINA_MAX];
-    int use_portugues = 0;
+    Idioma idioma = IDIOMA_INGLES;
+    int i, resultado = 0;
+
+    for (i = 1; i < argumento_num; i++) {
+        if (strcmp(argumento_val[i], "--servidor") == 0 &&
+            i + 1 < argumento_num) {
+            endereco_servidor = argumento_val[++i];
+        } else if (strcmp(argumento_val[i], "--importar") == 0 &&
+                   i + 1 < argumento_num) {
+            i++; /* Imported once the system exists */
+        } else if (strcmp(argumento_val[i], "--frio") == 0 &&
+                   i + 1 < argumento_num) {
+            idade_frio = atoi(argumento_val[++i]);
+        } else if (strcmp(argumento_val[i], "--segmentos") == 0 &&
+                   i + 1 < argumento_num) {
+            diretorio_frio = argumento_val[++i];
+        } else if (strcmp(argumento_val[i], "--traco") == 0 &&
+                   i + 1 < argumento_num) {
+            caminho_traco = argumento_val[++i];
+        } else {
+            /* Any other argument may select a language, such as pt */
+            idioma_por_argumento(argumento_val[i], &idioma);
+        }
+    }
 
-    /* Initial system date is 01-01-2025 */
-    int dia_sistema = 1, mes_sistema = 1, ano_sistema = 2025;
+    sistema = criar_sistema(idioma);
 
-    /* Check if Portuguese language flag is set */
-    if (argumento_num > 1 && strcmp(argumento_val[1], "pt") == 0) {
-        use_portugues = 1;
+    /* Applications older than --frio days are sealed to disk */
+    if (idade_frio >= 0) {
+        sistema->frio = criar_arquivo_frio(diretorio_frio, idade_frio);
     }
 
-    vax_table_hoje = criar_vax_table_hoje(dia_sistema, mes_sistema, 
-                                        ano_sistema);
-    
-    char line_buffer[BUFFER_SIZE];
-    while (1) {
-        int ler_res = scanf(" %c", &comando);
+    /* Spans are written to --traco when the system is freed */
+    if (caminho_traco) {
+        sistema->traco = criar_traco(caminho_traco);
+    }
 
-        if (ler_res == EOF) {
-            break;
+    /* Manifests given at startup are loaded before any command */
+    for (i = 1; i < argumento_num; i++) {
+        if (strcmp(argumento_val[i], "--importar") == 0 &&
+            i + 1 < argumento_num) {
+            importar_manifesto(sistema, argumento_val[++i], stdout);
+        } else if ((strcmp(argumento_val[i], "--servidor") == 0 ||
+                    strcmp(argumento_val[i], "--frio") == 0 ||
+                    strcmp(argumento_val[i], "--segmentos") == 0 ||
+                    strcmp(argumento_val[i], "--traco") == 0) &&
+                   i + 1 < argumento_num) {
+            i++;
         }
-        
-        switch (comando) {
-            case 'q':
-                free_lotes(lista_vacinas);
-                free_users(lista_users);
-                free_hoje_vax_table(vax_table_hoje);
-                return 0;
-            case 'c':
-                obter_dados_lote(&lista_vacinas, lote, &dia, &mes, &ano, 
-                                dia_sistema, mes_sistema, ano_sistema,
-                                &num_dosas, nome_vacina, use_portugues);
-                break;
-            case 'l':
-                listar_vacinas(lista_vacinas, use_portugues);
-                break;
-            case 'a':
-                aplicar_dose_vacina(lista_vacinas, &lista_users, vax_table_hoje,
-                                    dia_sistema, mes_sistema, ano_sistema,
-                                    use_portugues);
-                break;
-            case 'r':
-                retirar_disponibilidade(&lista_vacinas, lista_users,
-                                       use_portugues);
-                break;
-            case 't':
-                avancar_tempo(&dia_sistema, &mes_sistema, &ano_sistema,
-                            vax_table_hoje, use_portugues);
-                break;
-            case 'd':
-                apagar_aplicacoes(&lista_users, lista_vacinas, dia_sistema,
-                                mes_sistema, ano_sistema, use_portugues);
-                break;
-            case 'u':
-                listar_aplicacoes(lista_users, use_portugues);
-                break;
-            default:
-                fgets(line_buffer, BUFFER_SIZE, stdin);
+    }
+
+    if (endereco_servidor) {
+        resultado = executar_servidor(sistema, endereco_servidor);
+    } else {
+        while (scanf(" %c", &comando) != EOF) {
+            if (!executar_comando(sistema, comando, stdin, stdout)) {
                 break;
+            }
         }
     }
 
     /* Clean up before exiting */
-    free_lotes(lista_vacinas);
-    free_users(lista_users);
-    free_hoje_vax_table(vax_table_hoje);
-    return 0;
+    free_sistema(sistema);
+    return resultado;
+}
+#endif
+
+/**
+ * @brief Runs one command against the system state
+ * 
+ * Reads the command's arguments from the rest of the current line
+ * of the input stream and writes its response to the output stream.
+ * The time it takes is added to its letter's counter and, when
+ * tracing, recorded as a span.
+ * 
+ * @return 0 if the command was q, 1 otherwise
+ */
+int executar_comando(Sistema* sistema, char comando, FILE* entrada,
+                     FILE* saida) {
+    unsigned long long inicio = sistema_ciclos();
+    int continuar = 1;
+
+    traco_comecar(sistema->traco, inicio);
+
+    /* A checkpoint child that finished is reaped before the next command */
+    if (sistema->salvaguarda.pid > 0) {
+        recolher_salvaguarda(sistema, 0);
+    }
+
+    switch (comando) {
+        case 'q':
+            continuar = 0;
+            break;
+        case 'c':
+            obter_dados_lote(sistema, entrada, saida);
+            break;
+        case 'l':
+            listar_vacinas(sistema, entrada, saida);
+            break;
+        case 'a':
+            aplicar_dose_vacina(sistema, entrada, saida);
+            break;
+        case 'r':
+            retirar_disponibilidade(sistema, entrada, saida);
+            break;
+        case 't':
+            avancar_tempo(sistema, entrada, saida);
+            break;
+        case 'd':
+            apagar_aplicacoes(sistema, entrada, saida);
+            break;
+        case 'u':
+            listar_aplicacoes(sistema, entrada, saida);
+            break;
+        case 's':
+            mostrar_estatisticas(sistema, entrada, saida);
+            break;
+        case 'p':
+            listar_periodo(sistema, entrada, saida);
+            break;
+        case 'e':
+            listar_a_expirar(sistema, entrada, saida);
+            break;
+        case 'x':
+            exportar_registos(sistema, entrada, saida);
+            break;
+        case 'i':
+            importar_lotes(sistema, entrada, saida);
+            break;
+        case 'g':
+            salvaguardar_sistema(sistema, entrada, saida);
+            break;
+        case 'h':
+            mostrar_estado(sistema, entrada, saida);
+            break;
+        default:
+            ler_linha(sistema, entrada);
+            break;
+    }
+
+    traco_comando(sistema->traco, comando, inicio,
+                  contar_comando(sistema, comando, inicio));
+    return continuar;
 }
 
 /**
@@ -214,53 +424,104 @@ int main(int argumento_num, char *argumento_val[]) {
  * Reads and validates input parameters for creating a new batch.
  * Reports appropriate errors if validation fails.
  */
-void obter_dados_lote(LoteVacina** lista_vacinas, char* lote, int* dia, 
-            int* mes, int* ano, int dia_atual, int mes_atual, int ano_atual,
-                int* num_dosas, char* nome_vacina, int use_portugues){
-    char input_buffer[BUFFER_SIZE];
+void obter_dados_lote(Sistema* sistema, FILE* entrada, FILE* saida){
+    char* linha = ler_linha(sistema, entrada);
+    const Mensagem* mensagens = sistema->mensagens;
+    DadosLote dados;
+    IdMensagem erro;
+    unsigned long long inicio;
+    int lido;
+
+    if (linha == NULL){
+        emitir_mensagem(saida, mensagens, MSG_LEITURA_FALHOU);
+        return;
+    }
 
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL){
-        printf(use_portugues ? "sem memória.\n" : "No memory.\n");
+    inicio = traco_inicio_comando(sistema->traco);
+    lido = ler_dados_lote(linha, &dados, &erro);
+    inicio = traco_fim(sistema->traco, TRACO_LEITURA, "ler_dados_lote",
+                       inicio);
+    if (!lido) {
+        if (erro != NUM_MENSAGENS) {
+            emitir_mensagem(saida, mensagens, erro);
+        }
         return;
     }
 
-    /* Pre-check batch name length to avoid buffer overflows */
-    char primeiro_scan[BUFFER_SIZE];
-    if (sscanf(input_buffer, " %s", primeiro_scan) == 1 && 
-        strlen(primeiro_scan) >= NOME_LOTE_MAX) {
-        printf(use_portugues ? "lote inválido\n" : "invalid batch\n");
+    erro = validar_lote(&dados, sistema->data_sistema,
+                        lista_vacina_eh_cheio(sistema->lista_vacinas),
+                        lote_existe(dados.lote, sistema->lista_vacinas));
+    traco_fim(sistema->traco, TRACO_PROCURA, "validar_lote", inicio);
+    if (erro != NUM_MENSAGENS) {
+        emitir_mensagem(saida, mensagens, erro);
         return;
     }
 
-    int input = sscanf(input_buffer, " %20s %d-%d-%d %d %50s",
-                    lote, dia, mes, ano, num_dosas, nome_vacina);
+    LoteVacina* novo_lote = criar_lote(dados.nome, dados.lote,
+                                data_criar(dados.dia, dados.mes, dados.ano),
+                                dados.doses);
+    adicionar_lote(&sistema->lista_vacinas, novo_lote);
+    indexar_lote(sistema->indice_lotes, novo_lote);
+    fprintf(saida, "%s\n", dados.lote);
+}
 
-    if(input == 6){
-        if (!eh_data_valido(dia, mes, ano, &dia_atual, &mes_atual,
-                            &ano_atual)) {
-            printf(use_portugues ? "data inválida\n" : "invalid date\n");
-            return;
-        }else if (!eh_lote_valido(lote)) {
-            printf(use_portugues ? "lote inválido\n" : "invalid batch\n");
-            return;
-        }else if (!eh_nome_valido(nome_vacina)) {
-            printf(use_portugues ? "nome inválido\n" : "invalid name\n");
-        } else if (lista_vacina_eh_cheio(*lista_vacinas)) {
-            printf(use_portugues ? "demasiadas vacinas\n" : 
-                "too many vaccines\n");
-        } else if (lote_existe(lote, *lista_vacinas)) {
-            printf(use_portugues ? "número de lote duplicado\n" : 
-                "duplicate batch number\n");
-        } else if (*num_dosas <= 0) {
-            printf(use_portugues ? "quantidade inválida\n" : 
-                "invalid quantity\n");
-        } else {
-            adicionar_lote(lista_vacinas, 
-                        criar_lote(nome_vacina, lote, *dia, *mes,
-                                    *ano, *num_dosas));
-            printf("%s\n", lote);
-        }
+/**
+ * @brief Reads the arguments of c from a line
+ * 
+ * An over-long batch id is reported before anything else; a line
+ * without all six arguments is silently ignored.
+ * 
+ * @param linha Line after the command letter
+ * @param dados Output for the arguments
+ * @param erro Output for the message to print when the line cannot be
+ * read, or NUM_MENSAGENS if c prints nothing for it
+ * @return 1 if every argument was read, 0 otherwise
+ */
+int ler_dados_lote(char* linha, DadosLote* dados, IdMensagem* erro) {
+    *erro = NUM_MENSAGENS;
+
+    /* Pre-check batch name length to avoid buffer overflows */
+    char* primeiro = linha;
+    size_t primeiro_len = 0;
+    while (isspace((unsigned char)*primeiro)) primeiro++;
+    while (primeiro[primeiro_len] &&
+           !isspace((unsigned char)primeiro[primeiro_len])) primeiro_len++;
+    if (primeiro_len >= NOME_LOTE_MAX) {
+        *erro = MSG_LOTE_INVALIDO;
+        return 0;
     }
+
+    int input = sscanf(linha, " %20s %d-%d-%d %d %50s",
+                    dados->lote, &dados->dia, &dados->mes, &dados->ano,
+                    &dados->doses, dados->nome);
+
+    return input == 6;
+}
+
+/**
+ * @brief Checks a new batch in the order c reports errors
+ * @param dados Arguments of the batch
+ * @param data_sistema Current system date
+ * @param cheio 1 if MAX_LOTES batches already exist
+ * @param duplicado 1 if the batch id is taken
+ * @return The first error, or NUM_MENSAGENS if the batch can be created
+ */
+IdMensagem validar_lote(DadosLote* dados, Data data_sistema, int cheio,
+                        int duplicado) {
+    if (!eh_data_valido(dados->dia, dados->mes, dados->ano, data_sistema)) {
+        return MSG_DATA_INVALIDA;
+    } else if (!eh_lote_valido(dados->lote)) {
+        return MSG_LOTE_INVALIDO;
+    } else if (!eh_nome_valido(dados->nome)) {
+        return MSG_NOME_INVALIDO;
+    } else if (cheio) {
+        return MSG_DEMASIADAS_VACINAS;
+    } else if (duplicado) {
+        return MSG_LOTE_DUPLICADO;
+    } else if (dados->doses <= 0) {
+        return MSG_QUANTIDADE_INVALIDA;
+    }
+    return NUM_MENSAGENS;
 }
 
 /**
@@ -320,15 +581,7 @@ int lote_existe(char* lote, LoteVacina* lista_vacina) {
  * @return 1 if valid, 0 otherwise
  */
 int eh_lote_valido(char* lote) {
-    int len = strlen(lote);
-
-    for (int i = 0; i < len; i++) {
-        if (!((lote[i] >= '0' && lote[i] <= '9') ||
-                (lote[i] >= 'A' && lote[i] <= 'F'))) {
-            return 0;  
-        }
-    }
-    return 1;
+    return varrer_hex(lote, lote + strlen(lote));
 }
 
 /**
@@ -368,42 +621,9 @@ int eh_nome_valido(char* nome) {
  * and after system date
  * @return 1 if valid, 0 otherwise
  */
-int eh_data_valido(int* dia, int* mes, int* ano, int* dia_sistema,
-                 int* mes_sistema, int* ano_sistema) {
-    if (*mes < 1 || *mes > 12) return 0;
-    if (*dia < 1 || *dia > 31) return 0;
-
-    /* Check days in month */
-    if ((*mes == 4 || *mes == 6 || *mes == 9 || *mes == 11) && 
-        *dia > 30) return 0;
-    if (*mes == 2) {
-        int leap = (*ano % 4 == 0 && (*ano % 100 != 0 || *ano % 400 == 0));
-        if (*dia > (leap ? 29 : 28)) return 0;
-    }
-
-    /* Make sure date isn't in the past */
-    int data_input = ddmmyy_int(*dia, *mes, *ano);
-    int data_sistema = ddmmyy_int(*dia_sistema, *mes_sistema, *ano_sistema);
-    if (data_input < data_sistema) return 0;
-
-    return 1;
-}
-
-/**
- * @brief Compares two batches for sorting
- * 
- * First by expiration date, then alphabetically by batch ID
- * 
- * @param lote_a First batch
- * @param lote_b Second batch
- * @return Negative if a<b, positive if a>b, 0 if equal
- */
-int comparar_lotes(LoteVacina* lote_a, LoteVacina* lote_b) {
-    if (lote_a->data_expiracao_int != lote_b->data_expiracao_int) {
-        return lote_a->data_expiracao_int - lote_b->data_expiracao_int;
-    }
-    
-    return strcmp(lote_a->lote, lote_b->lote);
+int eh_data_valido(int dia, int mes, int ano, Data data_sistema) {
+    return data_eh_valida(dia, mes, ano) &&
+           data_criar(dia, mes, ano) >= data_sistema;
 }
 
 /**
@@ -472,44 +692,60 @@ void mergeSort(LoteVacina** array_lote, int e, int d) {
 }
 
 /**
- * @brief Lists vaccine batches according to user criteria
+ * @brief Prints one batch as the l command shows it, with given counters
  * 
- * Displays batches sorted by expiration date and batch ID.
- * Can filter by vaccine name(s) if specified.
+ * @param saida Stream to write to
+ * @param lote Batch to print
+ * @param doses Doses left
+ * @param aplicacoes Doses given
+ */
+void imprimir_lote_contado(FILE* saida, LoteVacina* lote, int doses,
+                           int aplicacoes) {
+    char validade[DATA_TEXTO_MAX];
+
+    data_formatar(lote->data_expiracao, validade);
+    fprintf(saida, "%s %s %s %d %d\n", lote->nome, lote->lote, validade,
+            doses, aplicacoes);
+}
+
+/**
+ * @brief Prints one batch as the l command shows it
+ * 
+ * @param saida Stream to write to
+ * @param lote Batch to print
+ */
+void imprimir_lote(FILE* saida, LoteVacina* lote) {
+    imprimir_lote_contado(saida, lote, lote->dosas_disponiveis,
+                          lote->total_aplicacoes);
+}
+
+/**
+ * @brief Reads l's filters and takes the batches to list
+ * 
+ * Batches are copied from the list and sorted by expiration date and
+ * batch ID, with the counters they have now.
+ * 
+ * @param sistema Pointer to the system
+ * @param entrada Stream the arguments are read from
+ * @param saida Stream errors are written to
+ * @param consulta Snapshot being taken, left empty on error
  */
-void listar_vacinas(LoteVacina* lista_vacina, int use_portuguese) {
-    char input_buffer[BUFFER_SIZE];
-    char nome_vacinas[10][NOME_VACINA_MAX]; 
-    int num_nomes = 0;
+void preparar_listar_vacinas(Sistema* sistema, FILE* entrada, FILE* saida,
+                             Consulta* consulta) {
+    LoteVacina* lista_vacina = sistema->lista_vacinas;
+    LoteVacina** array_lotes;
+    char* input_buffer;
     int num_lotes = conta_lote(lista_vacina);
+    unsigned long long inicio;
+    int i;
     
     /* Nothing to list */
     if (num_lotes == 0) {
         return; 
     }
     
-    /* Create array for sorting */
-    LoteVacina** array_lotes = (LoteVacina**)
-        malloc(num_lotes * sizeof(LoteVacina*));
-    if (!array_lotes) {
-        printf(use_portuguese ? "sem memória\n" : "No memory\n");
-        return;
-    }
-    
-    /* Copy list to array for easier sorting */
-    LoteVacina* current = lista_vacina;
-    int i = 0;
-    while (current != NULL) {
-        array_lotes[i++] = current;
-        current = current->next;
-    }
-    
-    /* Sort batches by expiration date and batch ID */
-    mergeSort(array_lotes, 0, num_lotes-1);
-    
     /* Get filter parameters, if any */
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        free(array_lotes);
+    if ((input_buffer = ler_linha(sistema, entrada)) == NULL) {
         return;
     }
     
@@ -524,119 +760,161 @@ void listar_vacinas(LoteVacina* lista_vacina, int use_portuguese) {
     while (*trimmed_input &&
             isspace((unsigned char)*trimmed_input)) trimmed_input++;
     
+    len = strlen(trimmed_input);
+    consulta->linha = (char*)malloc(len + 1);
+    consulta->lotes = (LinhaLote*)malloc(num_lotes * sizeof(LinhaLote));
+    array_lotes = (LoteVacina**)malloc(num_lotes * sizeof(LoteVacina*));
+    if (!consulta->linha || !consulta->lotes || !array_lotes) {
+        free(consulta->linha);
+        free(consulta->lotes);
+        free(array_lotes);
+        consulta->linha = NULL;
+        consulta->lotes = NULL;
+        emitir_mensagem(saida, sistema->mensagens, MSG_SEM_MEMORIA);
+        return;
+    }
+    memcpy(consulta->linha, trimmed_input, len + 1);
+    
     /* Parse vaccine names from input if provided */
-    if (trimmed_input[0] != '\0') {
-        char* nome = strtok(trimmed_input, " ");
-        while (nome != NULL && num_nomes < 10) {
-            strcpy(nome_vacinas[num_nomes], nome);
-            num_nomes++;
+    if (consulta->linha[0] != '\0') {
+        char* nome = strtok(consulta->linha, " ");
+        while (nome != NULL && consulta->num_nomes < 10) {
+            consulta->nomes[consulta->num_nomes++] = nome;
             nome = strtok(NULL, " ");
         }
     }
     
+    /* Copy list to array for easier sorting */
+    LoteVacina* current = lista_vacina;
+    i = 0;
+    while (current != NULL) {
+        array_lotes[i++] = current;
+        current = current->next;
+    }
+    
+    /* Sort batches by expiration date and batch ID */
+    inicio = traco_inicio(sistema->traco);
+    mergeSort(array_lotes, 0, num_lotes-1);
+    traco_fim(sistema->traco, TRACO_ORDENACAO, "mergeSort", inicio);
+    
+    /* Keep the counters as they are now */
+    for (i = 0; i < num_lotes; i++) {
+        LoteVacina* lote = array_lotes[i];
+
+        consulta->lotes[i].lote = lote;
+        consulta->lotes[i].doses = lote->dosas_disponiveis;
+        consulta->lotes[i].aplicacoes = lote->total_aplicacoes;
+    }
+    consulta->num_lotes = num_lotes;
+    free(array_lotes);
+    consulta->vazia = 0;
+}
+
+/**
+ * @brief Lists the batches of an l snapshot
+ * 
+ * Can filter by vaccine name(s) if specified.
+ * 
+ * @param consulta Snapshot taken by preparar_listar_vacinas
+ * @param saida Stream to write to
+ */
+void escrever_vacinas(Consulta* consulta, FILE* saida) {
+    LinhaLote* lotes = consulta->lotes;
+    int num_lotes = consulta->num_lotes;
+    int i;
+    
     /* Show all batches if no filters were provided */
-    if (num_nomes == 0) {
+    if (consulta->num_nomes == 0) {
         for (i = 0; i < num_lotes; i++) {
-            printf("%s %s %02d-%02d-%d %d %d\n", 
-                array_lotes[i]->nome, 
-                array_lotes[i]->lote,
-                array_lotes[i]->dia_de_expiracao, 
-                array_lotes[i]->mes_de_expiracao, 
-                array_lotes[i]->ano_de_expiracao,
-                array_lotes[i]->dosas_disponiveis,
-                array_lotes[i]->total_aplicacoes);
+            imprimir_lote_contado(saida, lotes[i].lote, lotes[i].doses,
+                                  lotes[i].aplicacoes);
         }
     } else {
         /* Show only batches matching filter names */
-        for (int j = 0; j < num_nomes; j++) {
+        for (int j = 0; j < consulta->num_nomes; j++) {
             int found = 0;
             for (i = 0; i < num_lotes; i++) {
-                if (strcmp(array_lotes[i]->nome, nome_vacinas[j]) == 0) {
-                    printf("%s %s %02d-%02d-%d %d %d\n", 
-                           array_lotes[i]->nome, 
-                           array_lotes[i]->lote,
-                           array_lotes[i]->dia_de_expiracao, 
-                           array_lotes[i]->mes_de_expiracao, 
-                           array_lotes[i]->ano_de_expiracao,
-                           array_lotes[i]->dosas_disponiveis,
-                           array_lotes[i]->total_aplicacoes);
+                if (strcmp(lotes[i].lote->nome, consulta->nomes[j]) == 0) {
+                    imprimir_lote_contado(saida, lotes[i].lote,
+                                          lotes[i].doses,
+                                          lotes[i].aplicacoes);
                     found = 1;
                 }
             }
             if (!found) {
-                printf(use_portuguese ? "%s: vacina inexistente\n" : 
-                      "%s: no such vaccine\n", nome_vacinas[j]);
+                emitir_mensagem_nome(saida, consulta->mensagens,
+                                     MSG_VACINA_INEXISTENTE,
+                                     consulta->nomes[j]);
             }
         }
     }
-    
-    free(array_lotes);
+}
+
+/**
+ * @brief Lists vaccine batches according to user criteria
+ * 
+ * Answers from a snapshot right away, as the server does on its reader
+ * thread.
+ */
+void listar_vacinas(Sistema* sistema, FILE* entrada, FILE* saida) {
+    Consulta* consulta = preparar_consulta(sistema, 'l', entrada, saida);
+
+    if (!consulta) {
+        return;
+    }
+    responder_consulta(consulta, saida);
+    terminar_consulta(sistema, consulta);
 }
 
 /**
  * @brief Parses user input for vaccine application
  * 
- * Handles quoted and unquoted user names.
+ * Handles quoted and unquoted user names. The line is split in place,
+ * so both names point into it.
  * 
- * @param nome_usuario Output buffer for user name
- * @param nome_vacina Output buffer for vaccine name
+ * @param linha Arguments of the command
+ * @param nome_usuario Output for the user name
+ * @param nome_vacina Output for the vaccine name, at most 50 characters
  * @return 1 on success, 0 on error
  */
-int obter_dados_aplicacao(char* nome_usuario, char* nome_vacina) {
-    char input_buffer[BUFFER_SIZE];
-    
-    nome_usuario[0] = '\0';
-    nome_vacina[0] = '\0';
-    
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        return 0;
-    }
-    
-    int len = strlen(input_buffer);
-    if (len > 0 && input_buffer[len-1] == '\n') {
-        input_buffer[len-1] = '\0';
+int obter_dados_aplicacao(char* linha, char** nome_usuario,
+                          char** nome_vacina) {
+    int len = strlen(linha);
+    if (len > 0 && linha[len-1] == '\n') {
+        linha[len-1] = '\0';
         len--;
     }
     
+    /* Both names are empty until found */
+    *nome_usuario = linha + len;
+    *nome_vacina = linha + len;
+    
     /* Skip initial whitespace */
-    char* p = input_buffer;
+    char* p = linha;
     while (*p && isspace((unsigned char)*p)) p++;
     
     /* Handle quoted user names */
     if (*p == '"') {
         p++; 
-        char* end_quote = strchr(p, '"');
+        char* end_quote = varrer_byte(p, linha + len, '"');
         
         if (end_quote == NULL) {
             return 0;
         }
         
-        int name_len = end_quote - p;
-        if (name_len >= BUFFER_SIZE) {
-            name_len = BUFFER_SIZE - 1; 
-        }
-        
-        memcpy(nome_usuario, p, name_len);
-        nome_usuario[name_len] = '\0';
-        
+        *end_quote = '\0';
+        *nome_usuario = p;
         p = end_quote + 1;
     } else {
         /* Handle unquoted user names */
-        char* space = strchr(p, ' ');
+        char* space = varrer_byte(p, linha + len, ' ');
+        *nome_usuario = p;
         if (space == NULL) {
-            memcpy(nome_usuario, p, BUFFER_SIZE - 1);
-            nome_usuario[BUFFER_SIZE - 1] = '\0';
             return 1;
         }
         
-        int name_len = space - p;
-        if (name_len >= BUFFER_SIZE) {
-            name_len = BUFFER_SIZE - 1; 
-        }
-        memcpy(nome_usuario, p, name_len);
-        nome_usuario[name_len] = '\0';
-        
-        p = space;
+        *space = '\0';
+        p = space + 1;
     }
     
     /* Skip whitespace after user name */
@@ -646,9 +924,11 @@ int obter_dados_aplicacao(char* nome_usuario, char* nome_vacina) {
         return 1;
     }
     
-    /* Get vaccine name - limited to 50 chars + null terminator */
-    memcpy(nome_vacina, p, 50);
-    nome_vacina[50] = '\0';
+    /* Get vaccine name - limited to 50 chars */
+    if (strlen(p) > 50) {
+        p[50] = '\0';
+    }
+    *nome_vacina = p;
     
     return 1;
 }
@@ -657,39 +937,18 @@ int obter_dados_aplicacao(char* nome_usuario, char* nome_vacina) {
  * @brief Finds oldest valid batch of a specific vaccine
  * 
  * Returns batch that expires soonest but is still valid.
- * Only considers batches with available doses.
+ * The active list only holds batches with available doses that
+ * have not expired, so the answer is always at its head.
  * 
- * @param lista_vacina Head of batch list
+ * @param indice Batch index
  * @param nome_vacina Name of vaccine to find
- * @param dia_atual Current system day
- * @param mes_atual Current system month
- * @param ano_atual Current system year
  * @return Pointer to found batch or NULL if none available
  */
-LoteVacina* encontrar_lote_mais_antigo(LoteVacina* lista_vacina,
-                                     char* nome_vacina, int dia_atual,
-                                     int mes_atual, int ano_atual) {
-    LoteVacina* current = lista_vacina;
-    LoteVacina* lote_mais_antigo = NULL;
-    int data_atual_int = ddmmyy_int(dia_atual, mes_atual, ano_atual);
+LoteVacina* encontrar_lote_mais_antigo(IndiceLotes* indice,
+                                     char* nome_vacina) {
+    Vacina* vacina = procurar_vacina(indice, nome_vacina);
 
-    while (current != NULL) {
-        if (strcmp(current->nome, nome_vacina) == 0) {
-            /* Check if batch is valid and has doses */
-            if (current->dosas_disponiveis > 0 &&
-               data_atual_int <= current->data_expiracao_int) {             
-                /* Track oldest valid batch */
-                if (lote_mais_antigo == NULL || 
-                    current->data_expiracao_int < 
-                    lote_mais_antigo->data_expiracao_int) {
-                    lote_mais_antigo = current;
-                }
-            }
-        }
-        current = current->next;
-    }
-    
-    return lote_mais_antigo;
+    return vacina ? vacina->ativos : NULL;
 }
 /**
  * @brief Applies a vaccine dose to a user
@@ -697,63 +956,77 @@ LoteVacina* encontrar_lote_mais_antigo(LoteVacina* lista_vacina,
  * Finds oldest valid batch and records application.
  * Handles validation and error cases.
  */
-void aplicar_dose_vacina(LoteVacina* lista_vacina, User** lista_user,
-                         HojeVaxTable* vax_table_hoje, int dia_atual,
-                         int mes_atual, int ano_atual, int use_portuguese) {
-    char nome_usuario[BUFFER_SIZE];
-    char nome_vacina[51];
-    
-    if (!obter_dados_aplicacao(nome_usuario, nome_vacina)) {
+void aplicar_dose_vacina(Sistema* sistema, FILE* entrada, FILE* saida) {
+    IndiceLotes* indice = sistema->indice_lotes;
+    Data data_atual = sistema->data_sistema;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* linha = ler_linha(sistema, entrada);
+    char* nome_usuario;
+    char* nome_vacina;
+    unsigned long long inicio = traco_inicio_comando(sistema->traco);
+    int lido = linha != NULL &&
+               obter_dados_aplicacao(linha, &nome_usuario, &nome_vacina);
+    int vacinado;
+    
+    inicio = traco_fim(sistema->traco, TRACO_LEITURA,
+                       "obter_dados_aplicacao", inicio);
+    if (!lido) {
         return;
     }
     
-    /* Make sure vaccination table is current */
-    reset_table_hoje(vax_table_hoje, dia_atual, mes_atual, ano_atual);
-    
     /* Check if user already got this vaccine today */
-    if (eh_vacinado_hoje(vax_table_hoje, nome_usuario, nome_vacina)) {
-        printf(use_portuguese ? "já vacinado\n" : "already vaccinated\n");
+    vacinado = eh_vacinado_hoje(sistema->indice_utentes, nome_usuario,
+                                procurar_vacina(indice, nome_vacina),
+                                data_atual);
+    inicio = traco_fim(sistema->traco, TRACO_PROCURA, "eh_vacinado_hoje",
+                       inicio);
+    if (vacinado) {
+        emitir_mensagem(saida, mensagens, MSG_JA_VACINADO);
         return;
     }
     
     /* Find oldest valid batch with doses */
-    LoteVacina* lote = encontrar_lote_mais_antigo(lista_vacina, nome_vacina,
-                                dia_atual, mes_atual, ano_atual);
+    LoteVacina* lote = encontrar_lote_mais_antigo(indice, nome_vacina);
+    traco_fim(sistema->traco, TRACO_PROCURA, "encontrar_lote_mais_antigo",
+              inicio);
     
     if (lote == NULL) {
-        printf(use_portuguese ? "esgotado\n" : "no stock\n");
+        emitir_mensagem(saida, mensagens, MSG_ESGOTADO);
         return;
     }
     
     /* Update batch info */
     lote->dosas_disponiveis--;
     lote->total_aplicacoes++;
+    lote->vacina->doses_disponiveis--;
+    lote->vacina->doses_aplicadas++;
+    if (lote->dosas_disponiveis == 0) {
+        desativar_lote(lote);
+    }
     
     /* Record vaccination */
-    aplicar_vacina(lista_user, nome_usuario, nome_vacina, lote->lote,
-                  dia_atual, mes_atual, ano_atual);
+    User* registo = aplicar_vacina(&sistema->lista_users, sistema->arena,
+                                   sistema->filtro_utentes, nome_usuario,
+                                   lote->vacina->nome, lote->lote,
+                                   data_atual);
     
     /* Track today's vaccination to prevent duplicates */
-    recorde_vacinacao_hoje(vax_table_hoje, nome_usuario, nome_vacina);
+    recorde_vacinacao_hoje(sistema->indice_utentes, nome_usuario,
+                           lote->vacina, data_atual);
+    dias_adicionar(sistema->indice_dias, registo);
     
-    printf("%s\n", lote->lote);
+    fprintf(saida, "%s\n", lote->lote);
 }
 
 /**
  * @brief Gets batch ID from user input for removal
  * 
+ * @param linha Arguments of the command
  * @param lote Output buffer for batch ID
  * @return 1 if successful, 0 on error
  */
-int obter_dados_retirada(char* lote) {
-    char input_buffer[BUFFER_SIZE];
-
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        printf("buffer size reached\n");
-        return 0;
-    }
-
-    int input_c = sscanf(input_buffer, " %20s", lote);
+int obter_dados_retirada(char* linha, char* lote) {
+    int input_c = sscanf(linha, " %20s", lote);
     return (input_c == 1);
 }
 
@@ -761,12 +1034,13 @@ int obter_dados_retirada(char* lote) {
  * @brief Counts applications from a specific batch
  * 
  * @param lista_user Head of user list
+ * @param versao Current version of the list
  * @param lote Batch ID to count
  * @param lista_vacina Batch list to find vaccine name
  * @return Number of applications from this batch
  */
-int contar_aplicacoes_lote(User* lista_user, char* lote,
-                          LoteVacina* lista_vacina) {
+int contar_aplicacoes_lote(User* lista_user, unsigned long versao,
+                           char* lote, LoteVacina* lista_vacina) {
     LoteVacina* current_lote = lista_vacina;
     char nome_vacina_lote[51];
     int encontrado = 0;
@@ -790,7 +1064,8 @@ int contar_aplicacoes_lote(User* lista_user, char* lote,
     User* current = lista_user;
     
     while (current != NULL) {
-        if (strcmp(current->nome_vacina, nome_vacina_lote) == 0) {
+        if (eh_registo_visivel(current, versao) &&
+            strcmp(current->nome_vacina, nome_vacina_lote) == 0) {
             contador++;
         }
         current = current->next;
@@ -802,12 +1077,16 @@ int contar_aplicacoes_lote(User* lista_user, char* lote,
 /**
  * @brief Removes a batch from the list
  * 
- * Handles both head node and interior node cases.
+ * Handles both head node and interior node cases. A snapshot may still
+ * hold the batch, so it is only freed once no pinned epoch can reach it.
  * 
  * @param lista_vacina Pointer to head pointer of batch list
+ * @param indice Batch index the batch is also removed from
+ * @param epocas Epochs the batch is retired to
  * @param lote Batch ID to remove
  */
-void remover_lote(LoteVacina** lista_vacina, char* lote) {
+void remover_lote(LoteVacina** lista_vacina, IndiceLotes* indice,
+                  Epocas* epocas, char* lote) {
     LoteVacina* current = *lista_vacina;
     LoteVacina* previous = NULL;
     
@@ -819,7 +1098,9 @@ void remover_lote(LoteVacina** lista_vacina, char* lote) {
                 previous->next = current->next;
             }
             
-            free(current);
+            desindexar_lote(indice, current);
+            epoca_retirar(epocas, current, free);
+            epoca_recolher(epocas);
             return;
         }
         
@@ -834,11 +1115,23 @@ void remover_lote(LoteVacina** lista_vacina, char* lote) {
  * Either completely removes batch or marks it as having
  * no more available doses depending on usage.
  */
-void retirar_disponibilidade(LoteVacina** lista_vacina, User* lista_user,
-                             int use_portuguese) {
+void retirar_disponibilidade(Sistema* sistema, FILE* entrada, FILE* saida) {
+    LoteVacina** lista_vacina = &sistema->lista_vacinas;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* linha = ler_linha(sistema, entrada);
     char lote[21];
+    unsigned long long inicio;
+    int lido;
     
-    if (!obter_dados_retirada(lote)) {
+    if (linha == NULL) {
+        emitir_mensagem(saida, mensagens, MSG_FIM_ENTRADA);
+        return;
+    }
+    inicio = traco_inicio_comando(sistema->traco);
+    lido = obter_dados_retirada(linha, lote);
+    inicio = traco_fim(sistema->traco, TRACO_LEITURA, "obter_dados_retirada",
+                       inicio);
+    if (!lido) {
         return;
     }
     
@@ -853,44 +1146,46 @@ void retirar_disponibilidade(LoteVacina** lista_vacina, User* lista_user,
         }
         current = current->next;
     }
+    traco_fim(sistema->traco, TRACO_PROCURA, "procurar_lote", inicio);
     
     if (batch_to_update == NULL) {
-        printf(use_portuguese ? "%s: lote inexistente\n" : 
-              "%s: no such batch\n", lote);
+        emitir_mensagem_nome(saida, mensagens, MSG_LOTE_INEXISTENTE, lote);
         return;
     }
     
     /* Count applications from this batch */
-    int aplicacoes = contar_aplicacoes_lote(lista_user, lote, *lista_vacina);
+    int aplicacoes = contar_aplicacoes_lote(sistema->lista_users,
+                                            sistema->versao, lote,
+                                            *lista_vacina);
+
+    /* Sealed applications are counted by their segments' summaries */
+    aplicacoes += frio_contar_vacina(sistema->frio, batch_to_update->vacina);
     
     if (aplicacoes == 0) {
         /* Remove batch entirely if never used */
-        remover_lote(lista_vacina, lote);
+        remover_lote(lista_vacina, sistema->indice_lotes, sistema->epocas,
+                     lote);
     } else {
         /* Mark batch as having no more available doses */
+        desativar_lote(batch_to_update);
         batch_to_update->dosas_disponiveis = 0;
     }
     
-    printf("%d\n", aplicacoes);
+    fprintf(saida, "%d\n", aplicacoes);
 }
 
 /**
  * @brief Parses time advancement input from user
  * 
+ * @param linha Arguments of the command
  * @param dia Output for day
  * @param mes Output for month
  * @param ano Output for year
  * @return 1 if successful, 0 on error
  */
-int obter_dados_avanco_tempo(int* dia, int* mes, int* ano) {
-    char input_buffer[BUFFER_SIZE];
-
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        return 0;
-    }
-    
+int obter_dados_avanco_tempo(char* linha, int* dia, int* mes, int* ano) {
     /* Handle empty input (just show current date) */
-    char* trimmed = input_buffer;
+    char* trimmed = linha;
     while (isspace((unsigned char)*trimmed)) trimmed++;
     
     if (*trimmed == '\0' || *trimmed == '\n') {
@@ -912,32 +1207,12 @@ int obter_dados_avanco_tempo(int* dia, int* mes, int* ano) {
  * @param dia Day to check
  * @param mes Month to check
  * @param ano Year to check
- * @param dia_atual Current system day
- * @param mes_atual Current system month
- * @param ano_atual Current system year
+ * @param data_atual Current system date
  * @return 1 if valid, 0 otherwise
  */
-int eh_data_avanco_valido(int dia, int mes, int ano, int dia_atual,
-                         int mes_atual, int ano_atual) {
-    /* Compare with current date */
-    int data_atual = ddmmyy_int(dia_atual, mes_atual, ano_atual);
-    int data_avanco = ddmmyy_int(dia, mes, ano);
-
-    if (data_avanco < data_atual) return 0;
-    
-    /* Basic validity checks */
-    if (mes < 1 || mes > 12) return 0;
-    
-    /* Check days in month including leap years */
-    int dias_mes[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    
-    if (mes == 2 && (ano % 4 == 0 && (ano % 100 != 0 || ano % 400 == 0))) {
-        dias_mes[2] = 29;
-    }
-    
-    if (dia < 1 || dia > dias_mes[mes]) return 0;
-    
-    return 1;
+int eh_data_avanco_valido(int dia, int mes, int ano, Data data_atual) {
+    return data_eh_valida(dia, mes, ano) &&
+           data_criar(dia, mes, ano) >= data_atual;
 }
 
 /**
@@ -945,103 +1220,108 @@ int eh_data_avanco_valido(int dia, int mes, int ano, int dia_atual,
  * 
  * Can show current date or set a new future date
  */
-void avancar_tempo(int* dia_sistema, int* mes_sistema, int* ano_sistema,
-                  HojeVaxTable* vax_table_hoje, int use_portuguese) {
+void avancar_tempo(Sistema* sistema, FILE* entrada, FILE* saida) {
+    Data* data_sistema = &sistema->data_sistema;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* linha = ler_linha(sistema, entrada);
+    char texto_data[DATA_TEXTO_MAX];
     int dia, mes, ano;
+    unsigned long long inicio = traco_inicio_comando(sistema->traco);
+    int lido = linha != NULL &&
+               obter_dados_avanco_tempo(linha, &dia, &mes, &ano);
     
-    if (!obter_dados_avanco_tempo(&dia, &mes, &ano)) {
+    traco_fim(sistema->traco, TRACO_LEITURA, "obter_dados_avanco_tempo",
+              inicio);
+    if (!lido) {
         return;
     }
     
     /* Just display current date when no arguments */
     if (dia == 0 && mes == 0 && ano == 0) {
-        printf("%02d-%02d-%d\n", *dia_sistema, *mes_sistema, *ano_sistema);
+        data_formatar(*data_sistema, texto_data);
+        fprintf(saida, "%s\n", texto_data);
         return;
     }
     
     /* Validate new date */
-    if (!eh_data_avanco_valido(dia, mes, ano, *dia_sistema, *mes_sistema,
-                              *ano_sistema)) {
-        printf(use_portuguese ? "data inválida\n" : "invalid date\n");
+    if (!eh_data_avanco_valido(dia, mes, ano, *data_sistema)) {
+        emitir_mensagem(saida, mensagens, MSG_DATA_INVALIDA);
         return;
     }
     
     /* Update system date */
-    *dia_sistema = dia;
-    *mes_sistema = mes;
-    *ano_sistema = ano;
+    *data_sistema = data_criar(dia, mes, ano);
     
-    /* Clear today's vaccination records */
-    reset_table_hoje(vax_table_hoje, dia, mes, ano);
+    /* Move batches that expired out of dose selection */
+    expirar_lotes(sistema->indice_lotes, *data_sistema);
+
+    /* Seal old applications, unless a snapshot may still reach them */
+    if (sistema->frio && !sistema->consultas) {
+        selar_aplicacoes(sistema->frio, &sistema->lista_users,
+                         sistema->indice_dias, sistema->indice_lotes,
+                         *data_sistema);
+    }
     
-    printf("%02d-%02d-%d\n", *dia_sistema, *mes_sistema, *ano_sistema);
+    data_formatar(*data_sistema, texto_data);
+    fprintf(saida, "%s\n", texto_data);
 }
 
 /**
  * @brief Parses input for deleting vaccination records
  * 
  * Handles three formats: just username, username+date, or username+date+batch
- * Deals with both quoted and unquoted usernames
+ * Deals with both quoted and unquoted usernames. The line is split in
+ * place, so the username and the batch ID point into it.
  * 
- * @param nome_usuario Output buffer for username
+ * @param linha Arguments of the command
+ * @param nome_usuario Output for username
  * @param dia Output for day component (0 if not provided)
  * @param mes Output for month component (0 if not provided)
  * @param ano Output for year component (0 if not provided)
- * @param lote Output buffer for batch ID (empty if not provided)
+ * @param lote Output for batch ID (empty if not provided)
  * @return 1 if parsing succeeded, 0 on failure
  */
-int obter_dados_apagar(char* nome_usuario, int* dia, int* mes, int* ano,
-                      char* lote) {
-    char input_buffer[BUFFER_SIZE];
+int obter_dados_apagar(char* linha, char** nome_usuario, int* dia, int* mes,
+                       int* ano, char** lote) {
     *dia = 0;
     *mes = 0;
     *ano = 0;
-    lote[0] = '\0';  
 
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        return 0;
+    int len = strlen(linha);
+    if (len > 0 && linha[len-1] == '\n') {
+        linha[len-1] = '\0';
+        len--;
     }
     
-    int len = strlen(input_buffer);
-    if (len > 0 && input_buffer[len-1] == '\n') {
-        input_buffer[len-1] = '\0';
-        len--;
-    }
+    /* The username and batch ID are empty until found */
+    *nome_usuario = linha + len;
+    *lote = linha + len;
     
     /* Skip leading whitespace */
-    char* ptr = input_buffer;
+    char* ptr = linha;
     while (*ptr && isspace((unsigned char)*ptr)) ptr++;
     
     /* Handle quoted username */
     if (*ptr == '"') {
         ptr++; 
-        char* end_quote = strchr(ptr, '"');
+        char* end_quote = varrer_byte(ptr, linha + len, '"');
         
         if (end_quote == NULL) {
             return 0;
         }
         
-        int name_len = end_quote - ptr;
-        if (name_len >= BUFFER_SIZE) name_len = BUFFER_SIZE-1;
-        
-        memcpy(nome_usuario, ptr, name_len);
-        nome_usuario[name_len] = '\0';
-        
+        *end_quote = '\0';
+        *nome_usuario = ptr;
         ptr = end_quote + 1;
     } else {
         /* Handle unquoted username */
-        char* space = strchr(ptr, ' ');
+        char* space = varrer_byte(ptr, linha + len, ' ');
+        *nome_usuario = ptr;
         if (space == NULL) {
-            strcpy(nome_usuario, ptr);
             return 1;
         }
         
-        int name_len = space - ptr;
-        if (name_len >= BUFFER_SIZE) name_len = BUFFER_SIZE-1; 
-        
-        memcpy(nome_usuario, ptr, name_len);
-        nome_usuario[name_len] = '\0';
-        
+        *space = '\0';
         ptr = space + 1;
     }
     
@@ -1061,7 +1341,7 @@ int obter_dados_apagar(char* nome_usuario, int* dia, int* mes, int* ano,
     }
     
     /* Look for batch ID after date */
-    ptr = strchr(date_start, ' ');
+    ptr = varrer_byte(date_start, linha + len, ' ');
     if (ptr == NULL) {
         return 1; /* No batch ID provided */
     }
@@ -1070,7 +1350,7 @@ int obter_dados_apagar(char* nome_usuario, int* dia, int* mes, int* ano,
     while (*ptr && isspace((unsigned char)*ptr)) ptr++;
     
     if (*ptr != '\0') {
-        strcpy(lote, ptr);
+        *lote = ptr;
     }
     
     return 1;
@@ -1083,117 +1363,71 @@ int obter_dados_apagar(char* nome_usuario, int* dia, int* mes, int* ano,
  * @param dia Day to check
  * @param mes Month to check
  * @param ano Year to check
- * @param dia_atual Current system day
- * @param mes_atual Current system month
- * @param ano_atual Current system year
+ * @param data_atual Current system date
  * @return 1 if valid, 0 otherwise
  */
-int eh_data_delecao_valida(int dia, int mes, int ano, int dia_atual,
-                          int mes_atual, int ano_atual) {
+int eh_data_delecao_valida(int dia, int mes, int ano, Data data_atual) {
     /* Special case - no date provided */
     if (dia == 0 && mes == 0 && ano == 0) {
         return 1;
     }
     
-    /* Date must not be in the future */
-    if (ano > ano_atual) return 0;
-    if (ano == ano_atual && mes > mes_atual) return 0;
-    if (ano == ano_atual && mes == mes_atual && dia > dia_atual) return 0;
-    
-    /* Basic validity checks */
-    if (mes < 1 || mes > 12) return 0;
-    
-    /* Days in month validity */
-    int dias_mes[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    
-    if (mes == 2 && (ano % 4 == 0 && (ano % 100 != 0 || ano % 400 == 0))) {
-        dias_mes[2] = 29;
-    }
-    
-    if (dia < 1 || dia > dias_mes[mes]) return 0;
-    
-    return 1;
+    /* Date must exist and not be in the future */
+    return data_eh_valida(dia, mes, ano) &&
+           data_criar(dia, mes, ano) <= data_atual;
 }
 
 /**
  * @brief Deletes vaccination records based on criteria
  * 
- * Helper function that does the actual deletion work
+ * Helper function that does the actual deletion work. apagar_aplicacoes
+ * has already checked that the user and the batch exist.
  * 
- * @param lista_user Pointer to head pointer of user list
+ * @param sistema Pointer to the system
  * @param nome_usuario Username to filter by
  * @param dia Day to filter by (0 for any day)
  * @param mes Month to filter by (0 for any month)
  * @param ano Year to filter by (0 for any year)
  * @param lote Batch ID to filter by (empty for any batch)
- * @param lista_vacina Batch list (needed to lookup vaccine names)
  * @return Number of records deleted
  */
-int apagar_registros(User** lista_user, char* nome_usuario, int dia, int mes,
-                     int ano, char* lote, LoteVacina* lista_vacina) {
+int apagar_registros(Sistema* sistema, char* nome_usuario,
+                     int dia, int mes, int ano, char* lote) {
+    User** lista_user = &sistema->lista_users;
+    FiltroBloom* filtro = sistema->filtro_utentes;
+    LoteVacina* lista_vacina = sistema->lista_vacinas;
     User* current = *lista_user;
     User* prev = NULL;
     int contador = 0;
-    
-    /* Check if batch exists when provided */
-    if (lote[0] != '\0') {
-        int batch_existe = 0;
-        LoteVacina* batch_check = lista_vacina;
-        
-        while (batch_check != NULL) {
-            if (strcmp(batch_check->lote, lote) == 0) {
-                batch_existe = 1;
-                break;
-            }
-            batch_check = batch_check->next;
-        }
-        
-        if (!batch_existe) {
-            printf("%s: no such batch\n", lote);
-            return 0;
-        }
-    }
-    
-    /* Validate that user exists in records */
-    int user_existe = 0;
-    User* user_check = *lista_user;
-    
-    while (user_check != NULL) {
-        if (strcmp(user_check->nome, nome_usuario) == 0) {
-            user_existe = 1;
-            break;
-        }
-        user_check = user_check->next;
-    }
-    
-    if (!user_existe) {
-        printf("%s: no such user\n", nome_usuario);
-        return 0;
-    }
+    Data data = dia != 0 ? data_criar(dia, mes, ano) : 0;
+
+    /* Snapshots still walk the list, so records are marked, not unlinked */
+    int marcar = sistema->consultas != NULL;
     
     /* Traverse list and delete matching records */
+    if (marcar) {
+        sistema->versao++;
+    }
+
     while (current != NULL) {
         int should_delete = 0;
         
-        if (strcmp(current->nome, nome_usuario) == 0) {
+        if (eh_registo_visivel(current, sistema->versao) &&
+            strcmp(current->nome, nome_usuario) == 0) {
             /* Case 1: Delete all records for this user */
             if (dia == 0 && mes == 0 && ano == 0 && lote[0] == '\0') {
                 should_delete = 1;
             }
             /* Case 2: Delete records for this user on specific date */
             else if (dia != 0 && lote[0] == '\0') {
-                if (current->dia_de_applicacao == dia && 
-                    current->mes_de_aplicacao == mes && 
-                    current->ano_de_aplicacao == ano) {
+                if (current->data_aplicacao == data) {
                     should_delete = 1;
                 }
             }
             /* Case 3: Delete records for this user on specific date with
             specific batch */
             else if (dia != 0 && lote[0] != '\0') {
-                if (current->dia_de_applicacao == dia && 
-                    current->mes_de_aplicacao == mes && 
-                    current->ano_de_aplicacao == ano) {
+                if (current->data_aplicacao == data) {
                     
                     /* Need to find vaccine name for this batch */
                     LoteVacina* temp = lista_vacina;
@@ -1218,7 +1452,12 @@ int apagar_registros(User** lista_user, char* nome_usuario, int dia, int mes,
             User* to_delete = current;
           
             /* Update list pointers */
-            if (prev == NULL) {
+            if (marcar) {
+                marcar_apagado(current, sistema->versao);
+                sistema->apagados_pendentes++;
+                prev = current;
+                current = current->next;
+            } else if (prev == NULL) {
                 *lista_user = current->next;
                 current = *lista_user;
             } else {
@@ -1226,14 +1465,49 @@ int apagar_registros(User** lista_user, char* nome_usuario, int dia, int mes,
                 current = current->next;
             }
             
+            /* Keep the aggregate counters in step */
+            Vacina* vacina = procurar_vacina(sistema->indice_lotes,
+                                             to_delete->nome_vacina);
+            if (vacina) {
+                vacina->doses_aplicadas--;
+            }
+            dias_remover(sistema->indice_dias, to_delete);
+            
             /* Free memory and count deletion */
-            free(to_delete);
+            bloom_remover(filtro, to_delete->nome);
+            if (!marcar) {
+                libertar_user(to_delete);
+            }
             contador++;
         } else {
             prev = current;
             current = current->next;
         }
     }
+
+    /* Sealed records matching the same cases get deleted in their segments */
+    if (dia == 0 && mes == 0 && ano == 0 && lote[0] == '\0') {
+        contador += frio_apagar(sistema->frio, nome_usuario, 0, NULL,
+                                sistema->versao, sistema->epocas,
+                                sistema->indice_lotes, sistema->indice_dias,
+                                filtro);
+    } else if (dia != 0) {
+        const char* vacina_lote = NULL;
+
+        if (lote[0] != '\0') {
+            LoteVacina* temp = lista_vacina;
+
+            while (temp != NULL && strcmp(temp->lote, lote) != 0) {
+                temp = temp->next;
+            }
+            vacina_lote = temp ? temp->nome : "";
+        }
+        contador += frio_apagar(sistema->frio, nome_usuario, data,
+                                vacina_lote, sistema->versao,
+                                sistema->epocas, sistema->indice_lotes,
+                                sistema->indice_dias, filtro);
+    }
+    descontar_aplicacoes(sistema->indice_utentes, nome_usuario, contador);
     
     return contador;
 }
@@ -1243,39 +1517,55 @@ int apagar_registros(User** lista_user, char* nome_usuario, int dia, int mes,
  * 
  * Main function that processes input and calls helper functions
  */
-void apagar_aplicacoes(User** lista_user, LoteVacina* lista_vacina,
-                      int dia_atual, int mes_atual, int ano_atual,
-                      int use_portuguese) {
-    char nome_usuario[BUFFER_SIZE];
+void apagar_aplicacoes(Sistema* sistema, FILE* entrada, FILE* saida) {
+    User** lista_user = &sistema->lista_users;
+    FiltroBloom* filtro = sistema->filtro_utentes;
+    LoteVacina* lista_vacina = sistema->lista_vacinas;
+    Data data_atual = sistema->data_sistema;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* linha = ler_linha(sistema, entrada);
+    char* nome_usuario;
     int dia, mes, ano;
-    char lote[21];
-    
-    if (!obter_dados_apagar(nome_usuario, &dia, &mes, &ano, lote)) {
+    char* lote;
+    unsigned long long inicio = traco_inicio_comando(sistema->traco);
+    int lido = linha != NULL &&
+               obter_dados_apagar(linha, &nome_usuario, &dia, &mes, &ano,
+                                  &lote);
+    
+    traco_fim(sistema->traco, TRACO_LEITURA, "obter_dados_apagar", inicio);
+    if (!lido) {
         return;
     }
     
     /* Validate date if provided */
-    if (dia != 0 && !eh_data_delecao_valida(dia, mes, ano, dia_atual,
-                                            mes_atual, ano_atual)) {
-        printf(use_portuguese ? "data inválida\n" : "invalid date\n");
+    if (dia != 0 && !eh_data_delecao_valida(dia, mes, ano, data_atual)) {
+        emitir_mensagem(saida, mensagens, MSG_DATA_INVALIDA);
         return;
     }
     
-    /* Check if user exists */
+    /* Check if user exists, skipping the scan for users the filter rules out */
     int user_exists = 0;
-    User* user_check = *lista_user;
+    User* user_check = bloom_pode_conter(filtro, nome_usuario) ?
+                       *lista_user : NULL;
     
+    inicio = traco_inicio(sistema->traco);
     while (user_check != NULL) {
-        if (strcmp(user_check->nome, nome_usuario) == 0) {
+        if (eh_registo_visivel(user_check, sistema->versao) &&
+            strcmp(user_check->nome, nome_usuario) == 0) {
             user_exists = 1;
             break;
         }
         user_check = user_check->next;
     }
+    if (!user_exists && bloom_pode_conter(filtro, nome_usuario)) {
+        user_exists = frio_tem_utente(sistema->frio, nome_usuario,
+                                      sistema->versao);
+    }
+    traco_fim(sistema->traco, TRACO_PROCURA, "procurar_utente", inicio);
     
     if (!user_exists) {
-        printf(use_portuguese ? "%s: utente inexistente\n" :
-              "%s: no such user\n", nome_usuario);
+        emitir_mensagem_nome(saida, mensagens, MSG_UTENTE_INEXISTENTE,
+                             nome_usuario);
         return;
     }
     
@@ -1293,44 +1583,38 @@ void apagar_aplicacoes(User** lista_user, LoteVacina* lista_vacina,
         }
         
         if (!batch_exists) {
-            printf(use_portuguese ? "%s: lote inexistente\n" : 
-                  "%s: no such batch\n", lote);
+            emitir_mensagem_nome(saida, mensagens, MSG_LOTE_INEXISTENTE, lote);
             return;
         }
     }
     
     /* Perform deletions */
-    int deleted = apagar_registros(lista_user, nome_usuario, dia, mes, ano,
-                                  lote, lista_vacina);
+    int deleted = apagar_registros(sistema, nome_usuario, dia, mes, ano,
+                                   lote);
     
-    printf("%d\n", deleted);
+    fprintf(saida, "%d\n", deleted);
 }
 
 /**
  * @brief Parses input for listing applications
  * 
  * Handles both empty input and username specification
- * Supports quoted and unquoted usernames
+ * Supports quoted and unquoted usernames, found in place in the line
  * 
- * @param nome_usuario Output buffer for username (empty if not provided)
+ * @param linha Arguments of the command
+ * @param nome_usuario Output for username (empty if not provided)
  * @return 1 if successful, 0 on error
  */
-int obter_dados_listar_usuarios(char* nome_usuario) {
-    char input_buffer[BUFFER_SIZE];
-    nome_usuario[0] = '\0';  
-
-    if (fgets(input_buffer, BUFFER_SIZE, stdin) == NULL) {
-        return 0;
-    }
-    
-    int len = strlen(input_buffer);
-    if (len > 0 && input_buffer[len-1] == '\n') {
-        input_buffer[len-1] = '\0';
+int obter_dados_listar_usuarios(char* linha, char** nome_usuario) {
+    int len = strlen(linha);
+    if (len > 0 && linha[len-1] == '\n') {
+        linha[len-1] = '\0';
         len--;
     }
+    *nome_usuario = linha + len;
     
     /* Skip whitespace */
-    char* trimmed = input_buffer;
+    char* trimmed = linha;
     while (*trimmed && isspace((unsigned char)*trimmed)) trimmed++;
     
     if (*trimmed == '\0') {
@@ -1340,20 +1624,15 @@ int obter_dados_listar_usuarios(char* nome_usuario) {
     /* Handle quoted username */
     if (*trimmed == '"') {
         trimmed++; 
-        char* end_quote = strchr(trimmed, '"');
+        char* end_quote = varrer_byte(trimmed, linha + len, '"');
         
         if (end_quote == NULL) {
             return 0;
         }
         
-        int name_len = end_quote - trimmed;
-        if (name_len >= BUFFER_SIZE) name_len = BUFFER_SIZE-1; 
-        memcpy(nome_usuario, trimmed, name_len);
-        nome_usuario[name_len] = '\0';
-    } else {
-        /* Handle unquoted username */
-        strcpy(nome_usuario, trimmed);
+        *end_quote = '\0';
     }
+    *nome_usuario = trimmed;
     
     return 1;
 }
@@ -1370,23 +1649,8 @@ int obter_dados_listar_usuarios(char* nome_usuario) {
 int comparar_aplicacoes_por_data(const void* a, const void* b) {
     User* user_a = *((User**)a);
     User* user_b = *((User**)b);
-    
-    /* Sort by year first */
-    if (user_a->ano_de_aplicacao != user_b->ano_de_aplicacao) {
-        return user_a->ano_de_aplicacao - user_b->ano_de_aplicacao;
-    }
-    
-    /* Then by month */
-    if (user_a->mes_de_aplicacao != user_b->mes_de_aplicacao) {
-        return user_a->mes_de_aplicacao - user_b->mes_de_aplicacao;
-    }
-    
-    /* Then by day */
-    if (user_a->dia_de_applicacao != user_b->dia_de_applicacao) {
-        return user_a->dia_de_applicacao - user_b->dia_de_applicacao;
-    }
 
-    return 0;
+    return user_a->data_aplicacao - user_b->data_aplicacao;
 }
 
 /**
@@ -1448,34 +1712,116 @@ char* encontrar_lote_por_vacina(LoteVacina* lista_vacina, char* nome_vacina) {
 }
 
 /**
- * @brief Lists vaccination applications
+ * @brief Reads u's user and takes the head of the application list
  * 
- * Lists all applications or only those for a specific user
- * Sorts by date of application
+ * The filter of users is only consulted here, as the writer keeps
+ * changing it.
+ * 
+ * @param sistema Pointer to the system
+ * @param entrada Stream the arguments are read from
+ * @param saida Stream errors are written to
+ * @param consulta Snapshot being taken, left empty on error
  */
-void listar_aplicacoes(User* lista_user, int use_portuguese){
-    char nome_usuario[BUFFER_SIZE];
+void preparar_listar_aplicacoes(Sistema* sistema, FILE* entrada,
+                                FILE* saida, Consulta* consulta) {
+    char* linha = ler_linha(sistema, entrada);
+    char* nome_usuario;
+    size_t len;
+    unsigned long long inicio = traco_inicio_comando(sistema->traco);
+    int lido = linha != NULL &&
+               obter_dados_listar_usuarios(linha, &nome_usuario);
+    
+    traco_fim(sistema->traco, TRACO_LEITURA, "obter_dados_listar_usuarios",
+              inicio);
+    if (!lido) {
+        return;
+    }
     
-    if (!obter_dados_listar_usuarios(nome_usuario)) {
+    len = strlen(nome_usuario);
+    consulta->nome_usuario = (char*)malloc(len + 1);
+    if (!consulta->nome_usuario) {
+        emitir_mensagem(saida, sistema->mensagens, MSG_SEM_MEMORIA);
         return;
     }
+    memcpy(consulta->nome_usuario, nome_usuario, len + 1);
+    
+    consulta->utente_ausente = nome_usuario[0] != '\0' &&
+        !bloom_pode_conter(sistema->filtro_utentes, nome_usuario);
+    consulta->aplicacoes = sistema->lista_users;
+    consulta->frio = sistema->frio;
+    consulta->num_segmentos = sistema->frio ?
+                              sistema->frio->num_segmentos : 0;
+    consulta->versao = sistema->versao;
+    consulta->vazia = 0;
+}
+
+/**
+ * @brief Prints one application as u and p show it
+ * @param saida Stream to write to
+ * @param registo Application to print
+ */
+void imprimir_aplicacao(FILE* saida, User* registo) {
+    char data_aplicacao[DATA_TEXTO_MAX];
+
+    data_formatar(registo->data_aplicacao, data_aplicacao);
+    fprintf(saida, "%s %s %s\n", registo->nome, registo->lote_usado,
+            data_aplicacao);
+}
+
+/**
+ * @brief Lists the applications of a u snapshot
+ * 
+ * Lists all applications or only those for a specific user
+ * Sorts by date of application. Sealed applications are older than
+ * any in memory and come out of their segments already in order, so
+ * they are printed first.
+ * 
+ * @param consulta Snapshot taken by preparar_listar_aplicacoes
+ * @param saida Stream to write to
+ */
+void escrever_aplicacoes(Consulta* consulta, FILE* saida) {
+    User* lista_user = consulta->utente_ausente ? NULL :
+                       consulta->aplicacoes;
+    unsigned long versao = consulta->versao;
+    const Mensagem* mensagens = consulta->mensagens;
+    char* nome_usuario = consulta->nome_usuario;
+    int num_segmentos = consulta->utente_ausente ? 0 :
+                        consulta->num_segmentos;
+    CursorFrio frio;
+    User* selado;
+    int selados = 0;
+    unsigned long long inicio;
+    
+    if (nome_usuario[0] != '\0') {
+        cursor_frio_utente(&frio, consulta->frio, num_segmentos,
+                           nome_usuario, versao);
+    } else {
+        cursor_frio_abrir(&frio, consulta->frio, num_segmentos, INT_MIN,
+                          INT_MAX, versao);
+    }
+    selado = cursor_frio_proximo(&frio);
     
     /* If username specified, check that it exists */
     if (nome_usuario[0] != '\0') {
-        int user_found = 0;
+        int user_found = selado != NULL;
         User* check = lista_user;
         
-        while (check != NULL) {
-            if (strcmp(check->nome, nome_usuario) == 0) {
+        inicio = traco_inicio(consulta->traco);
+        while (check != NULL && !user_found) {
+            if (eh_registo_visivel(check, versao) &&
+                strcmp(check->nome, nome_usuario) == 0) {
                 user_found = 1;
                 break;
             }
-            check = check->next;
+            check = proximo_registo(check);
         }
+        traco_local_fim(consulta->traco, &consulta->traco_local,
+                        TRACO_PROCURA, "procurar_utente", inicio);
         
         if (!user_found) {
-            printf(use_portuguese ? "%s: utente inexistente\n" :
-                 "%s: no such user\n", nome_usuario);
+            emitir_mensagem_nome(saida, mensagens, MSG_UTENTE_INEXISTENTE,
+                                 nome_usuario);
+            cursor_frio_fechar(&frio);
             return;
         }
     }
@@ -1484,17 +1830,30 @@ void listar_aplicacoes(User* lista_user, int use_portuguese){
     int num_total = 0;
     User* current = lista_user;
     
+    inicio = traco_inicio(consulta->traco);
     while (current != NULL) {
-        num_total++;
-        current = current->next;
+        if (eh_registo_visivel(current, versao)) {
+            num_total++;
+        }
+        current = proximo_registo(current);
     }
+    traco_local_fim(consulta->traco, &consulta->traco_local, TRACO_PROCURA,
+                    "contar_aplicacoes", inicio);
     
-    if (num_total == 0 && nome_usuario[0] != '\0') {
-        printf(use_portuguese ? "%s: utente inexistente\n" :
-              "%s: no such user\n", nome_usuario);
+    if (num_total == 0 && !selado && nome_usuario[0] != '\0') {
+        emitir_mensagem_nome(saida, mensagens, MSG_UTENTE_INEXISTENTE,
+                             nome_usuario);
+        cursor_frio_fechar(&frio);
         return;
     }
 
+    /* Sealed records first */
+    for (; selado != NULL; selado = cursor_frio_proximo(&frio)) {
+        imprimir_aplicacao(saida, selado);
+        selados++;
+    }
+    cursor_frio_fechar(&frio);
+
     if (num_total == 0) {
         return; /* Nothing to list */
     }
@@ -1502,7 +1861,7 @@ void listar_aplicacoes(User* lista_user, int use_portuguese){
     /* Allocate array for sorting */
     User** array_users = (User**)malloc(num_total * sizeof(User*));
     if (!array_users) {
-        printf(use_portuguese ? "sem memória\n" : "No memory\n");
+        emitir_mensagem(saida, mensagens, MSG_SEM_MEMORIA);
         return;
     }
     
@@ -1513,41 +1872,596 @@ void listar_aplicacoes(User* lista_user, int use_portuguese){
     if (nome_usuario[0] == '\0') {
         /* Add all records if no username filter */
         while (current != NULL) {
-            array_users[index++] = current;
-            current = current->next;
+            if (eh_registo_visivel(current, versao)) {
+                array_users[index++] = current;
+            }
+            current = proximo_registo(current);
         }
     } else {
-        int user_found = 0;
+        int user_found = selados > 0;
         
         /* Add only records for specified user */
         while (current != NULL) {
-            if (strcmp(current->nome, nome_usuario) == 0) {
+            if (eh_registo_visivel(current, versao) &&
+                strcmp(current->nome, nome_usuario) == 0) {
                 array_users[index++] = current;
                 user_found = 1;
             }
-            current = current->next;
+            current = proximo_registo(current);
         }
         
         if (!user_found) {
-            printf(use_portuguese ? "%s: utente inexistente\n" :
-                  "%s: no such user\n", nome_usuario);
+            emitir_mensagem_nome(saida, mensagens, MSG_UTENTE_INEXISTENTE,
+                                 nome_usuario);
             free(array_users);
             return;
         }
     }
     
     /* Sort records by date */
+    inicio = traco_inicio(consulta->traco);
     ordenar_aplicacoes(array_users, index);
+    traco_local_fim(consulta->traco, &consulta->traco_local,
+                    TRACO_ORDENACAO, "ordenar_aplicacoes", inicio);
     
     /* Print sorted records */
     for (int i = 0; i < index; i++) {
-        printf("%s %s %02d-%02d-%d\n",
-               array_users[i]->nome,
-               array_users[i]->lote_usado,  
-               array_users[i]->dia_de_applicacao,
-               array_users[i]->mes_de_aplicacao,
-               array_users[i]->ano_de_aplicacao);
+        imprimir_aplicacao(saida, array_users[i]);
     }
     
     free(array_users);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Lists vaccination applications
+ * 
+ * Answers from a snapshot right away, as the server does on its reader
+ * thread.
+ */
+void listar_aplicacoes(Sistema* sistema, FILE* entrada, FILE* saida){
+    Consulta* consulta = preparar_consulta(sistema, 'u', entrada, saida);
+
+    if (!consulta) {
+        return;
+    }
+    responder_consulta(consulta, saida);
+    terminar_consulta(sistema, consulta);
+}
+
+/**
+ * @brief Checks if a command is answered from a snapshot
+ * @param comando Command letter
+ * @return 1 for l and u, 0 otherwise
+ */
+int eh_consulta(char comando) {
+    return comando == 'l' || comando == 'u';
+}
+
+/**
+ * @brief Reads a query's arguments and takes its snapshot
+ * 
+ * Runs on the thread that changes the system. Until the snapshot is
+ * released, deleted applications are only marked.
+ * 
+ * @param sistema Pointer to the system
+ * @param comando l or u
+ * @param entrada Stream holding the rest of the command line
+ * @param saida Stream errors are written to
+ * @return Snapshot to answer and then release, or NULL if there was no
+ * memory for it
+ */
+Consulta* preparar_consulta(Sistema* sistema, char comando, FILE* entrada,
+                            FILE* saida) {
+    Consulta* consulta = (Consulta*)calloc(1, sizeof(Consulta));
+
+    if (!consulta) {
+        /* The arguments are skipped so they are not read as commands */
+        ler_linha(sistema, entrada);
+        emitir_mensagem(saida, sistema->mensagens, MSG_SEM_MEMORIA);
+        return NULL;
+    }
+
+    consulta->comando = comando;
+    consulta->mensagens = sistema->mensagens;
+    consulta->epocas = sistema->epocas;
+    consulta->leitor = epoca_entrar(sistema->epocas);
+    consulta->fixada = 1;
+    consulta->vazia = 1;
+    consulta->traco = sistema->traco;
+
+    if (comando == 'l') {
+        preparar_listar_vacinas(sistema, entrada, saida, consulta);
+    } else {
+        preparar_listar_aplicacoes(sistema, entrada, saida, consulta);
+    }
+
+    consulta->next = sistema->consultas;
+    sistema->consultas = consulta;
+    return consulta;
+}
+
+/**
+ * @brief Writes a query's response from its snapshot
+ * @param consulta Snapshot taken by preparar_consulta
+ * @param saida Stream the response is written to
+ */
+void responder_consulta(Consulta* consulta, FILE* saida) {
+    if (!consulta->vazia) {
+        unsigned long long inicio = traco_inicio(consulta->traco);
+
+        traco_local_iniciar(&consulta->traco_local);
+        if (consulta->comando == 'l') {
+            escrever_vacinas(consulta, saida);
+            traco_local_fim(consulta->traco, &consulta->traco_local,
+                            TRACO_ESCRITA, "escrever_vacinas", inicio);
+        } else {
+            escrever_aplicacoes(consulta, saida);
+            traco_local_fim(consulta->traco, &consulta->traco_local,
+                            TRACO_ESCRITA, "escrever_aplicacoes", inicio);
+        }
+    }
+
+    /* Nothing the snapshot reached is needed anymore */
+    epoca_sair(consulta->epocas, consulta->leitor);
+    consulta->fixada = 0;
+}
+
+/**
+ * @brief Releases a snapshot once its response was written
+ * 
+ * Deleted applications no remaining snapshot sees are unlinked, and
+ * whatever no pinned epoch can reach anymore is freed. Spans recorded
+ * while it was answered join the trace here, on the thread that owns
+ * the ring.
+ * 
+ * @param sistema Pointer to the system the snapshot was taken from
+ * @param consulta Snapshot to free
+ */
+void terminar_consulta(Sistema* sistema, Consulta* consulta) {
+    Consulta** ligacao = &sistema->consultas;
+    unsigned long mais_antiga = sistema->versao;
+    Consulta* outra;
+
+    while (*ligacao != consulta) {
+        ligacao = &(*ligacao)->next;
+    }
+    *ligacao = consulta->next;
+
+    if (consulta->fixada) {
+        epoca_sair(sistema->epocas, consulta->leitor);
+    }
+    traco_juntar(sistema->traco, &consulta->traco_local);
+
+    if (sistema->apagados_pendentes > 0) {
+        for (outra = sistema->consultas; outra; outra = outra->next) {
+            if (outra->versao < mais_antiga) {
+                mais_antiga = outra->versao;
+            }
+        }
+        sistema->apagados_pendentes -=
+            recolher_apagados(&sistema->lista_users, mais_antiga,
+                              sistema->epocas);
+    }
+    epoca_recolher(sistema->epocas);
+
+    free(consulta->linha);
+    free(consulta->lotes);
+    free(consulta->nome_usuario);
+    free(consulta);
+}
+
+/**
+ * @brief Shows aggregate statistics
+ * 
+ * Every figure is kept up to date by the commands that change it, so
+ * the report costs one line per vaccine and per day with applications,
+ * not a scan of the batches, the applications or the calendar. Vaccines
+ * come in the order their first batch was created; days with no
+ * applications are left out.
+ */
+void mostrar_estatisticas(Sistema* sistema, FILE* entrada, FILE* saida) {
+    IndiceDias* dias = sistema->indice_dias;
+    char texto_data[DATA_TEXTO_MAX];
+    Vacina* vacina;
+    int i;
+
+    /* The command takes no arguments */
+    ler_linha(sistema, entrada);
+
+    for (vacina = sistema->indice_lotes->primeira_vacina; vacina != NULL;
+         vacina = vacina->proxima_criada) {
+        fprintf(saida, "%s %d %d %d\n", vacina->nome,
+                vacina->doses_disponiveis, vacina->doses_aplicadas,
+                vacina->lotes_ativos);
+    }
+
+    for (i = 0; i < dias->num_dias; i++) {
+        if (dias->dias[i].aplicacoes > 0) {
+            data_formatar(dias->dias[i].data, texto_data);
+            fprintf(saida, "%s %d\n", texto_data, dias->dias[i].aplicacoes);
+        }
+    }
+}
+
+/**
+ * @brief Shows the size and health of the structures
+ * 
+ * One "<name> <value>" line per figure, all of them counters the
+ * commands keep up to date: batches not yet expired and every batch in
+ * the list, as conta_lote would count them; applications on record and
+ * sealed segments; users with applications on record, then buckets,
+ * load factor and longest chain of the user index, whose entries are
+ * every user ever vaccinated; deletions kept for snapshots and records
+ * waiting for their epoch; bytes reserved and in use by each arena, 0
+ * when every object is its own malloc, and by malloc itself where glibc
+ * reports it; and, for each command letter that ran, how many times and
+ * the milliseconds it held the thread that runs the commands.
+ */
+void mostrar_estado(Sistema* sistema, FILE* entrada, FILE* saida) {
+    IndiceLotes* lotes = sistema->indice_lotes;
+    IndiceUtentes* utentes = sistema->indice_utentes;
+    int i;
+
+    /* The command takes no arguments */
+    ler_linha(sistema, entrada);
+
+    fprintf(saida, "batches %d\n", lotes->num_lotes - lotes->expirados);
+    fprintf(saida, "conta_lote %d\n", lotes->num_lotes);
+    fprintf(saida, "applications %ld\n", sistema->indice_dias->total);
+    fprintf(saida, "sealed_segments %d\n",
+            sistema->frio ? sistema->frio->num_segmentos : 0);
+    fprintf(saida, "users %u\n", utentes->utentes_vivos);
+    fprintf(saida, "user_buckets %u\n", utentes->capacidade);
+    fprintf(saida, "user_load %.2f\n",
+            (double)utentes->num_utentes / utentes->capacidade);
+    fprintf(saida, "user_longest_chain %u\n", utentes->maior_cadeia);
+    fprintf(saida, "pending_deletions %d\n", sistema->apagados_pendentes);
+    fprintf(saida, "retired_records %d\n", sistema->epocas->num_retirados);
+    fprintf(saida, "arena_applications %zu %zu\n",
+            sistema->arena->reservado, sistema->arena->em_uso);
+    fprintf(saida, "arena_users %zu %zu\n",
+            utentes->arena->reservado, utentes->arena->em_uso);
+#ifdef PROJ_MALLINFO
+    {
+        struct mallinfo2 info = mallinfo2();
+
+        fprintf(saida, "malloc %zu %zu\n", info.arena + info.hblkhd,
+                info.uordblks + info.hblkhd);
+    }
+#endif
+
+    for (i = 0; i < SISTEMA_COMANDOS; i++) {
+        ContadorComando* contador = &sistema->comandos[i];
+
+        if (contador->contagem > 0) {
+            fprintf(saida, "command %c %ld %.3f\n", (char)i,
+                    contador->contagem,
+                    sistema_nanos(sistema, contador->ciclos) / 1e6);
+        }
+    }
+}
+
+/**
+ * @brief Lists the applications given between two dates
+ * 
+ * Finds the first day of the period in the day index by binary search
+ * and walks on to its last day, so only the days in it that have
+ * applications and their records are visited. Within a day
+ * records come in the order they were given, as listar_aplicacoes
+ * shows them. Sealed days are read from the segments whose sparse date
+ * index covers the period.
+ */
+void listar_periodo(Sistema* sistema, FILE* entrada, FILE* saida) {
+    IndiceDias* dias = sistema->indice_dias;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* input_buffer = ler_linha(sistema, entrada);
+    char nome_vacina[NOME_VACINA_MAX] = "";
+    char texto_data[DATA_TEXTO_MAX];
+    int dia_i, mes_i, ano_i, dia_f, mes_f, ano_f;
+    Data inicio, fim, formatado = INT_MIN;
+    Vacina* vacina = NULL;
+    CursorFrio frio;
+    User* current;
+    int i;
+
+    if (input_buffer == NULL) {
+        return;
+    }
+
+    int input_c = sscanf(input_buffer, " %d-%d-%d %d-%d-%d %50s", &dia_i,
+                         &mes_i, &ano_i, &dia_f, &mes_f, &ano_f, nome_vacina);
+
+    /* Both dates must exist and be in order */
+    if (input_c < 6 || !data_eh_valida(dia_i, mes_i, ano_i) ||
+        !data_eh_valida(dia_f, mes_f, ano_f)) {
+        emitir_mensagem(saida, mensagens, MSG_DATA_INVALIDA);
+        return;
+    }
+
+    inicio = data_criar(dia_i, mes_i, ano_i);
+    fim = data_criar(dia_f, mes_f, ano_f);
+    if (inicio > fim) {
+        emitir_mensagem(saida, mensagens, MSG_DATA_INVALIDA);
+        return;
+    }
+
+    if (nome_vacina[0] != '\0' &&
+        (vacina = procurar_vacina(sistema->indice_lotes,
+                                  nome_vacina)) == NULL) {
+        emitir_mensagem_nome(saida, mensagens, MSG_VACINA_INEXISTENTE,
+                             nome_vacina);
+        return;
+    }
+
+    /* Sealed days come first, from the segments that hold the vaccine */
+    cursor_frio_abrir(&frio, sistema->frio, sistema->frio ?
+                      sistema->frio->num_segmentos : 0, inicio, fim,
+                      sistema->versao);
+    frio.vacina = vacina ? vacina->id : -1;
+    while ((current = cursor_frio_proximo(&frio)) != NULL) {
+        if (nome_vacina[0] == '\0' ||
+            strcmp(current->nome_vacina, nome_vacina) == 0) {
+            if (current->data_aplicacao != formatado) {
+                formatado = current->data_aplicacao;
+                data_formatar(formatado, texto_data);
+            }
+            fprintf(saida, "%s %s %s\n", current->nome,
+                    current->lote_usado, texto_data);
+        }
+    }
+    cursor_frio_fechar(&frio);
+
+    for (i = dias_posicao(dias, inicio);
+         i < dias->num_dias && dias->dias[i].data <= fim; i++) {
+        current = dias->dias[i].primeiro;
+
+        if (current) {
+            data_formatar(dias->dias[i].data, texto_data);
+        }
+        for (; current != NULL; current = current->proximo_dia) {
+            if (nome_vacina[0] == '\0' ||
+                strcmp(current->nome_vacina, nome_vacina) == 0) {
+                fprintf(saida, "%s %s %s\n", current->nome,
+                        current->lote_usado, texto_data);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Lists the batches with doses left that expire soon
+ * 
+ * Walks the expiry schedule from the expiry cursor, the first batch
+ * still valid on the current date, and stops at the first batch past
+ * the horizon. Only the batches expiring within it are visited. Each
+ * batch with doses left is shown as l shows it, and a last line holds
+ * the total of those doses.
+ */
+void listar_a_expirar(Sistema* sistema, FILE* entrada, FILE* saida) {
+    IndiceLotes* indice = sistema->indice_lotes;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* input_buffer = ler_linha(sistema, entrada);
+    int dias, i;
+    long limite, doses = 0;
+
+    if (input_buffer == NULL) {
+        return;
+    }
+
+    if (sscanf(input_buffer, " %d", &dias) != 1 || dias < 0) {
+        emitir_mensagem(saida, mensagens, MSG_QUANTIDADE_INVALIDA);
+        return;
+    }
+
+    /* Last day a reported batch may expire on */
+    limite = (long)sistema->data_sistema + dias;
+
+    for (i = indice->expirados; i < indice->num_lotes &&
+         indice->calendario[i]->data_expiracao <= limite; i++) {
+        LoteVacina* lote = indice->calendario[i];
+
+        if (lote->ativo) {
+            imprimir_lote(saida, lote);
+            doses += lote->dosas_disponiveis;
+        }
+    }
+
+    fprintf(saida, "%ld\n", doses);
+}
+
+/**
+ * @brief Exports every batch and application to files
+ * 
+ * The line holds the format, csv or col, and the path of the files
+ * without their suffixes. Prints the number of batches and of
+ * applications written.
+ */
+void exportar_registos(Sistema* sistema, FILE* entrada, FILE* saida) {
+    const Mensagem* mensagens = sistema->mensagens;
+    char* input_buffer = ler_linha(sistema, entrada);
+    char formato[8];
+    ResumoExportacao resumo;
+    int inicio_prefixo = 0, ok;
+
+    if (input_buffer == NULL) {
+        return;
+    }
+
+    /* Trim trailing whitespace, including the newline */
+    int len = strlen(input_buffer);
+    while (len > 0 && isspace((unsigned char)input_buffer[len-1])) {
+        input_buffer[--len] = '\0';
+    }
+
+    if (sscanf(input_buffer, " %7s %n", formato, &inicio_prefixo) != 1 ||
+        input_buffer[inicio_prefixo] == '\0') {
+        emitir_mensagem(saida, mensagens, MSG_FORMATO_INVALIDO);
+        return;
+    }
+
+    char* prefixo = input_buffer + inicio_prefixo;
+    if (strcmp(formato, "csv") == 0) {
+        ok = exportar_csv(sistema, prefixo, &resumo);
+    } else if (strcmp(formato, "col") == 0) {
+        ok = exportar_colunas(sistema, prefixo, &resumo);
+    } else {
+        emitir_mensagem(saida, mensagens, MSG_FORMATO_INVALIDO);
+        return;
+    }
+
+    if (!ok) {
+        emitir_mensagem_nome(saida, mensagens, MSG_FICHEIRO_INACESSIVEL,
+                             prefixo);
+        return;
+    }
+
+    fprintf(saida, "%d %ld\n", resumo.lotes, resumo.aplicacoes);
+}
+
+/**
+ * @brief Writes a checkpoint of the whole state in the background
+ * 
+ * The line holds the path of the file. Prints nothing once the child
+ * writing it has started; it reports on stderr when it is done.
+ */
+void salvaguardar_sistema(Sistema* sistema, FILE* entrada, FILE* saida) {
+    const Mensagem* mensagens = sistema->mensagens;
+    char* input_buffer = ler_linha(sistema, entrada);
+    char* caminho;
+    int len, estado;
+
+    if (input_buffer == NULL) {
+        return;
+    }
+
+    /* Trim trailing whitespace, including the newline */
+    len = strlen(input_buffer);
+    while (len > 0 && isspace((unsigned char)input_buffer[len-1])) {
+        input_buffer[--len] = '\0';
+    }
+    caminho = input_buffer;
+    while (isspace((unsigned char)*caminho)) {
+        caminho++;
+    }
+
+    if (*caminho == '\0') {
+        emitir_mensagem(saida, mensagens, MSG_FORMATO_INVALIDO);
+        return;
+    }
+
+    estado = iniciar_salvaguarda(sistema, caminho);
+    if (estado == 0) {
+        emitir_mensagem(saida, mensagens, MSG_SALVAGUARDA_EM_CURSO);
+    } else if (estado < 0) {
+        emitir_mensagem(saida, mensagens, MSG_SEM_MEMORIA);
+    }
+}
+
+/**
+ * @brief Creates every valid batch of a manifest at once
+ * 
+ * Each line holds the arguments of one c command. Lines are checked
+ * in order exactly as c would check them, but the batch count is kept
+ * as a number and duplicates are found in a hash set seeded with the
+ * existing ids, instead of walking the batch list for every line. The
+ * accepted batches join the list in line order and are indexed once.
+ * Rejected lines are reported as "<line>: <message>", followed by the
+ * number of batches created.
+ * 
+ * @param sistema Pointer to the system
+ * @param caminho Path of the manifest
+ * @param saida Stream the report is written to
+ * @return Number of batches created, or -1 if the file cannot be read
+ * or there is no memory to check it
+ */
+int importar_manifesto(Sistema* sistema, const char* caminho, FILE* saida) {
+    IndiceLotes* indice = sistema->indice_lotes;
+    const Mensagem* mensagens = sistema->mensagens;
+    char* input_buffer = NULL;
+    size_t capacidade = 0;
+    LoteVacina* novos[MAX_LOTES];
+    ConjuntoLotes* ids;
+    DadosLote dados;
+    IdMensagem erro;
+    int num_novos = 0, linha = 0, i;
+    FILE* manifesto = fopen(caminho, "r");
+
+    if (!manifesto) {
+        emitir_mensagem_nome(saida, mensagens, MSG_FICHEIRO_ILEGIVEL,
+                             caminho);
+        return -1;
+    }
+
+    ids = (ConjuntoLotes*)malloc(sizeof(ConjuntoLotes));
+    if (!ids) {
+        fclose(manifesto);
+        emitir_mensagem(saida, mensagens, MSG_SEM_MEMORIA);
+        return -1;
+    }
+    conjunto_lotes_limpar(ids);
+    for (i = 0; i < indice->num_lotes; i++) {
+        conjunto_lotes_inserir(ids, indice->calendario[i]->lote);
+    }
+
+    while (getline(&input_buffer, &capacidade, manifesto) >= 0) {
+        linha++;
+
+        if (!ler_dados_lote(input_buffer, &dados, &erro)) {
+            if (erro != NUM_MENSAGENS) {
+                fprintf(saida, "%d: ", linha);
+                emitir_mensagem(saida, mensagens, erro);
+            }
+            continue;
+        }
+
+        erro = validar_lote(&dados, sistema->data_sistema,
+                            indice->num_lotes + num_novos >= MAX_LOTES,
+                            conjunto_lotes_contem(ids, dados.lote));
+        if (erro != NUM_MENSAGENS) {
+            fprintf(saida, "%d: ", linha);
+            emitir_mensagem(saida, mensagens, erro);
+            continue;
+        }
+
+        novos[num_novos] = criar_lote(dados.nome, dados.lote,
+                                      data_criar(dados.dia, dados.mes,
+                                                 dados.ano),
+                                      dados.doses);
+        conjunto_lotes_inserir(ids, novos[num_novos]->lote);
+        num_novos++;
+    }
+    fclose(manifesto);
+    free(input_buffer);
+    free(ids);
+
+    for (i = 0; i < num_novos; i++) {
+        adicionar_lote(&sistema->lista_vacinas, novos[i]);
+    }
+    indexar_lotes(indice, novos, num_novos);
+
+    fprintf(saida, "%d\n", num_novos);
+    return num_novos;
+}
+
+/**
+ * @brief Imports a batch manifest named on the command line
+ * 
+ * The rest of the line is the path of the manifest.
+ */
+void importar_lotes(Sistema* sistema, FILE* entrada, FILE* saida) {
+    char* input_buffer = ler_linha(sistema, entrada);
+
+    if (input_buffer == NULL) {
+        return;
+    }
+
+    /* Trim surrounding whitespace, including the newline */
+    int len = strlen(input_buffer);
+    while (len > 0 && isspace((unsigned char)input_buffer[len-1])) {
+        input_buffer[--len] = '\0';
+    }
+    char* caminho = input_buffer;
+    while (*caminho && isspace((unsigned char)*caminho)) caminho++;
+
+    importar_manifesto(sistema, caminho, saida);
+}
@@ -0,0 +1,208 @@
+/**
+ * @file salvaguarda.c
+ * @brief Checkpoints of the whole state written by a forked child
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * fork is called between two commands on the thread that runs them,
+ * so the child's image is consistent: readers of snapshots never
+ * change the system. The child only reads that image, writes through
+ * stdio and leaves with _exit, so nothing the parent buffered is
+ * flushed twice and no segment file is deleted.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "salvaguarda.h"
+
+/**
+ * @brief Writes one unsigned 32-bit value
+ * @param ficheiro File to write to
+ * @param valor Value to write
+ */
+static void escrever_u32(FILE* ficheiro, uint32_t valor) {
+    fwrite(&valor, sizeof(valor), 1, ficheiro);
+}
+
+/**
+ * @brief Writes every user of the index with its latest doses
+ * @param ficheiro File to write to
+ * @param indice User index
+ */
+static void escrever_utentes(FILE* ficheiro, const IndiceUtentes* indice) {
+    unsigned int i;
+
+    escrever_u32(ficheiro, indice->num_utentes);
+    for (i = 0; i < indice->capacidade; i++) {
+        Utente* utente;
+
+        for (utente = indice->table[i]; utente; utente = utente->next) {
+            size_t len = strlen(utente->nome);
+            UltimaDose* dose;
+            uint32_t n = 0;
+
+            for (dose = utente->doses; dose; dose = dose->next) {
+                n++;
+            }
+            escrever_u32(ficheiro, (uint32_t)len);
+            fwrite(utente->nome, 1, len, ficheiro);
+            escrever_u32(ficheiro, n);
+            for (dose = utente->doses; dose; dose = dose->next) {
+                int32_t dia = dose->ultimo_dia;
+
+                escrever_u32(ficheiro, (uint32_t)dose->vacina->id);
+                fwrite(&dia, sizeof(dia), 1, ficheiro);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Writes the whole state to a checkpoint file
+ * @param sistema Pointer to the system
+ * @param caminho Path of the file
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if the file could not be written
+ */
+int escrever_salvaguarda(Sistema* sistema, const char* caminho,
+                         ResumoSalvaguarda* resumo) {
+    size_t len = strlen(caminho);
+    char* temporario = (char*)malloc(len + sizeof(SALVAGUARDA_TEMPORARIO));
+    char* buffer = (char*)malloc(EXPORTAR_BUFFER);
+    int32_t data = sistema->data_sistema;
+    FILE* ficheiro;
+    int ok;
+
+    if (!temporario || !buffer) {
+        printf("No memory\n");
+        exit(1);
+    }
+    memcpy(temporario, caminho, len);
+    strcpy(temporario + len, SALVAGUARDA_TEMPORARIO);
+
+    resumo->registos.lotes = 0;
+    resumo->registos.aplicacoes = 0;
+    resumo->utentes = 0;
+
+    ficheiro = fopen(temporario, "wb");
+    if (!ficheiro) {
+        free(temporario);
+        free(buffer);
+        return 0;
+    }
+    setvbuf(ficheiro, buffer, _IOFBF, EXPORTAR_BUFFER);
+
+    fwrite(SALVAGUARDA_MAGIA, 1, sizeof(SALVAGUARDA_MAGIA) - 1, ficheiro);
+    fwrite(&data, sizeof(data), 1, ficheiro);
+    escrever_colunas(sistema, ficheiro, &resumo->registos);
+    escrever_utentes(ficheiro, sistema->indice_utentes);
+    resumo->utentes = sistema->indice_utentes->num_utentes;
+
+    /* Only a file that reached the disk whole replaces the last one */
+    ok = fflush(ficheiro) == 0 && !ferror(ficheiro) &&
+         fsync(fileno(ficheiro)) == 0;
+    ok = (fclose(ficheiro) == 0) && ok;
+    ok = ok && rename(temporario, caminho) == 0;
+    if (!ok) {
+        unlink(temporario);
+    }
+
+    free(temporario);
+    free(buffer);
+    return ok;
+}
+
+/**
+ * @brief Starts writing a checkpoint in a child process
+ *
+ * stdout is flushed first, so the child has nothing of it to write if
+ * it runs out of memory and exits.
+ *
+ * @param sistema Pointer to the system
+ * @param caminho Path of the file
+ * @return 1 if the child started, 0 if another checkpoint is still
+ * being written, -1 if the process could not be created
+ */
+int iniciar_salvaguarda(Sistema* sistema, const char* caminho) {
+    Salvaguarda* salvaguarda = &sistema->salvaguarda;
+    char* copia;
+    long long inicio;
+    pid_t pid;
+
+    if (salvaguarda->pid > 0) {
+        return 0;
+    }
+
+    if (!(copia = strdup(caminho))) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    inicio = sistema_relogio();
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        free(copia);
+        return -1;
+    }
+
+    if (pid == 0) {
+        ResumoSalvaguarda resumo;
+
+        if (!escrever_salvaguarda(sistema, caminho, &resumo)) {
+            fprintf(stderr, "%s: cannot write checkpoint\n", caminho);
+            _exit(1);
+        }
+        fprintf(stderr, "%s: checkpoint of %d batches, %ld applications "
+                "and %u users written in %.1f ms\n", caminho,
+                resumo.registos.lotes, resumo.registos.aplicacoes,
+                resumo.utentes, (sistema_relogio() - inicio) / 1e6);
+        _exit(0);
+    }
+
+    salvaguarda->pausa = sistema_relogio() - inicio;
+    salvaguarda->pid = pid;
+    salvaguarda->caminho = copia;
+    return 1;
+}
+
+/**
+ * @brief Reaps the child writing a checkpoint, if it is done
+ *
+ * Reports how long the fork stopped the commands, and the signal that
+ * killed the child if one did; the child reports everything else.
+ *
+ * @param sistema Pointer to the system
+ * @param esperar 1 to wait for the child to finish
+ */
+void recolher_salvaguarda(Sistema* sistema, int esperar) {
+    Salvaguarda* salvaguarda = &sistema->salvaguarda;
+    pid_t pid;
+    int estado;
+
+    if (salvaguarda->pid <= 0) {
+        return;
+    }
+
+    do {
+        pid = waitpid(salvaguarda->pid, &estado, esperar ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+        return;
+    }
+
+    if (pid > 0 && WIFSIGNALED(estado)) {
+        fprintf(stderr, "%s: checkpoint killed by signal %d\n",
+                salvaguarda->caminho, WTERMSIG(estado));
+    }
+    fprintf(stderr, "%s: commands stopped for %.1f us to fork the "
+            "checkpoint\n", salvaguarda->caminho, salvaguarda->pausa / 1e3);
+
+    free(salvaguarda->caminho);
+    salvaguarda->caminho = NULL;
+    salvaguarda->pid = 0;
+}
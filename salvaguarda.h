@@ -0,0 +1,73 @@
+/**
+ * @file salvaguarda.h
+ * @brief Checkpoints of the whole state written by a forked child
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * The child gets a copy-on-write image of the system as it was between
+ * two commands and writes it while the parent keeps running commands;
+ * the parent only pays for the fork and for the pages it changes while
+ * the child lives.
+ */
+#ifndef SALVAGUARDA_H
+#define SALVAGUARDA_H
+
+#include "sistema.h"
+#include "exportar.h"
+
+/**< First bytes of a checkpoint file */
+#define SALVAGUARDA_MAGIA "VACSNAP1\n"
+
+/**< Suffix of the file while it is being written */
+#define SALVAGUARDA_TEMPORARIO ".tmp"
+
+/**
+ * @brief What a checkpoint wrote
+ */
+typedef struct ResumoSalvaguarda {
+    ResumoExportacao registos;  /**< Batches and applications */
+    unsigned int utentes;       /**< Entries of the user index */
+} ResumoSalvaguarda;
+
+/**
+ * @brief Writes the whole state to a checkpoint file
+ *
+ * The file holds, in host byte order:
+ * - SALVAGUARDA_MAGIA and the system date (i32 days since 01-01-1970);
+ * - the batches and applications, as written by escrever_colunas;
+ * - the user index: count (u32), then for each user the length (u32)
+ *   and bytes of the name, the number of vaccines (u32) and, for each,
+ *   the vaccine code (u32) and the day of the latest dose (i32).
+ *
+ * It is written to <caminho>SALVAGUARDA_TEMPORARIO and renamed to
+ * caminho once complete, so caminho always holds a whole checkpoint.
+ *
+ * @param sistema Pointer to the system
+ * @param caminho Path of the file
+ * @param resumo Output for what was written
+ * @return 1 on success, 0 if the file could not be written
+ */
+int escrever_salvaguarda(Sistema* sistema, const char* caminho,
+                         ResumoSalvaguarda* resumo);
+
+/**
+ * @brief Starts writing a checkpoint in a child process
+ *
+ * The child reports on stderr when the file is written, or why it was
+ * not, and exits. The parent reports how long the fork stopped the
+ * commands and returns at once.
+ *
+ * @param sistema Pointer to the system
+ * @param caminho Path of the file
+ * @return 1 if the child started, 0 if another checkpoint is still
+ * being written, -1 if the process could not be created
+ */
+int iniciar_salvaguarda(Sistema* sistema, const char* caminho);
+
+/**
+ * @brief Reaps the child writing a checkpoint, if it is done
+ * @param sistema Pointer to the system
+ * @param esperar 1 to wait for the child to finish
+ */
+void recolher_salvaguarda(Sistema* sistema, int esperar);
+
+#endif
@@ -0,0 +1,890 @@
+/**
+ * @file segmento.c
+ * @brief Old applications sealed into immutable segments on disk
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "segmento.h"
+
+/**< Name of a segment file inside the archive's directory */
+#define SEGMENTO_NOME "/vacinas-XXXXXX.seg"
+
+/**
+ * @brief Creates an empty archive
+ * @param diretorio Directory segment files are created in
+ * @param idade Days an application stays in memory
+ * @return Pointer to the newly created archive
+ */
+ArquivoFrio* criar_arquivo_frio(const char* diretorio, int idade) {
+    ArquivoFrio* arquivo = (ArquivoFrio*)calloc(1, sizeof(ArquivoFrio));
+
+    if (!arquivo || !(arquivo->diretorio = strdup(diretorio))) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    arquivo->idade = idade;
+    arquivo->ate = INT_MIN;
+    return arquivo;
+}
+
+/**
+ * @brief Closes and deletes a segment file and frees its summary
+ * @param segmento Segment no reader holds
+ */
+static void free_segmento(Segmento* segmento) {
+    close(segmento->fd);
+    unlink(segmento->caminho);
+    free(segmento->caminho);
+    free(segmento->marcos);
+    free(segmento->amostras);
+    free(segmento->por_vacina);
+    free(segmento->lapides);
+    free(segmento);
+}
+
+/**
+ * @brief Frees the archive and deletes its segment files
+ * @param arquivo Pointer to the archive, or NULL
+ */
+void free_arquivo_frio(ArquivoFrio* arquivo) {
+    int i;
+
+    if (!arquivo) return;
+
+    for (i = 0; i < arquivo->num_segmentos; i++) {
+        free_segmento(arquivo->segmentos[i]);
+    }
+    free(arquivo->segmentos);
+    free(arquivo->diretorio);
+    free(arquivo);
+}
+
+/**
+ * @brief Returns the two bits of a user in a segment's filter
+ * @param hash hash_texto of the user's name
+ * @param bits Output for the two bit positions
+ */
+static void bits_filtro(uint64_t hash, unsigned int bits[2]) {
+    bits[0] = (unsigned int)hash & (SEGMENTO_FILTRO - 1);
+    bits[1] = (unsigned int)(hash >> 32) & (SEGMENTO_FILTRO - 1);
+}
+
+/**
+ * @brief Sorts user index entries by hash (bottom-up mergesort)
+ *
+ * The sort is stable, so entries of the same hash keep the order of
+ * their records.
+ *
+ * @param entradas Entries to sort
+ * @param auxiliar Scratch space for n entries
+ * @param n Number of entries
+ */
+static void ordenar_entradas(EntradaSegmento* entradas,
+                             EntradaSegmento* auxiliar, long n) {
+    long largura, e;
+
+    for (largura = 1; largura < n; largura *= 2) {
+        for (e = 0; e < n - largura; e += 2 * largura) {
+            long m = e + largura;
+            long d = m + largura < n ? m + largura : n;
+            long i = e, j = m, k = e;
+
+            while (i < m && j < d) {
+                if (entradas[i].hash <= entradas[j].hash) {
+                    auxiliar[k++] = entradas[i++];
+                } else {
+                    auxiliar[k++] = entradas[j++];
+                }
+            }
+            while (i < m) auxiliar[k++] = entradas[i++];
+            while (j < d) auxiliar[k++] = entradas[j++];
+            memcpy(&entradas[e], &auxiliar[e],
+                   (d - e) * sizeof(EntradaSegmento));
+        }
+    }
+}
+
+/**
+ * @brief Writes the applications of a range of days to a new segment
+ *
+ * The file holds, in host byte order, SEGMENTO_MAGIA, the records in
+ * the order of their days, the user index ordered by hash, and a
+ * footer with the number of records and the offset of the index (u64
+ * each). A record is the length of the user's name (u32) and its
+ * bytes, the lengths (u8) and bytes of the vaccine and of the batch,
+ * and the date (i32 days since 01-01-1970).
+ *
+ * @param arquivo Pointer to the archive
+ * @param dias Day index of the applications
+ * @param indice Batch index, for the vaccine of each application
+ * @param primeiro Position of the first day
+ * @param ultimo Position after the last day
+ * @param n Number of applications in those days
+ * @return The segment, or NULL if the file could not be written
+ */
+static Segmento* escrever_segmento(ArquivoFrio* arquivo, IndiceDias* dias,
+                                   IndiceLotes* indice, int primeiro,
+                                   int ultimo, long n) {
+    Segmento* segmento = (Segmento*)calloc(1, sizeof(Segmento));
+    EntradaSegmento* entradas;
+    FILE* ficheiro;
+    long posicao, k = 0;
+    uint64_t rodape[2];
+    int d, ok, copia;
+
+    if (!segmento ||
+        !(segmento->caminho = (char*)malloc(strlen(arquivo->diretorio) +
+                                            sizeof(SEGMENTO_NOME))) ||
+        !(entradas = (EntradaSegmento*)malloc(2 * n *
+                                              sizeof(EntradaSegmento))) ||
+        !(segmento->marcos = (MarcoSegmento*)malloc(
+              ((n + SEGMENTO_PASSO - 1) / SEGMENTO_PASSO) *
+              sizeof(MarcoSegmento))) ||
+        !(segmento->amostras = (uint64_t*)malloc(
+              ((n + SEGMENTO_PASSO - 1) / SEGMENTO_PASSO) *
+              sizeof(uint64_t))) ||
+        !(segmento->por_vacina = (int*)calloc(indice->num_vacinas + 1,
+                                              sizeof(int))) ||
+        !(segmento->lapides = (Lapides*)calloc(1, sizeof(Lapides)))) {
+        printf("No memory\n");
+        exit(1);
+    }
+    strcpy(segmento->caminho, arquivo->diretorio);
+    strcat(segmento->caminho, SEGMENTO_NOME);
+    segmento->num_vacinas = indice->num_vacinas;
+
+    segmento->fd = mkstemps(segmento->caminho, 4);
+    copia = segmento->fd >= 0 ? dup(segmento->fd) : -1;
+    ficheiro = copia >= 0 ? fdopen(copia, "w") : NULL;
+    if (!ficheiro) {
+        if (copia >= 0) close(copia);
+        if (segmento->fd >= 0) {
+            close(segmento->fd);
+            unlink(segmento->caminho);
+        }
+        segmento->fd = -1;
+        free(entradas);
+        free(segmento->caminho);
+        free(segmento->marcos);
+        free(segmento->amostras);
+        free(segmento->por_vacina);
+        free(segmento->lapides);
+        free(segmento);
+        return NULL;
+    }
+    setvbuf(ficheiro, NULL, _IOFBF, SEGMENTO_BLOCO);
+
+    fwrite(SEGMENTO_MAGIA, 1, sizeof(SEGMENTO_MAGIA) - 1, ficheiro);
+    posicao = sizeof(SEGMENTO_MAGIA) - 1;
+
+    for (d = primeiro; d < ultimo; d++) {
+        User* registo;
+
+        for (registo = dias->dias[d].primeiro; registo != NULL;
+             registo = registo->proximo_dia) {
+            uint32_t len_nome = (uint32_t)strlen(registo->nome);
+            uint8_t len_vacina = (uint8_t)strlen(registo->nome_vacina);
+            uint8_t len_lote = (uint8_t)strlen(registo->lote_usado);
+            int32_t data = registo->data_aplicacao;
+            uint64_t hash = hash_texto(registo->nome);
+            Vacina* vacina = procurar_vacina(indice, registo->nome_vacina);
+            unsigned int bits[2];
+
+            if (k % SEGMENTO_PASSO == 0) {
+                segmento->marcos[k / SEGMENTO_PASSO].data = data;
+                segmento->marcos[k / SEGMENTO_PASSO].posicao = posicao;
+            }
+            entradas[k].hash = hash;
+            entradas[k].posicao = (uint64_t)posicao;
+            bits_filtro(hash, bits);
+            segmento->filtro[bits[0] / 8] |= 1 << (bits[0] % 8);
+            segmento->filtro[bits[1] / 8] |= 1 << (bits[1] % 8);
+            if (vacina) {
+                segmento->por_vacina[vacina->id]++;
+            }
+
+            fwrite(&len_nome, sizeof(len_nome), 1, ficheiro);
+            fwrite(registo->nome, 1, len_nome, ficheiro);
+            fwrite(&len_vacina, sizeof(len_vacina), 1, ficheiro);
+            fwrite(registo->nome_vacina, 1, len_vacina, ficheiro);
+            fwrite(&len_lote, sizeof(len_lote), 1, ficheiro);
+            fwrite(registo->lote_usado, 1, len_lote, ficheiro);
+            fwrite(&data, sizeof(data), 1, ficheiro);
+            posicao += sizeof(len_nome) + len_nome + sizeof(len_vacina) +
+                       len_vacina + sizeof(len_lote) + len_lote +
+                       sizeof(data);
+
+            if (k == 0) {
+                segmento->primeiro_dia = data;
+            }
+            segmento->ultimo_dia = data;
+            k++;
+        }
+    }
+
+    segmento->registos = n;
+    segmento->vivos = n;
+    segmento->fim_registos = posicao;
+    segmento->num_entradas = n;
+    segmento->num_marcos = (n + SEGMENTO_PASSO - 1) / SEGMENTO_PASSO;
+
+    ordenar_entradas(entradas, entradas + n, n);
+    fwrite(entradas, sizeof(EntradaSegmento), n, ficheiro);
+    for (k = 0; k < n; k += SEGMENTO_PASSO) {
+        segmento->amostras[k / SEGMENTO_PASSO] = entradas[k].hash;
+    }
+    segmento->num_amostras = segmento->num_marcos;
+
+    rodape[0] = (uint64_t)n;
+    rodape[1] = (uint64_t)posicao;
+    fwrite(rodape, sizeof(rodape), 1, ficheiro);
+
+    ok = !ferror(ficheiro);
+    ok = fclose(ficheiro) == 0 && ok;
+    free(entradas);
+
+    if (!ok) {
+        free_segmento(segmento);
+        return NULL;
+    }
+    return segmento;
+}
+
+/**
+ * @brief Seals the applications older than the archive's age
+ *
+ * The applications of every day before the current date minus the
+ * age go to one new segment, in the order of their days, and are then
+ * freed. If the file cannot be written, they stay in memory and are
+ * sealed by a later call.
+ *
+ * @param arquivo Pointer to the archive
+ * @param lista Pointer to the head pointer of the user list
+ * @param dias Day index of the applications
+ * @param indice Batch index, for the vaccine of each application
+ * @param hoje Current date
+ * @return Number of applications sealed
+ */
+long selar_aplicacoes(ArquivoFrio* arquivo, User** lista, IndiceDias* dias,
+                      IndiceLotes* indice, Data hoje) {
+    Data ate = hoje - arquivo->idade;
+    Segmento* segmento;
+    User** ligacao = lista;
+    long n = 0;
+    int primeiro, ultimo, d;
+
+    if (ate <= arquivo->ate) {
+        return 0;
+    }
+
+    primeiro = dias_posicao(dias, arquivo->ate);
+    ultimo = dias_posicao(dias, ate);
+    for (d = primeiro; d < ultimo; d++) {
+        n += dias->dias[d].aplicacoes;
+    }
+
+    if (n > 0) {
+        segmento = escrever_segmento(arquivo, dias, indice, primeiro, ultimo,
+                                     n);
+        if (!segmento) {
+            return 0;
+        }
+
+        if (arquivo->num_segmentos == arquivo->capacidade) {
+            int capacidade = arquivo->capacidade ? 2 * arquivo->capacidade :
+                             16;
+            Segmento** novos = (Segmento**)realloc(
+                arquivo->segmentos, capacidade * sizeof(Segmento*));
+
+            if (!novos) {
+                printf("No memory\n");
+                exit(1);
+            }
+            arquivo->segmentos = novos;
+            arquivo->capacidade = capacidade;
+        }
+        arquivo->segmentos[arquivo->num_segmentos++] = segmento;
+
+        /* No snapshot is taken, so sealed records can go right away */
+        while (*ligacao) {
+            User* registo = *ligacao;
+
+            if (registo->apagado_em == 0 && registo->data_aplicacao < ate) {
+                *ligacao = registo->next;
+                libertar_user(registo);
+            } else {
+                ligacao = &registo->next;
+            }
+        }
+        for (d = primeiro; d < ultimo; d++) {
+            dias->dias[d].primeiro = NULL;
+            dias->dias[d].ultimo = NULL;
+        }
+    }
+
+    arquivo->ate = ate;
+    return n;
+}
+
+/**
+ * @brief Checks if a record of a segment is part of a version
+ * @param lapides Deleted records of the segment
+ * @param posicao Offset of the record
+ * @param versao Version seen
+ * @return 1 unless the record was deleted at or before versao
+ */
+static int eh_lapide_visivel(const Lapides* lapides, long posicao,
+                             unsigned long versao) {
+    int inicio = 0, fim = lapides->num;
+
+    while (inicio < fim) {
+        int meio = inicio + (fim - inicio) / 2;
+
+        if (lapides->itens[meio].posicao < posicao) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+
+    return inicio == lapides->num ||
+           lapides->itens[inicio].posicao != posicao ||
+           lapides->itens[inicio].versao > versao;
+}
+
+/**
+ * @brief Copies bytes of a segment, through the cursor's block
+ * @param cursor Cursor reading the segment
+ * @param segmento Segment being read
+ * @param posicao Offset of the bytes
+ * @param destino Output for the bytes
+ * @param n Number of bytes
+ * @return 1 on success, 0 if the file could not be read
+ */
+static int ler_bytes(CursorFrio* cursor, const Segmento* segmento,
+                     long posicao, void* destino, long n) {
+    if (posicao < cursor->inicio_bloco ||
+        posicao + n > cursor->inicio_bloco + cursor->len_bloco) {
+        ssize_t lidos;
+
+        if (n > SEGMENTO_BLOCO) {
+            return pread(segmento->fd, destino, n, posicao) == n;
+        }
+
+        lidos = pread(segmento->fd, cursor->bloco, SEGMENTO_BLOCO, posicao);
+        if (lidos < n) {
+            cursor->len_bloco = 0;
+            return 0;
+        }
+        cursor->inicio_bloco = posicao;
+        cursor->len_bloco = lidos;
+    }
+
+    memcpy(destino, cursor->bloco + (posicao - cursor->inicio_bloco), n);
+    return 1;
+}
+
+/**
+ * @brief Reads one record into the cursor's current record
+ * @param cursor Cursor reading the segment
+ * @param segmento Segment being read
+ * @param posicao Offset of the record
+ * @return Offset of the next record, or 0 if it could not be read
+ */
+static long ler_registo(CursorFrio* cursor, const Segmento* segmento,
+                        long posicao) {
+    User* registo = &cursor->registo;
+    uint32_t len_nome;
+    uint8_t len_vacina, len_lote;
+    int32_t data;
+
+    cursor->posicao_registo = posicao;
+    if (!ler_bytes(cursor, segmento, posicao, &len_nome, sizeof(len_nome))) {
+        return 0;
+    }
+    posicao += sizeof(len_nome);
+
+    if (len_nome + 1 > cursor->capacidade_nome) {
+        char* novo = (char*)realloc(cursor->nome_registo, len_nome + 1);
+
+        if (!novo) {
+            printf("No memory\n");
+            exit(1);
+        }
+        cursor->nome_registo = novo;
+        cursor->capacidade_nome = len_nome + 1;
+    }
+    if (!ler_bytes(cursor, segmento, posicao, cursor->nome_registo,
+                   len_nome)) {
+        return 0;
+    }
+    cursor->nome_registo[len_nome] = '\0';
+    posicao += len_nome;
+
+    if (!ler_bytes(cursor, segmento, posicao, &len_vacina, 1) ||
+        len_vacina >= MAX_NOME ||
+        !ler_bytes(cursor, segmento, posicao + 1, cursor->nome_vacina,
+                   len_vacina)) {
+        return 0;
+    }
+    cursor->nome_vacina[len_vacina] = '\0';
+    registo->nome_vacina = cursor->nome_vacina;
+    posicao += 1 + len_vacina;
+
+    if (!ler_bytes(cursor, segmento, posicao, &len_lote, 1) ||
+        len_lote >= MAX_NOME_LOTE ||
+        !ler_bytes(cursor, segmento, posicao + 1, registo->lote_usado,
+                   len_lote)) {
+        return 0;
+    }
+    registo->lote_usado[len_lote] = '\0';
+    posicao += 1 + len_lote;
+
+    if (!ler_bytes(cursor, segmento, posicao, &data, sizeof(data))) {
+        return 0;
+    }
+    registo->data_aplicacao = data;
+    registo->nome = cursor->nome_registo;
+    return posicao + sizeof(data);
+}
+
+/**
+ * @brief Finds the records of the cursor's user in a segment
+ *
+ * The filter rules most segments out. Otherwise the sparse index
+ * gives the only block of the user index the first entry of the hash
+ * can be in, and the entries are read from there.
+ *
+ * @param cursor Cursor reading a user
+ * @param segmento Segment to search
+ * @return Number of records whose user has the same hash
+ */
+static long procurar_utente(CursorFrio* cursor, const Segmento* segmento) {
+    EntradaSegmento entradas[SEGMENTO_PASSO];
+    uint64_t hash = hash_texto(cursor->nome);
+    unsigned int bits[2];
+    long inicio = 0, fim = segmento->num_amostras, i;
+
+    cursor->num_posicoes = 0;
+    cursor->proxima = 0;
+
+    bits_filtro(hash, bits);
+    if (!(segmento->filtro[bits[0] / 8] & (1 << (bits[0] % 8))) ||
+        !(segmento->filtro[bits[1] / 8] & (1 << (bits[1] % 8)))) {
+        return 0;
+    }
+
+    /* Number of sampled entries below the hash */
+    while (inicio < fim) {
+        long meio = inicio + (fim - inicio) / 2;
+
+        if (segmento->amostras[meio] < hash) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+
+    for (i = inicio > 0 ? (inicio - 1) * SEGMENTO_PASSO : 0;
+         i < segmento->num_entradas; i += SEGMENTO_PASSO) {
+        long n = segmento->num_entradas - i < SEGMENTO_PASSO ?
+                 segmento->num_entradas - i : SEGMENTO_PASSO;
+        long bytes = n * (long)sizeof(EntradaSegmento);
+        long j;
+
+        if (pread(segmento->fd, entradas, bytes, segmento->fim_registos +
+                  i * (long)sizeof(EntradaSegmento)) != bytes) {
+            return cursor->num_posicoes;
+        }
+
+        for (j = 0; j < n; j++) {
+            if (entradas[j].hash > hash) {
+                return cursor->num_posicoes;
+            }
+            if (entradas[j].hash < hash) {
+                continue;
+            }
+
+            if (cursor->num_posicoes == cursor->capacidade_posicoes) {
+                long capacidade = cursor->capacidade_posicoes ?
+                                  2 * cursor->capacidade_posicoes : 16;
+                long* novas = (long*)realloc(cursor->posicoes,
+                                             capacidade * sizeof(long));
+
+                if (!novas) {
+                    printf("No memory\n");
+                    exit(1);
+                }
+                cursor->posicoes = novas;
+                cursor->capacidade_posicoes = capacidade;
+            }
+            cursor->posicoes[cursor->num_posicoes++] =
+                (long)entradas[j].posicao;
+        }
+    }
+
+    return cursor->num_posicoes;
+}
+
+/**
+ * @brief Moves the cursor to the next segment that may hold its records
+ *
+ * Segments outside the cursor's days, without its vaccine, or that the
+ * user index rules out are skipped without reading their records.
+ *
+ * @param cursor Cursor whose segmento is the first one to consider
+ */
+static void preparar_segmento(CursorFrio* cursor) {
+    for (; cursor->segmento < cursor->num_segmentos; cursor->segmento++) {
+        Segmento* segmento = cursor->arquivo->segmentos[cursor->segmento];
+        long inicio = 0, fim = segmento->num_marcos;
+
+        if (segmento->ultimo_dia < cursor->inicio ||
+            segmento->primeiro_dia > cursor->fim) {
+            continue;
+        }
+        if (cursor->vacina >= 0 &&
+            (cursor->vacina >= segmento->num_vacinas ||
+             segmento->por_vacina[cursor->vacina] == 0)) {
+            continue;
+        }
+
+        cursor->len_bloco = 0;
+        cursor->lapides = __atomic_load_n(&segmento->lapides,
+                                          __ATOMIC_ACQUIRE);
+
+        if (cursor->nome) {
+            if (procurar_utente(cursor, segmento) == 0) {
+                continue;
+            }
+            return;
+        }
+
+        /* Start from the last sampled record before the first day */
+        while (inicio < fim) {
+            long meio = inicio + (fim - inicio) / 2;
+
+            if (segmento->marcos[meio].data < cursor->inicio) {
+                inicio = meio + 1;
+            } else {
+                fim = meio;
+            }
+        }
+        cursor->posicao = inicio > 0 ? segmento->marcos[inicio - 1].posicao :
+                          segmento->marcos[0].posicao;
+        return;
+    }
+}
+
+/**
+ * @brief Sets up a cursor with no filter
+ * @param cursor Cursor to start
+ * @param arquivo Pointer to the archive, or NULL
+ * @param num_segmentos Segments to read, from the first
+ * @param versao Deletions the cursor sees
+ */
+static void iniciar_cursor(CursorFrio* cursor, const ArquivoFrio* arquivo,
+                           int num_segmentos, unsigned long versao) {
+    memset(cursor, 0, sizeof(CursorFrio));
+    cursor->arquivo = arquivo;
+    cursor->num_segmentos = arquivo ? num_segmentos : 0;
+    cursor->segmento = -1;
+    cursor->inicio = INT_MIN;
+    cursor->fim = INT_MAX;
+    cursor->versao = versao;
+    cursor->vacina = -1;
+}
+
+/**
+ * @brief Starts reading the sealed applications of a range of days
+ * @param cursor Cursor to start
+ * @param arquivo Pointer to the archive, or NULL
+ * @param num_segmentos Segments to read, from the first
+ * @param inicio First day
+ * @param fim Last day
+ * @param versao Deletions the cursor sees
+ */
+void cursor_frio_abrir(CursorFrio* cursor, const ArquivoFrio* arquivo,
+                       int num_segmentos, Data inicio, Data fim,
+                       unsigned long versao) {
+    iniciar_cursor(cursor, arquivo, num_segmentos, versao);
+    cursor->inicio = inicio;
+    cursor->fim = fim;
+}
+
+/**
+ * @brief Starts reading the sealed applications of one user
+ * @param cursor Cursor to start
+ * @param arquivo Pointer to the archive, or NULL
+ * @param num_segmentos Segments to read, from the first
+ * @param nome User's name, which must outlive the cursor
+ * @param versao Deletions the cursor sees
+ */
+void cursor_frio_utente(CursorFrio* cursor, const ArquivoFrio* arquivo,
+                        int num_segmentos, const char* nome,
+                        unsigned long versao) {
+    iniciar_cursor(cursor, arquivo, num_segmentos, versao);
+    cursor->nome = nome;
+}
+
+/**
+ * @brief Reads the next application
+ *
+ * Deleted records, and records of other users whose names share the
+ * hash, are skipped.
+ *
+ * @param cursor Cursor started by cursor_frio_abrir or cursor_frio_utente
+ * @return The application, valid until the next call, or NULL at the end
+ */
+User* cursor_frio_proximo(CursorFrio* cursor) {
+    if (cursor->segmento < 0) {
+        if (cursor->num_segmentos == 0) {
+            return NULL;
+        }
+        cursor->bloco = (char*)malloc(SEGMENTO_BLOCO);
+        if (!cursor->bloco) {
+            printf("No memory\n");
+            exit(1);
+        }
+        cursor->segmento = 0;
+        preparar_segmento(cursor);
+    }
+
+    while (cursor->segmento < cursor->num_segmentos) {
+        const Segmento* segmento =
+            cursor->arquivo->segmentos[cursor->segmento];
+
+        if (cursor->nome) {
+            while (cursor->proxima < cursor->num_posicoes) {
+                long posicao = cursor->posicoes[cursor->proxima++];
+
+                if (!ler_registo(cursor, segmento, posicao)) {
+                    break;
+                }
+                if (strcmp(cursor->registo.nome, cursor->nome) == 0 &&
+                    cursor->registo.data_aplicacao >= cursor->inicio &&
+                    cursor->registo.data_aplicacao <= cursor->fim &&
+                    eh_lapide_visivel(cursor->lapides, posicao,
+                                      cursor->versao)) {
+                    return &cursor->registo;
+                }
+            }
+        } else {
+            while (cursor->posicao < segmento->fim_registos) {
+                long posicao = cursor->posicao;
+
+                cursor->posicao = ler_registo(cursor, segmento, posicao);
+                if (cursor->posicao == 0 ||
+                    cursor->registo.data_aplicacao > cursor->fim) {
+                    break;
+                }
+                if (cursor->registo.data_aplicacao >= cursor->inicio &&
+                    eh_lapide_visivel(cursor->lapides, posicao,
+                                      cursor->versao)) {
+                    return &cursor->registo;
+                }
+            }
+        }
+
+        cursor->segmento++;
+        preparar_segmento(cursor);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Frees what a cursor allocated
+ * @param cursor Cursor to close
+ */
+void cursor_frio_fechar(CursorFrio* cursor) {
+    free(cursor->bloco);
+    free(cursor->posicoes);
+    free(cursor->nome_registo);
+}
+
+/**
+ * @brief Checks if a user has sealed applications not deleted
+ * @param arquivo Pointer to the archive, or NULL
+ * @param nome User's name
+ * @param versao Deletions seen
+ * @return 1 if the user has one, 0 otherwise
+ */
+int frio_tem_utente(const ArquivoFrio* arquivo, const char* nome,
+                    unsigned long versao) {
+    CursorFrio cursor;
+    int encontrado;
+
+    if (!arquivo || arquivo->num_segmentos == 0) {
+        return 0;
+    }
+
+    cursor_frio_utente(&cursor, arquivo, arquivo->num_segmentos, nome,
+                       versao);
+    encontrado = cursor_frio_proximo(&cursor) != NULL;
+    cursor_frio_fechar(&cursor);
+    return encontrado;
+}
+
+/**
+ * @brief Counts the sealed applications of a vaccine not deleted
+ * @param arquivo Pointer to the archive, or NULL
+ * @param vacina Index entry of the vaccine
+ * @return Number of applications
+ */
+int frio_contar_vacina(const ArquivoFrio* arquivo, const Vacina* vacina) {
+    int i, total = 0;
+
+    if (!arquivo) {
+        return 0;
+    }
+
+    for (i = 0; i < arquivo->num_segmentos; i++) {
+        const Segmento* segmento = arquivo->segmentos[i];
+
+        if (vacina->id < segmento->num_vacinas) {
+            total += segmento->por_vacina[vacina->id];
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Publishes the new deletions of a segment
+ *
+ * The deletions are merged with the published ones into a new array,
+ * and the old array is retired, as a reader may still hold it.
+ *
+ * @param segmento Segment the records belong to
+ * @param novas New deletions, ordered by offset
+ * @param num_novas Number of new deletions
+ * @param epocas Epochs the old array is retired to
+ */
+static void publicar_lapides(Segmento* segmento, const Lapide* novas,
+                             int num_novas, Epocas* epocas) {
+    Lapides* antigas = segmento->lapides;
+    Lapides* lapides = (Lapides*)malloc(sizeof(Lapides) +
+                                        (antigas->num + num_novas) *
+                                        sizeof(Lapide));
+    int i = 0, j = 0, k = 0;
+
+    if (!lapides) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    while (i < antigas->num && j < num_novas) {
+        if (antigas->itens[i].posicao < novas[j].posicao) {
+            lapides->itens[k++] = antigas->itens[i++];
+        } else {
+            lapides->itens[k++] = novas[j++];
+        }
+    }
+    while (i < antigas->num) lapides->itens[k++] = antigas->itens[i++];
+    while (j < num_novas) lapides->itens[k++] = novas[j++];
+    lapides->num = k;
+
+    __atomic_store_n(&segmento->lapides, lapides, __ATOMIC_RELEASE);
+    epoca_retirar(epocas, antigas, free);
+}
+
+/**
+ * @brief Deletes sealed applications of a user, as d does
+ *
+ * The records are found as u finds them. Their segments only gain
+ * deletions, published once the cursor is done with each segment.
+ *
+ * @param arquivo Pointer to the archive, or NULL
+ * @param nome User's name
+ * @param data Date of the applications, or 0 for any
+ * @param nome_vacina Vaccine of the applications, or NULL for any
+ * @param versao Version of the deletion
+ * @param epocas Epochs the replaced deletions are retired to
+ * @param indice Batch index
+ * @param dias Day index
+ * @param filtro Filter of users with applications
+ * @return Number of applications deleted
+ */
+int frio_apagar(ArquivoFrio* arquivo, const char* nome, Data data,
+                const char* nome_vacina, unsigned long versao,
+                Epocas* epocas, IndiceLotes* indice, IndiceDias* dias,
+                FiltroBloom* filtro) {
+    CursorFrio cursor;
+    Lapide* novas = NULL;
+    int num_novas = 0, capacidade = 0, atual = -1, apagados = 0;
+    User* registo;
+
+    if (!arquivo || arquivo->num_segmentos == 0) {
+        return 0;
+    }
+
+    cursor_frio_utente(&cursor, arquivo, arquivo->num_segmentos, nome,
+                       versao);
+    if (data != 0) {
+        cursor.inicio = data;
+        cursor.fim = data;
+    }
+
+    while ((registo = cursor_frio_proximo(&cursor)) != NULL) {
+        Segmento* segmento = arquivo->segmentos[cursor.segmento];
+        Vacina* vacina;
+
+        if (nome_vacina && strcmp(registo->nome_vacina, nome_vacina) != 0) {
+            continue;
+        }
+
+        if (cursor.segmento != atual) {
+            if (num_novas > 0) {
+                publicar_lapides(arquivo->segmentos[atual], novas, num_novas,
+                                 epocas);
+            }
+            num_novas = 0;
+            atual = cursor.segmento;
+        }
+
+        if (num_novas == capacidade) {
+            Lapide* maiores;
+
+            capacidade = capacidade ? 2 * capacidade : 16;
+            maiores = (Lapide*)realloc(novas, capacidade * sizeof(Lapide));
+            if (!maiores) {
+                printf("No memory\n");
+                exit(1);
+            }
+            novas = maiores;
+        }
+        novas[num_novas].posicao = cursor.posicao_registo;
+        novas[num_novas].versao = versao;
+        num_novas++;
+
+        /* Keep the aggregate counters in step */
+        vacina = procurar_vacina(indice, registo->nome_vacina);
+        if (vacina) {
+            vacina->doses_aplicadas--;
+            if (vacina->id < segmento->num_vacinas) {
+                segmento->por_vacina[vacina->id]--;
+            }
+        }
+        dias_descontar(dias, registo->data_aplicacao);
+        bloom_remover(filtro, registo->nome);
+        segmento->vivos--;
+        apagados++;
+    }
+
+    if (num_novas > 0) {
+        publicar_lapides(arquivo->segmentos[atual], novas, num_novas,
+                         epocas);
+    }
+    cursor_frio_fechar(&cursor);
+    free(novas);
+    epoca_recolher(epocas);
+    return apagados;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file segmento.h
+ * @brief Old applications sealed into immutable segments on disk
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef SEGMENTO_H
+#define SEGMENTO_H
+
+#include <stdint.h>
+
+#include "data.h"
+#include "user.h"
+#include "vacina.h"
+#include "dias.h"
+#include "bloom.h"
+#include "epoca.h"
+
+/**< First bytes of a segment file */
+#define SEGMENTO_MAGIA "VACSEG1\n"
+
+/**< Records, and user index entries, per entry of the sparse indexes */
+#define SEGMENTO_PASSO 64
+
+/**< Bits of the filter of users of each segment (a power of two) */
+#define SEGMENTO_FILTRO 4096
+
+/**< Bytes a cursor reads from a segment at a time */
+#define SEGMENTO_BLOCO (1 << 16)
+
+/**
+ * @brief Entry of the user index of a segment, as stored in its file
+ */
+typedef struct EntradaSegmento {
+    uint64_t hash;              /**< hash_texto of the user's name */
+    uint64_t posicao;           /**< Offset of the record in the file */
+} EntradaSegmento;
+
+/**
+ * @brief Entry of the sparse date index of a segment
+ */
+typedef struct MarcoSegmento {
+    Data data;                  /**< Date of the record */
+    long posicao;               /**< Offset of the record in the file */
+} MarcoSegmento;
+
+/**
+ * @brief A sealed application deleted afterwards
+ */
+typedef struct Lapide {
+    long posicao;               /**< Offset of the record in the file */
+    unsigned long versao;       /**< Version of the deletion */
+} Lapide;
+
+/**
+ * @brief Deleted records of a segment, ordered by offset
+ *
+ * Never changed once published: a deletion publishes a new copy and
+ * retires the old one, so a reader holding it needs no lock.
+ */
+typedef struct Lapides {
+    int num;                    /**< Number of deleted records */
+    Lapide itens[];             /**< Deleted records */
+} Lapides;
+
+/**
+ * @brief A segment file and the summary of it kept in memory
+ */
+typedef struct Segmento {
+    int fd;                     /**< Open file, read with pread */
+    char* caminho;              /**< Path, unlinked when freed */
+    long registos;              /**< Records sealed into it */
+    long vivos;                 /**< Records not deleted */
+    Data primeiro_dia;          /**< Date of the first record */
+    Data ultimo_dia;            /**< Date of the last record */
+    long fim_registos;          /**< Offset where the records end */
+    long num_entradas;          /**< Entries of the user index */
+
+    /**< Users with records in the segment, or false positives */
+    unsigned char filtro[SEGMENTO_FILTRO / 8];
+
+    MarcoSegmento* marcos;      /**< Every SEGMENTO_PASSO-th record */
+    long num_marcos;            /**< Number of marcos */
+    uint64_t* amostras;         /**< Every SEGMENTO_PASSO-th index hash */
+    long num_amostras;          /**< Number of amostras */
+    int* por_vacina;            /**< Records not deleted, by vaccine id */
+    int num_vacinas;            /**< Size of por_vacina */
+    Lapides* lapides;           /**< Deleted records */
+} Segmento;
+
+/**
+ * @brief Every segment sealed so far
+ *
+ * Applications are given on the current date only, so once the date
+ * passes ate no application older than it can appear: segments hold
+ * every application up to ate, in the order u and p list them, and
+ * the list of users only holds newer ones. Segments are sealed only
+ * while no snapshot is taken, and never change afterwards, other than
+ * their deleted records.
+ */
+typedef struct ArquivoFrio {
+    char* diretorio;            /**< Directory the files are created in */
+    int idade;                  /**< Days an application stays in memory */
+    Data ate;                   /**< Applications before it are sealed */
+    Segmento** segmentos;       /**< Segments, oldest first */
+    int num_segmentos;          /**< Number of segments */
+    int capacidade;             /**< Allocated number of segments */
+} ArquivoFrio;
+
+/**
+ * @brief Reads sealed applications in the order they were given
+ *
+ * Either every record of a range of days, or only those of one user,
+ * found through the user index of each segment whose filter and
+ * sparse index say it may hold them.
+ */
+typedef struct CursorFrio {
+    const ArquivoFrio* arquivo; /**< Segments read */
+    int num_segmentos;          /**< Segments the cursor may read */
+    int segmento;               /**< Segment being read */
+    Data inicio;                /**< First day read */
+    Data fim;                   /**< Last day read */
+    unsigned long versao;       /**< Deletions the cursor sees */
+    const char* nome;           /**< User read, or NULL for all */
+    int vacina;                 /**< Only segments with this vaccine id */
+    Lapides* lapides;           /**< Deleted records of the segment */
+    long posicao;               /**< Next record of the segment */
+    long* posicoes;             /**< Records of the user in the segment */
+    long num_posicoes;          /**< Number of posicoes */
+    long proxima;               /**< Next of posicoes to read */
+    long capacidade_posicoes;   /**< Allocated size of posicoes */
+    char* bloco;                /**< SEGMENTO_BLOCO bytes of the file */
+    long inicio_bloco;          /**< Offset of bloco in the file */
+    long len_bloco;             /**< Valid bytes in bloco */
+    char* nome_registo;         /**< Name of the current record */
+    char nome_vacina[MAX_NOME]; /**< Vaccine of the current record */
+    size_t capacidade_nome;     /**< Allocated size of nome_registo */
+    long posicao_registo;       /**< Offset of the current record */
+    User registo;               /**< Current record */
+} CursorFrio;
+
+/**
+ * @brief Creates an empty archive
+ * @param diretorio Directory segment files are created in
+ * @param idade Days an application stays in memory
+ * @return Pointer to the newly created archive
+ */
+ArquivoFrio* criar_arquivo_frio(const char* diretorio, int idade);
+
+/**
+ * @brief Frees the archive and deletes its segment files
+ * @param arquivo Pointer to the archive, or NULL
+ */
+void free_arquivo_frio(ArquivoFrio* arquivo);
+
+/**
+ * @brief Seals the applications older than the archive's age
+ *
+ * Must not run while a snapshot is taken. The sealed records leave
+ * the list of users and their days, which keep their counts.
+ *
+ * @param arquivo Pointer to the archive
+ * @param lista Pointer to the head pointer of the user list
+ * @param dias Day index of the applications
+ * @param indice Batch index, for the vaccine of each application
+ * @param hoje Current date
+ * @return Number of applications sealed
+ */
+long selar_aplicacoes(ArquivoFrio* arquivo, User** lista, IndiceDias* dias,
+                      IndiceLotes* indice, Data hoje);
+
+/**
+ * @brief Starts reading the sealed applications of a range of days
+ * @param cursor Cursor to start
+ * @param arquivo Pointer to the archive, or NULL
+ * @param num_segmentos Segments to read, from the first
+ * @param inicio First day
+ * @param fim Last day
+ * @param versao Deletions the cursor sees
+ */
+void cursor_frio_abrir(CursorFrio* cursor, const ArquivoFrio* arquivo,
+                       int num_segmentos, Data inicio, Data fim,
+                       unsigned long versao);
+
+/**
+ * @brief Starts reading the sealed applications of one user
+ * @param cursor Cursor to start
+ * @param arquivo Pointer to the archive, or NULL
+ * @param num_segmentos Segments to read, from the first
+ * @param nome User's name, which must outlive the cursor
+ * @param versao Deletions the cursor sees
+ */
+void cursor_frio_utente(CursorFrio* cursor, const ArquivoFrio* arquivo,
+                        int num_segmentos, const char* nome,
+                        unsigned long versao);
+
+/**
+ * @brief Reads the next application
+ * @param cursor Cursor started by cursor_frio_abrir or cursor_frio_utente
+ * @return The application, valid until the next call, or NULL at the end
+ */
+User* cursor_frio_proximo(CursorFrio* cursor);
+
+/**
+ * @brief Frees what a cursor allocated
+ * @param cursor Cursor to close
+ */
+void cursor_frio_fechar(CursorFrio* cursor);
+
+/**
+ * @brief Checks if a user has sealed applications not deleted
+ * @param arquivo Pointer to the archive, or NULL
+ * @param nome User's name
+ * @param versao Deletions seen
+ * @return 1 if the user has one, 0 otherwise
+ */
+int frio_tem_utente(const ArquivoFrio* arquivo, const char* nome,
+                    unsigned long versao);
+
+/**
+ * @brief Counts the sealed applications of a vaccine not deleted
+ * @param arquivo Pointer to the archive, or NULL
+ * @param vacina Index entry of the vaccine
+ * @return Number of applications
+ */
+int frio_contar_vacina(const ArquivoFrio* arquivo, const Vacina* vacina);
+
+/**
+ * @brief Deletes sealed applications of a user, as d does
+ *
+ * Keeps the vaccine counters, the days and the filter of users in
+ * step, as deleting the records from memory would.
+ *
+ * @param arquivo Pointer to the archive, or NULL
+ * @param nome User's name
+ * @param data Date of the applications, or 0 for any
+ * @param nome_vacina Vaccine of the applications, or NULL for any
+ * @param versao Version of the deletion
+ * @param epocas Epochs the replaced deletions are retired to
+ * @param indice Batch index
+ * @param dias Day index
+ * @param filtro Filter of users with applications
+ * @return Number of applications deleted
+ */
+int frio_apagar(ArquivoFrio* arquivo, const char* nome, Data data,
+                const char* nome_vacina, unsigned long versao,
+                Epocas* epocas, IndiceLotes* indice, IndiceDias* dias,
+                FiltroBloom* filtro);
+
+#endif
@@ -0,0 +1,746 @@
+/**
+ * @file servidor.c
+ * @brief epoll-based server feeding client command lines to the handlers
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "servidor.h"
+
+/**
+ * @brief Kind of file descriptor registered in epoll
+ */
+typedef enum {
+    LIGACAO_ESCUTA,     /**< Listening socket */
+    LIGACAO_SINAL,      /**< signalfd for SIGINT and SIGTERM */
+    LIGACAO_LEITOR,     /**< eventfd signalled as queries are answered */
+    LIGACAO_CLIENTE     /**< Connected client */
+} TipoLigacao;
+
+/**
+ * @brief A file descriptor watched by the server, with client buffers
+ */
+typedef struct Ligacao {
+    TipoLigacao tipo;           /**< What the descriptor is */
+    int fd;                     /**< File descriptor */
+    char* entrada;              /**< Bytes received but not yet run */
+    size_t entrada_len;         /**< Number of bytes in entrada */
+    size_t entrada_cap;         /**< Allocated size of entrada */
+    char* saida;                /**< Responses not yet sent */
+    size_t saida_len;           /**< Number of bytes in saida */
+    size_t saida_enviado;       /**< Bytes of saida already sent */
+    int fim_entrada;            /**< 1 once the client shut down writing */
+    int fechar;                 /**< 1 once the client sent q */
+    int ocupado;                /**< 1 while a query of it is answered */
+    int vigiado;                /**< 1 while registered in epoll */
+    int fechado;                /**< 1 once closed with a query running */
+    struct Ligacao* next;       /**< Next client in the server's list */
+} Ligacao;
+
+/**
+ * @brief A query handed to the reader thread
+ */
+typedef struct Tarefa {
+    Consulta* consulta;         /**< Snapshot to answer */
+    Ligacao* cliente;           /**< Client the response goes to */
+    char* resposta;             /**< Response, once written */
+    size_t resposta_len;        /**< Number of bytes in resposta */
+    struct Tarefa* next;        /**< Next task in the same queue */
+} Tarefa;
+
+/**
+ * @brief Thread answering l and u from snapshots
+ *
+ * The server thread queues a task per query and goes on running other
+ * clients' commands; the reader queues it back as answered and wakes the
+ * server through an eventfd.
+ */
+typedef struct Leitor {
+    pthread_t thread;           /**< Reader thread */
+    pthread_mutex_t trinco;     /**< Guards the queues and terminar */
+    pthread_cond_t tarefas;     /**< Signalled as tasks are queued */
+    Tarefa* pendentes;          /**< Tasks to answer, oldest first */
+    Tarefa* ultima_pendente;    /**< Last task in pendentes */
+    Tarefa* respondidas;        /**< Answered tasks, newest first */
+    int terminar;               /**< 1 once the reader should stop */
+    int a_correr;               /**< 1 while the thread exists */
+    Ligacao aviso;              /**< eventfd the reader signals */
+} Leitor;
+
+/**
+ * @brief State of a running server
+ */
+typedef struct Servidor {
+    Sistema* sistema;           /**< System the commands run against */
+    int epoll_fd;               /**< epoll instance */
+    Ligacao escuta;             /**< Listening socket */
+    Ligacao sinal;              /**< Shutdown signal descriptor */
+    Ligacao* clientes;          /**< Connected clients */
+    Leitor leitor;              /**< Thread answering l and u */
+    const char* caminho_unix;   /**< Socket path to unlink, or NULL */
+} Servidor;
+
+/**
+ * @brief Checks if an address is a TCP port number
+ * @param endereco Address given on the command line
+ * @return 1 if it only has decimal digits, 0 otherwise
+ */
+static int eh_porta(const char* endereco) {
+    if (*endereco == '\0') return 0;
+
+    while (*endereco) {
+        if (!isdigit((unsigned char)*endereco++)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Opens the non-blocking listening socket
+ * @param servidor Server being set up
+ * @param endereco Port number or Unix socket path
+ * @return Socket descriptor, or -1 on error
+ */
+static int abrir_escuta(Servidor* servidor, const char* endereco) {
+    int fd, ativo = 1;
+
+    if (eh_porta(endereco)) {
+        struct sockaddr_in addr;
+
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) return -1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &ativo, sizeof(ativo));
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)atoi(endereco));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un addr;
+
+        if (strlen(endereco) >= sizeof(addr.sun_path)) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, endereco);
+        unlink(endereco);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+        servidor->caminho_unix = endereco;
+    }
+
+    if (listen(fd, SERVIDOR_BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Opens a descriptor that becomes readable on SIGINT or SIGTERM
+ * @return Signal descriptor, or -1 on error
+ */
+static int abrir_sinais(void) {
+    sigset_t sinais;
+
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &sinais, NULL) < 0) return -1;
+
+    return signalfd(-1, &sinais, SFD_NONBLOCK);
+}
+
+/**
+ * @brief Sets the epoll events a client is waiting for
+ *
+ * Input is only read while the client's pending output is below
+ * SERVIDOR_LIMITE_SAIDA, so a client that stops reading its responses
+ * cannot make the server buffer without bound. A client waiting for a
+ * query is left out of epoll, which would still report hang-ups.
+ *
+ * @param servidor Running server
+ * @param cliente Client connection
+ */
+static void atualizar_eventos(Servidor* servidor, Ligacao* cliente) {
+    struct epoll_event evento;
+    size_t pendente = cliente->saida_len - cliente->saida_enviado;
+
+    if (cliente->ocupado) {
+        if (cliente->vigiado) {
+            epoll_ctl(servidor->epoll_fd, EPOLL_CTL_DEL, cliente->fd, NULL);
+            cliente->vigiado = 0;
+        }
+        return;
+    }
+
+    evento.events = 0;
+    if (pendente > 0) evento.events |= EPOLLOUT;
+    if (!cliente->fechar && !cliente->fim_entrada &&
+        pendente < SERVIDOR_LIMITE_SAIDA) {
+        evento.events |= EPOLLIN;
+    }
+    evento.data.ptr = cliente;
+    epoll_ctl(servidor->epoll_fd,
+              cliente->vigiado ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+              cliente->fd, &evento);
+    cliente->vigiado = 1;
+}
+
+/**
+ * @brief Frees a closed client's buffers
+ * @param cliente Client connection
+ */
+static void libertar_cliente(Ligacao* cliente) {
+    free(cliente->entrada);
+    free(cliente->saida);
+    free(cliente);
+}
+
+/**
+ * @brief Closes a client connection and frees its buffers
+ *
+ * A client whose query is still being answered is freed once the
+ * answer comes back.
+ *
+ * @param servidor Running server
+ * @param cliente Client connection
+ */
+static void fechar_cliente(Servidor* servidor, Ligacao* cliente) {
+    Ligacao** ligacao = &servidor->clientes;
+
+    while (*ligacao != cliente) {
+        ligacao = &(*ligacao)->next;
+    }
+    *ligacao = cliente->next;
+
+    if (cliente->vigiado) {
+        epoll_ctl(servidor->epoll_fd, EPOLL_CTL_DEL, cliente->fd, NULL);
+    }
+    close(cliente->fd);
+    if (cliente->ocupado) {
+        cliente->fechado = 1;
+    } else {
+        libertar_cliente(cliente);
+    }
+}
+
+/**
+ * @brief Accepts every pending connection
+ * @param servidor Running server
+ */
+static void aceitar_clientes(Servidor* servidor) {
+    int fd;
+
+    while ((fd = accept4(servidor->escuta.fd, NULL, NULL,
+                         SOCK_NONBLOCK)) >= 0) {
+        struct epoll_event evento;
+        Ligacao* cliente = (Ligacao*)calloc(1, sizeof(Ligacao));
+
+        if (!cliente) {
+            printf("No memory\n");
+            exit(1);
+        }
+
+        cliente->tipo = LIGACAO_CLIENTE;
+        cliente->fd = fd;
+        cliente->next = servidor->clientes;
+        servidor->clientes = cliente;
+
+        evento.events = EPOLLIN;
+        evento.data.ptr = cliente;
+        epoll_ctl(servidor->epoll_fd, EPOLL_CTL_ADD, fd, &evento);
+        cliente->vigiado = 1;
+    }
+}
+
+/**
+ * @brief Answers queued queries until told to stop
+ *
+ * Finishes every task queued before terminar was set.
+ *
+ * @param argumento Running server
+ * @return NULL
+ */
+static void* correr_leitor(void* argumento) {
+    Servidor* servidor = (Servidor*)argumento;
+    Leitor* leitor = &servidor->leitor;
+    uint64_t um = 1;
+
+    while (1) {
+        Tarefa* tarefa;
+        FILE* saida;
+
+        pthread_mutex_lock(&leitor->trinco);
+        while (!leitor->pendentes && !leitor->terminar) {
+            pthread_cond_wait(&leitor->tarefas, &leitor->trinco);
+        }
+        tarefa = leitor->pendentes;
+        if (tarefa) {
+            leitor->pendentes = tarefa->next;
+        }
+        pthread_mutex_unlock(&leitor->trinco);
+
+        if (!tarefa) {
+            return NULL;
+        }
+
+        saida = open_memstream(&tarefa->resposta, &tarefa->resposta_len);
+        if (!saida) {
+            printf("No memory\n");
+            exit(1);
+        }
+        responder_consulta(tarefa->consulta, saida);
+        fclose(saida);
+
+        pthread_mutex_lock(&leitor->trinco);
+        tarefa->next = leitor->respondidas;
+        leitor->respondidas = tarefa;
+        pthread_mutex_unlock(&leitor->trinco);
+        write(leitor->aviso.fd, &um, sizeof(um));
+    }
+}
+
+/**
+ * @brief Hands a query to the reader thread
+ *
+ * The client runs nothing else until the answer comes back, so its
+ * responses keep the order of its commands.
+ *
+ * @param servidor Running server
+ * @param cliente Client that sent the query
+ * @param consulta Snapshot taken for the query
+ */
+static void submeter_consulta(Servidor* servidor, Ligacao* cliente,
+                              Consulta* consulta) {
+    Leitor* leitor = &servidor->leitor;
+    Tarefa* tarefa = (Tarefa*)calloc(1, sizeof(Tarefa));
+
+    if (!tarefa) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    tarefa->consulta = consulta;
+    tarefa->cliente = cliente;
+    cliente->ocupado = 1;
+
+    pthread_mutex_lock(&leitor->trinco);
+    if (leitor->pendentes) {
+        leitor->ultima_pendente->next = tarefa;
+    } else {
+        leitor->pendentes = tarefa;
+    }
+    leitor->ultima_pendente = tarefa;
+    pthread_cond_signal(&leitor->tarefas);
+    pthread_mutex_unlock(&leitor->trinco);
+}
+
+/**
+ * @brief Runs one command line through the system
+ *
+ * Mirrors the standard input loop: leading blanks are skipped, the first
+ * character is the command and the rest of the line is its input.
+ * Queries only take their snapshot here and are answered by the reader.
+ *
+ * @param servidor Running server
+ * @param cliente Client that sent the line
+ * @param linha Start of the line
+ * @param fim One past the line's newline
+ * @param saida Stream collecting the client's responses
+ * @return 0 if the command was q, 1 otherwise
+ */
+static int executar_linha(Servidor* servidor, Ligacao* cliente,
+                          char* linha, char* fim, FILE* saida) {
+    FILE* entrada;
+    int continuar;
+
+    while (linha < fim && isspace((unsigned char)*linha)) linha++;
+    if (linha == fim) {
+        return 1;
+    }
+
+    entrada = fmemopen(linha + 1, fim - linha - 1, "r");
+    if (!entrada) {
+        printf("No memory\n");
+        exit(1);
+    }
+    if (eh_consulta(*linha)) {
+        unsigned long long inicio = sistema_ciclos();
+        Consulta* consulta;
+
+        traco_comecar(servidor->sistema->traco, inicio);
+        consulta = preparar_consulta(servidor->sistema, *linha, entrada,
+                                     saida);
+
+        /* Only the snapshot holds up the commands; the reader answers */
+        traco_comando(servidor->sistema->traco, *linha, inicio,
+                      contar_comando(servidor->sistema, *linha, inicio));
+        if (consulta) {
+            submeter_consulta(servidor, cliente, consulta);
+        }
+        continuar = 1;
+    } else {
+        continuar = executar_comando(servidor->sistema, *linha, entrada,
+                                     saida);
+    }
+    fclose(entrada);
+
+    return continuar;
+}
+
+/**
+ * @brief Queues responses after the client's pending output
+ * @param cliente Client connection
+ * @param resposta Responses to queue
+ * @param resposta_len Number of bytes in resposta
+ */
+static void juntar_saida(Ligacao* cliente, const char* resposta,
+                         size_t resposta_len) {
+    char* novo;
+
+    if (resposta_len == 0) {
+        return;
+    }
+
+    novo = (char*)realloc(cliente->saida, cliente->saida_len + resposta_len);
+    if (!novo) {
+        printf("No memory\n");
+        exit(1);
+    }
+    memcpy(novo + cliente->saida_len, resposta, resposta_len);
+    cliente->saida = novo;
+    cliente->saida_len += resposta_len;
+}
+
+/**
+ * @brief Runs the client's complete command lines and queues the output
+ *
+ * Stops early once the new output reaches SERVIDOR_LIMITE_SAIDA, or
+ * after a query; the remaining lines stay buffered until the client has
+ * read the output, or the query is answered.
+ *
+ * @param servidor Running server
+ * @param cliente Client connection
+ */
+static void processar_entrada(Servidor* servidor, Ligacao* cliente) {
+    char* inicio = cliente->entrada;
+    char* fim_dados = cliente->entrada + cliente->entrada_len;
+    char* resposta = NULL;
+    size_t resposta_len = 0;
+    FILE* saida = open_memstream(&resposta, &resposta_len);
+    char* fim_linha;
+
+    if (!saida) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    while (!cliente->fechar && !cliente->ocupado &&
+           ftell(saida) < SERVIDOR_LIMITE_SAIDA &&
+           (fim_linha = memchr(inicio, '\n', fim_dados - inicio)) != NULL) {
+        if (!executar_linha(servidor, cliente, inicio, fim_linha + 1,
+                            saida)) {
+            cliente->fechar = 1;
+        }
+        inicio = fim_linha + 1;
+    }
+    fclose(saida);
+
+    cliente->entrada_len = fim_dados - inicio;
+    memmove(cliente->entrada, inicio, cliente->entrada_len);
+
+    juntar_saida(cliente, resposta, resposta_len);
+    free(resposta);
+}
+
+/**
+ * @brief Sends as much pending output as the socket accepts
+ * @param cliente Client connection
+ * @return 0 if the connection failed, 1 otherwise
+ */
+static int enviar_saida(Ligacao* cliente) {
+    while (cliente->saida_enviado < cliente->saida_len) {
+        ssize_t n = send(cliente->fd, cliente->saida + cliente->saida_enviado,
+                         cliente->saida_len - cliente->saida_enviado,
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        cliente->saida_enviado += n;
+    }
+
+    cliente->saida_len = 0;
+    cliente->saida_enviado = 0;
+    return 1;
+}
+
+/**
+ * @brief Appends everything readable from the socket to the input buffer
+ *
+ * A final line without a newline is completed when the client
+ * shuts down its side, as fgets would return it on standard input.
+ *
+ * @param cliente Client connection
+ * @return 0 if the connection failed, 1 otherwise
+ */
+static int ler_entrada(Ligacao* cliente) {
+    while (1) {
+        ssize_t n;
+
+        if (cliente->entrada_cap - cliente->entrada_len <
+            SERVIDOR_BLOCO_LEITURA + 1) {
+            size_t nova_cap = cliente->entrada_cap * 2 +
+                              SERVIDOR_BLOCO_LEITURA + 1;
+            char* novo = (char*)realloc(cliente->entrada, nova_cap);
+            if (!novo) {
+                printf("No memory\n");
+                exit(1);
+            }
+            cliente->entrada = novo;
+            cliente->entrada_cap = nova_cap;
+        }
+
+        n = recv(cliente->fd, cliente->entrada + cliente->entrada_len,
+                 SERVIDOR_BLOCO_LEITURA, 0);
+        if (n > 0) {
+            cliente->entrada_len += n;
+        } else if (n == 0) {
+            if (cliente->entrada_len > 0) {
+                cliente->entrada[cliente->entrada_len++] = '\n';
+            }
+            cliente->fim_entrada = 1;
+            return 1;
+        } else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+}
+
+/**
+ * @brief Handles readiness of a client connection
+ * @param servidor Running server
+ * @param cliente Client connection
+ * @param eventos Events reported by epoll
+ */
+static void tratar_cliente(Servidor* servidor, Ligacao* cliente,
+                           unsigned int eventos) {
+    int ok = 1;
+
+    if ((eventos & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !cliente->fim_entrada) {
+        ok = ler_entrada(cliente);
+    }
+
+    /* Keep running buffered lines for as long as the output drains */
+    while (ok) {
+        processar_entrada(servidor, cliente);
+        ok = enviar_saida(cliente);
+        if (cliente->saida_len > 0 || cliente->fechar || cliente->ocupado ||
+            !memchr(cliente->entrada, '\n', cliente->entrada_len)) {
+            break;
+        }
+    }
+
+    if (!ok || (cliente->saida_len == 0 && !cliente->ocupado &&
+                (cliente->fechar || cliente->fim_entrada))) {
+        fechar_cliente(servidor, cliente);
+    } else {
+        atualizar_eventos(servidor, cliente);
+    }
+}
+
+/**
+ * @brief Hands answered queries back to their clients
+ *
+ * Snapshots are released here, on the thread that changes the system.
+ * Each client then runs the commands it sent after its query, unless it
+ * was closed in the meantime.
+ *
+ * @param servidor Running server
+ * @param retomar 0 when shutting down, so no client runs anything else
+ */
+static void concluir_consultas(Servidor* servidor, int retomar) {
+    Leitor* leitor = &servidor->leitor;
+    Tarefa* tarefa;
+    uint64_t avisos;
+
+    read(leitor->aviso.fd, &avisos, sizeof(avisos));
+
+    pthread_mutex_lock(&leitor->trinco);
+    tarefa = leitor->respondidas;
+    leitor->respondidas = NULL;
+    pthread_mutex_unlock(&leitor->trinco);
+
+    while (tarefa) {
+        Tarefa* seguinte = tarefa->next;
+        Ligacao* cliente = tarefa->cliente;
+
+        terminar_consulta(servidor->sistema, tarefa->consulta);
+        cliente->ocupado = 0;
+        if (cliente->fechado) {
+            libertar_cliente(cliente);
+        } else {
+            juntar_saida(cliente, tarefa->resposta, tarefa->resposta_len);
+            if (retomar) {
+                tratar_cliente(servidor, cliente, 0);
+            }
+        }
+
+        free(tarefa->resposta);
+        free(tarefa);
+        tarefa = seguinte;
+    }
+}
+
+/**
+ * @brief Starts the reader thread
+ * @param servidor Server being set up, with the reader's eventfd open
+ * @return 0 on success, -1 on error
+ */
+static int iniciar_leitor(Servidor* servidor) {
+    Leitor* leitor = &servidor->leitor;
+
+    pthread_mutex_init(&leitor->trinco, NULL);
+    pthread_cond_init(&leitor->tarefas, NULL);
+    if (pthread_create(&leitor->thread, NULL, correr_leitor, servidor) != 0) {
+        pthread_cond_destroy(&leitor->tarefas);
+        pthread_mutex_destroy(&leitor->trinco);
+        return -1;
+    }
+
+    leitor->a_correr = 1;
+    return 0;
+}
+
+/**
+ * @brief Stops the reader thread once every queued query is answered
+ * @param servidor Server being shut down
+ */
+static void parar_leitor(Servidor* servidor) {
+    Leitor* leitor = &servidor->leitor;
+
+    if (!leitor->a_correr) return;
+
+    pthread_mutex_lock(&leitor->trinco);
+    leitor->terminar = 1;
+    pthread_cond_signal(&leitor->tarefas);
+    pthread_mutex_unlock(&leitor->trinco);
+    pthread_join(leitor->thread, NULL);
+    leitor->a_correr = 0;
+
+    concluir_consultas(servidor, 0);
+    pthread_cond_destroy(&leitor->tarefas);
+    pthread_mutex_destroy(&leitor->trinco);
+}
+
+/**
+ * @brief Registers a listening, signal or reader descriptor in epoll
+ * @param servidor Server being set up
+ * @param ligacao Descriptor to watch
+ * @return 0 on success, -1 on error
+ */
+static int registar(Servidor* servidor, Ligacao* ligacao) {
+    struct epoll_event evento;
+
+    evento.events = EPOLLIN;
+    evento.data.ptr = ligacao;
+    return epoll_ctl(servidor->epoll_fd, EPOLL_CTL_ADD, ligacao->fd, &evento);
+}
+
+/**
+ * @brief Closes every descriptor the server opened
+ * @param servidor Server being shut down
+ */
+static void fechar_servidor(Servidor* servidor) {
+    parar_leitor(servidor);
+    while (servidor->clientes) {
+        fechar_cliente(servidor, servidor->clientes);
+    }
+    if (servidor->escuta.fd >= 0) close(servidor->escuta.fd);
+    if (servidor->sinal.fd >= 0) close(servidor->sinal.fd);
+    if (servidor->leitor.aviso.fd >= 0) close(servidor->leitor.aviso.fd);
+    if (servidor->epoll_fd >= 0) close(servidor->epoll_fd);
+    if (servidor->caminho_unix) unlink(servidor->caminho_unix);
+}
+
+/**
+ * @brief Serves commands from local clients until SIGINT or SIGTERM
+ * @param sistema Pointer to the system
+ * @param endereco Port number or Unix socket path
+ * @return 0 on clean shutdown, 1 if the socket could not be set up
+ */
+int executar_servidor(Sistema* sistema, const char* endereco) {
+    struct epoll_event eventos[SERVIDOR_MAX_EVENTOS];
+    Servidor servidor;
+    int a_correr = 1;
+
+    memset(&servidor, 0, sizeof(servidor));
+    servidor.sistema = sistema;
+    servidor.escuta.tipo = LIGACAO_ESCUTA;
+    servidor.sinal.tipo = LIGACAO_SINAL;
+    servidor.leitor.aviso.tipo = LIGACAO_LEITOR;
+    servidor.escuta.fd = abrir_escuta(&servidor, endereco);
+    servidor.sinal.fd = abrir_sinais();
+    servidor.leitor.aviso.fd = eventfd(0, EFD_NONBLOCK);
+    servidor.epoll_fd = epoll_create1(0);
+
+    /* The reader starts after the signals are blocked, so it never
+     * receives them */
+    if (servidor.escuta.fd < 0 || servidor.sinal.fd < 0 ||
+        servidor.leitor.aviso.fd < 0 || servidor.epoll_fd < 0 ||
+        registar(&servidor, &servidor.escuta) < 0 ||
+        registar(&servidor, &servidor.sinal) < 0 ||
+        registar(&servidor, &servidor.leitor.aviso) < 0 ||
+        iniciar_leitor(&servidor) < 0) {
+        perror(endereco);
+        fechar_servidor(&servidor);
+        return 1;
+    }
+
+    while (a_correr) {
+        int i, respondidas = 0, n = epoll_wait(servidor.epoll_fd, eventos,
+                                               SERVIDOR_MAX_EVENTOS, -1);
+        if (n < 0 && errno != EINTR) break;
+
+        for (i = 0; i < n; i++) {
+            Ligacao* ligacao = (Ligacao*)eventos[i].data.ptr;
+
+            if (ligacao->tipo == LIGACAO_ESCUTA) {
+                aceitar_clientes(&servidor);
+            } else if (ligacao->tipo == LIGACAO_SINAL) {
+                a_correr = 0;
+            } else if (ligacao->tipo == LIGACAO_LEITOR) {
+                respondidas = 1;
+            } else {
+                tratar_cliente(&servidor, ligacao, eventos[i].events);
+            }
+        }
+
+        /* Resuming a client may close it, so only once no event of this
+         * batch still points to it */
+        if (respondidas) {
+            concluir_consultas(&servidor, 1);
+        }
+    }
+
+    fechar_servidor(&servidor);
+    return 0;
+}
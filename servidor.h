@@ -0,0 +1,40 @@
+/**
+ * @file servidor.h
+ * @brief Server mode serving commands to many clients over a local socket
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include "sistema.h"
+
+/**< Maximum number of pending connections on the listening socket */
+#define SERVIDOR_BACKLOG 1024
+
+/**< Maximum number of events handled per epoll_wait call */
+#define SERVIDOR_MAX_EVENTOS 256
+
+/**< Bytes read from a client socket per read call */
+#define SERVIDOR_BLOCO_LEITURA 65536
+
+/**< Pending output above which a client's input is no longer processed */
+#define SERVIDOR_LIMITE_SAIDA (1 << 20)
+
+/**
+ * @brief Serves commands from local clients until SIGINT or SIGTERM
+ *
+ * Each connection sends command lines exactly as on standard input and
+ * receives the responses on the same connection. Commands from all
+ * clients run one at a time against the same system state; q closes
+ * only the connection that sent it. l and u take a snapshot and are
+ * answered on a reader thread, so other clients' commands keep running
+ * while a long listing is written.
+ *
+ * @param sistema Pointer to the system
+ * @param endereco Port number for a localhost TCP socket,
+ * or the path of a Unix domain socket
+ * @return 0 on clean shutdown, 1 if the socket could not be set up
+ */
+int executar_servidor(Sistema* sistema, const char* endereco);
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ * @file sistema.h
+ * @brief State of the vaccine management system and command dispatch
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#ifndef SISTEMA_H
+#define SISTEMA_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "data.h"
+#include "vacina.h"
+#include "user.h"
+#include "bloom.h"
+#include "dias.h"
+#include "segmento.h"
+#include "mensagens.h"
+#include "traco.h"
+
+/**< Commands timed, one per byte a command letter can be */
+#define SISTEMA_COMANDOS 256
+
+/**
+ * @brief Time spent in one command letter
+ */
+typedef struct ContadorComando {
+    unsigned long long ciclos;      /**< Total sistema_ciclos it took */
+    long contagem;                  /**< Number of times it ran */
+} ContadorComando;
+
+/**
+ * @brief Checkpoint being written by a child process
+ */
+typedef struct Salvaguarda {
+    pid_t pid;                      /**< Child writing it, or 0 if none */
+    char* caminho;                  /**< Path of the file */
+    long long pausa;                /**< Nanoseconds fork stopped commands */
+} Salvaguarda;
+
+/**
+ * @brief Everything a command can read or change
+ */
+typedef struct Sistema {
+    LoteVacina* lista_vacinas;      /**< All batches, newest first */
+    IndiceLotes* indice_lotes;      /**< Dose selection and expiry index */
+    User* lista_users;              /**< All applications, newest first */
+    FiltroBloom* filtro_utentes;    /**< Users that have applications */
+    IndiceUtentes* indice_utentes;  /**< Latest dose of each user */
+    IndiceDias* indice_dias;        /**< Applications of each day */
+    Data data_sistema;              /**< Current simulated date */
+    const Mensagem* mensagens;      /**< Messages of the selected language */
+    unsigned long versao;           /**< Deletions made while queries ran */
+    struct Consulta* consultas;     /**< Snapshots not yet released */
+    int apagados_pendentes;         /**< Deleted records kept for snapshots */
+    Epocas* epocas;                 /**< Records readers may still hold */
+    ArquivoFrio* frio;              /**< Sealed applications, or NULL */
+    Arena* arena;                   /**< Applications and their names */
+    Salvaguarda salvaguarda;        /**< Checkpoint being written */
+    Traco* traco;                   /**< Spans of the commands, or NULL */
+
+    /**< Time spent in each command letter */
+    ContadorComando comandos[SISTEMA_COMANDOS];
+
+    unsigned long long ciclos_inicio;   /**< sistema_ciclos at creation */
+    long long relogio_inicio;           /**< sistema_relogio at creation */
+
+    char* linha;                    /**< Arguments of the current command */
+    size_t capacidade_linha;        /**< Allocated size of linha */
+} Sistema;
+
+/**
+ * @brief Snapshot a read-only command is answered from
+ *
+ * l and u are split in three steps so their output can be written on
+ * another thread: the snapshot is taken and released on the thread that
+ * runs every other command, and answered anywhere in between while that
+ * thread keeps changing the system. Each snapshot pins an epoch until
+ * it is answered, so no record it can reach is freed before then.
+ */
+typedef struct Consulta Consulta;
+
+/**
+ * @brief Creates an empty system set to the initial date 01-01-2025
+ * @param idioma Language of the messages
+ * @return Pointer to the newly created system
+ */
+Sistema* criar_sistema(Idioma idioma);
+
+/**
+ * @brief Frees the system and every structure it owns
+ * @param sistema Pointer to the system
+ */
+void free_sistema(Sistema* sistema);
+
+/**
+ * @brief Reads the rest of the current line into the system's buffer
+ *
+ * Commands parse their arguments in place in the buffer, which grows
+ * to the longest line read and is reused by every command.
+ *
+ * @param sistema Pointer to the system
+ * @param entrada Stream holding the rest of the command line
+ * @return The line with its newline, valid until the next call, or NULL
+ * at the end of the input
+ */
+char* ler_linha(Sistema* sistema, FILE* entrada);
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds
+ * @return Nanoseconds since an arbitrary starting point
+ */
+long long sistema_relogio(void);
+
+/**
+ * @brief Returns a cheap timestamp, in cycles of the time-stamp counter
+ *
+ * Where there is no such counter it is sistema_relogio.
+ *
+ * @return Ticks since an arbitrary starting point
+ */
+unsigned long long sistema_ciclos(void);
+
+/**
+ * @brief Returns the nanoseconds a number of sistema_ciclos ticks take
+ *
+ * The rate is measured over the life of the system, so it needs no
+ * calibration at startup.
+ *
+ * @param sistema Pointer to the system
+ * @param ciclos Ticks to convert
+ * @return Nanoseconds
+ */
+double sistema_nanos(const Sistema* sistema, unsigned long long ciclos);
+
+/**
+ * @brief Adds the time of one command to its letter's counter
+ * @param sistema Pointer to the system
+ * @param comando Command letter
+ * @param inicio sistema_ciclos when the command started
+ * @return sistema_ciclos when it ended
+ */
+unsigned long long contar_comando(Sistema* sistema, char comando,
+                                  unsigned long long inicio);
+
+/**
+ * @brief Runs one command against the system state
+ * @param sistema Pointer to the system
+ * @param comando Command letter
+ * @param entrada Stream holding the rest of the command line
+ * @param saida Stream the response is written to
+ * @return 0 if the command was q, 1 otherwise
+ */
+int executar_comando(Sistema* sistema, char comando, FILE* entrada,
+                     FILE* saida);
+
+/**
+ * @brief Checks if a command is answered from a snapshot
+ * @param comando Command letter
+ * @return 1 for l and u, 0 otherwise
+ */
+int eh_consulta(char comando);
+
+/**
+ * @brief Reads a query's arguments and takes its snapshot
+ * @param sistema Pointer to the system
+ * @param comando l or u
+ * @param entrada Stream holding the rest of the command line
+ * @param saida Stream errors are written to
+ * @return Snapshot to answer and then release, or NULL if there was no
+ * memory for it
+ */
+Consulta* preparar_consulta(Sistema* sistema, char comando, FILE* entrada,
+                            FILE* saida);
+
+/**
+ * @brief Writes a query's response from its snapshot
+ *
+ * Reads nothing the system changes afterwards, so it may run on any
+ * thread while commands keep running on the system.
+ *
+ * @param consulta Snapshot taken by preparar_consulta
+ * @param saida Stream the response is written to
+ */
+void responder_consulta(Consulta* consulta, FILE* saida);
+
+/**
+ * @brief Releases a snapshot once its response was written
+ * @param sistema Pointer to the system the snapshot was taken from
+ * @param consulta Snapshot to free
+ */
+void terminar_consulta(Sistema* sistema, Consulta* consulta);
+
+#endif
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Times each build of proj on the same workload and reports its speedup
+# over the first one. Every build must produce the first one's output.
+#
+#   tools/bench.sh <workload> <repetitions> <binary>...
+
+carga=$1
+repeticoes=$2
+shift 2
+
+referencia=""
+base=""
+for bin in "$@"; do
+    ./$bin < "$carga" > "$carga.$bin.out"
+    if [ -z "$referencia" ]; then
+        referencia="$carga.$bin.out"
+    elif ! cmp -s "$referencia" "$carga.$bin.out"; then
+        echo "$bin: output differs from the first build" >&2
+        exit 1
+    fi
+
+    # Best wall-clock time of the repetitions, in milliseconds
+    melhor=""
+    i=0
+    while [ $i -lt "$repeticoes" ]; do
+        inicio=$(date +%s%N)
+        ./$bin < "$carga" > /dev/null
+        fim=$(date +%s%N)
+        ms=$(( (fim - inicio) / 1000000 ))
+        if [ -z "$melhor" ] || [ $ms -lt "$melhor" ]; then
+            melhor=$ms
+        fi
+        i=$((i + 1))
+    done
+
+    [ -z "$base" ] && base=$melhor
+    awk -v b="$bin" -v t="$melhor" -v base="$base" \
+        'BEGIN { printf "%-10s %6d ms  %.2fx\n", b, t, base / t }'
+done
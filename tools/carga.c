@@ -0,0 +1,467 @@
+/**
+ * @file carga.c
+ * @brief Load-test client for the server mode of the vaccine system
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Opens a number of connections to a running `proj --servidor` and keeps
+ * exactly one command in flight on each of them (closed loop). Every
+ * command is `a` on a batch created at startup with enough doses for the
+ * whole run, so each response is a single line. Reports the throughput
+ * and the median and tail latency of the responses.
+ *
+ * With a number of preloaded applications, that many are recorded
+ * before the run, and one more connection lists all of them with `u`,
+ * over and over, while the `a` latencies are measured. With a
+ * checkpoint path, that connection asks for a background checkpoint
+ * with `g` every <intervalo> responses instead (never if 0), so the
+ * latencies show what forking the preloaded state costs the server.
+ *
+ *   $ gcc -O3 -Wall -Wextra -Werror -o carga tools/carga.c
+ *   $ ./carga <endereco> [<conexoes> [<pedidos-por-conexao>
+ *             [<aplicacoes-listadas> [<salvaguarda> [<intervalo>]]]]]
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**< Batch created for the run; its doses never run out */
+#define CARGA_LOTE "CA26A"
+
+/**< Vaccine the batch belongs to */
+#define CARGA_VACINA "carga"
+
+/**< Maximum length of one command or response line */
+#define CARGA_LINHA 128
+
+/**< Applications sent before their responses are read, when preloading */
+#define CARGA_BLOCO 1000
+
+/**< Responses between two checkpoints, unless given */
+#define CARGA_INTERVALO 2000
+
+/**
+ * @brief State of one load connection
+ */
+typedef struct {
+    int fd;                     /**< Connected socket */
+    int enviados;               /**< Commands sent so far */
+    struct timespec inicio;     /**< When the command in flight was sent */
+    char resposta[CARGA_LINHA]; /**< Partial response received so far */
+    size_t resposta_len;        /**< Bytes in resposta */
+} Conexao;
+
+/**
+ * @brief Returns the nanoseconds elapsed between two instants
+ * @param a Earlier instant
+ * @param b Later instant
+ * @return b - a in nanoseconds
+ */
+static long long nanos_entre(struct timespec a, struct timespec b) {
+    return (b.tv_sec - a.tv_sec) * 1000000000LL + (b.tv_nsec - a.tv_nsec);
+}
+
+/**
+ * @brief Connects to the server, as a TCP port or a Unix socket path
+ * @param endereco Port number or Unix socket path
+ * @return Connected socket, or -1 on error
+ */
+static int ligar(const char* endereco) {
+    const char* p = endereco;
+    int fd;
+
+    while (isdigit((unsigned char)*p)) p++;
+
+    if (*endereco != '\0' && *p == '\0') {
+        struct sockaddr_in addr;
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)atoi(endereco));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_un addr;
+
+        if (strlen(endereco) >= sizeof(addr.sun_path)) return -1;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, endereco);
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/**
+ * @brief Sends one line and waits for its one-line response
+ * @param fd Connected blocking socket
+ * @param linha Command line including the newline
+ * @return 0 on success, -1 on error
+ */
+static int pedir(int fd, const char* linha) {
+    char c;
+
+    if (send(fd, linha, strlen(linha), MSG_NOSIGNAL) < 0) return -1;
+    do {
+        if (recv(fd, &c, 1, 0) != 1) return -1;
+    } while (c != '\n');
+    return 0;
+}
+
+/**
+ * @brief Records applications for the `u` listings to go through
+ *
+ * Sends them in blocks of CARGA_BLOCO and reads each block's responses
+ * before sending the next one.
+ *
+ * @param fd Connected blocking socket
+ * @param n Number of applications
+ * @return 0 on success, -1 on error
+ */
+static int precarregar(int fd, int n) {
+    char bloco[CARGA_BLOCO * CARGA_LINHA];
+    int feitas = 0;
+
+    while (feitas < n) {
+        int i, len = 0, linhas = feitas + CARGA_BLOCO < n ?
+                                 CARGA_BLOCO : n - feitas;
+
+        for (i = 0; i < linhas; i++) {
+            len += snprintf(bloco + len, CARGA_LINHA, "a P%d %s\n",
+                            feitas + i, CARGA_VACINA);
+        }
+        if (send(fd, bloco, len, MSG_NOSIGNAL) != len) return -1;
+
+        while (linhas > 0) {
+            ssize_t lidos = recv(fd, bloco, sizeof(bloco), 0);
+
+            if (lidos <= 0) return -1;
+            for (i = 0; i < lidos; i++) {
+                linhas -= bloco[i] == '\n';
+            }
+        }
+        feitas += CARGA_BLOCO;
+    }
+    return 0;
+}
+
+/**
+ * @brief Opens a connection that lists every application once
+ *
+ * The connection is shut down for writing right after `u`, so the
+ * server closes it once the listing is sent.
+ *
+ * @param endereco Port number or Unix socket path
+ * @param epoll_fd epoll instance to watch it in
+ * @param id Event id of the listing connection
+ * @return Connected socket, or -1 on error
+ */
+static int iniciar_listagem(const char* endereco, int epoll_fd, int id) {
+    struct epoll_event evento;
+    int fd = ligar(endereco);
+
+    if (fd < 0 || send(fd, "u\n", 2, MSG_NOSIGNAL) != 2 ||
+        shutdown(fd, SHUT_WR) < 0) {
+        return -1;
+    }
+    evento.events = EPOLLIN;
+    evento.data.u32 = id;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &evento);
+    return fd;
+}
+
+/**
+ * @brief Opens the connection checkpoints are asked for on
+ * @param endereco Port number or Unix socket path
+ * @param epoll_fd epoll instance to watch it in
+ * @param id Event id of the connection
+ * @return Connected socket, or -1 on error
+ */
+static int iniciar_salvaguardas(const char* endereco, int epoll_fd, int id) {
+    struct epoll_event evento;
+    int fd = ligar(endereco);
+
+    if (fd < 0) {
+        return -1;
+    }
+    evento.events = EPOLLIN;
+    evento.data.u32 = id;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &evento);
+    return fd;
+}
+
+/**
+ * @brief Sends the next `a` command of a connection
+ * @param conexao Load connection
+ * @param id Index of the connection
+ * @return 0 on success, -1 on error
+ */
+static int enviar_pedido(Conexao* conexao, int id) {
+    char linha[CARGA_LINHA];
+    int len = snprintf(linha, sizeof(linha), "a U%d_%d %s\n",
+                       id, conexao->enviados, CARGA_VACINA);
+
+    clock_gettime(CLOCK_MONOTONIC, &conexao->inicio);
+    if (send(conexao->fd, linha, len, MSG_NOSIGNAL) != len) return -1;
+    conexao->enviados++;
+    return 0;
+}
+
+/**
+ * @brief Restores the max-heap property below one position
+ * @param v Array of latencies
+ * @param n Number of elements in the heap
+ * @param i Position to sift down
+ */
+static void afundar(long long* v, long n, long i) {
+    while (2 * i + 1 < n) {
+        long filho = 2 * i + 1;
+        long long tmp;
+
+        if (filho + 1 < n && v[filho + 1] > v[filho]) filho++;
+        if (v[i] >= v[filho]) return;
+        tmp = v[i];
+        v[i] = v[filho];
+        v[filho] = tmp;
+        i = filho;
+    }
+}
+
+/**
+ * @brief Sorts latencies in ascending order with heapsort
+ * @param v Array of latencies
+ * @param n Number of elements
+ */
+static void ordenar_latencias(long long* v, long n) {
+    long i;
+
+    for (i = n / 2 - 1; i >= 0; i--) {
+        afundar(v, n, i);
+    }
+    for (i = n - 1; i > 0; i--) {
+        long long tmp = v[0];
+        v[0] = v[i];
+        v[i] = tmp;
+        afundar(v, i, 0);
+    }
+}
+
+/**
+ * @brief Returns a percentile of sorted latencies, in microseconds
+ * @param latencias Latencies in nanoseconds, sorted ascending
+ * @param n Number of latencies
+ * @param p Percentile between 0 and 1
+ * @return Latency at that percentile in microseconds
+ */
+static double percentil(const long long* latencias, long n, double p) {
+    long i = (long)(p * (n - 1) + 0.5);
+    return latencias[i] / 1000.0;
+}
+
+/**
+ * @brief Runs the load test and prints a one-line report
+ * @param argc Number of arguments
+ * @param argv Address, connections, requests per connection,
+ * applications to list, checkpoint path and responses between
+ * checkpoints
+ * @return 0 on success, 1 on error
+ */
+int main(int argc, char* argv[]) {
+    int num_conexoes = argc > 2 ? atoi(argv[2]) : 1;
+    int pedidos = argc > 3 ? atoi(argv[3]) : 10000;
+    int listadas = argc > 4 ? atoi(argv[4]) : 0;
+    const char* salvaguarda = argc > 5 ? argv[5] : NULL;
+    int intervalo = argc > 6 ? atoi(argv[6]) : CARGA_INTERVALO;
+    int listagem = -1, listagens = 0, salvaguardas = 0;
+    long total, recebidos = 0;
+    long long* latencias;
+    Conexao* conexoes;
+    struct epoll_event* eventos;
+    struct timespec inicio, fim;
+    char linha[CARGA_LINHA];
+    int epoll_fd, fd, i;
+
+    if (argc < 2 || num_conexoes <= 0 || pedidos <= 0 || listadas < 0 ||
+        intervalo < 0) {
+        fprintf(stderr, "usage: %s <endereco> [<conexoes> [<pedidos> "
+                "[<aplicacoes-listadas> [<salvaguarda> [<intervalo>]]]]]\n",
+                argv[0]);
+        return 1;
+    }
+
+    /* Batch with enough doses for every request of the run */
+    fd = ligar(argv[1]);
+    snprintf(linha, sizeof(linha), "c %s 31-12-9999 2000000000 %s\n",
+             CARGA_LOTE, CARGA_VACINA);
+    if (fd < 0 || pedir(fd, linha) < 0 || precarregar(fd, listadas) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    close(fd);
+
+    total = (long)num_conexoes * pedidos;
+    latencias = (long long*)malloc(total * sizeof(long long));
+    conexoes = (Conexao*)calloc(num_conexoes, sizeof(Conexao));
+    eventos = (struct epoll_event*)malloc(num_conexoes *
+                                          sizeof(struct epoll_event));
+    epoll_fd = epoll_create1(0);
+    if (!latencias || !conexoes || !eventos || epoll_fd < 0) {
+        fprintf(stderr, "No memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < num_conexoes; i++) {
+        struct epoll_event evento;
+
+        conexoes[i].fd = ligar(argv[1]);
+        if (conexoes[i].fd < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+        evento.events = EPOLLIN;
+        evento.data.u32 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conexoes[i].fd, &evento);
+    }
+
+    if (salvaguarda) {
+        listagem = iniciar_salvaguardas(argv[1], epoll_fd, num_conexoes);
+        if (listagem < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+    } else if (listadas > 0) {
+        listagem = iniciar_listagem(argv[1], epoll_fd, num_conexoes);
+        if (listagem < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    for (i = 0; i < num_conexoes; i++) {
+        if (enviar_pedido(&conexoes[i], i) < 0) {
+            perror("send");
+            return 1;
+        }
+    }
+
+    while (recebidos < total) {
+        int n = epoll_wait(epoll_fd, eventos, num_conexoes, -1);
+
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return 1;
+        }
+        for (i = 0; i < n; i++) {
+            int id = eventos[i].data.u32;
+            Conexao* conexao;
+            ssize_t lidos;
+            char* nl;
+
+            /* The listing is thrown away; a new one starts as it ends */
+            if (id == num_conexoes) {
+                char descarte[65536];
+
+                lidos = recv(listagem, descarte, sizeof(descarte), 0);
+                if (lidos < 0 || (lidos == 0 && salvaguarda)) {
+                    perror("recv");
+                    return 1;
+                }
+                if (lidos == 0) {
+                    close(listagem);
+                    listagens++;
+                    listagem = iniciar_listagem(argv[1], epoll_fd, id);
+                    if (listagem < 0) {
+                        perror(argv[1]);
+                        return 1;
+                    }
+                }
+                continue;
+            }
+
+            conexao = &conexoes[id];
+            lidos = recv(conexao->fd,
+                         conexao->resposta + conexao->resposta_len,
+                         CARGA_LINHA - conexao->resposta_len, 0);
+            if (lidos <= 0) {
+                fprintf(stderr, "connection %d closed by server\n", id);
+                return 1;
+            }
+            conexao->resposta_len += lidos;
+
+            /* One request in flight, so at most one full line arrives */
+            nl = memchr(conexao->resposta, '\n', conexao->resposta_len);
+            if (!nl) continue;
+
+            clock_gettime(CLOCK_MONOTONIC, &fim);
+            latencias[recebidos++] = nanos_entre(conexao->inicio, fim);
+            conexao->resposta_len = 0;
+
+            /* g prints nothing unless the last checkpoint is running */
+            if (salvaguarda && intervalo > 0 && recebidos % intervalo == 0) {
+                int len = snprintf(linha, sizeof(linha), "g %s\n",
+                                   salvaguarda);
+
+                if (send(listagem, linha, len, MSG_NOSIGNAL) != len) {
+                    perror("send");
+                    return 1;
+                }
+                salvaguardas++;
+            }
+
+            if (conexao->enviados < pedidos &&
+                enviar_pedido(conexao, id) < 0) {
+                perror("send");
+                return 1;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+
+    ordenar_latencias(latencias, total);
+    printf("%d connections, %ld requests: %.0f req/s, "
+           "p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+           num_conexoes, total, total * 1e9 / nanos_entre(inicio, fim),
+           percentil(latencias, total, 0.50),
+           percentil(latencias, total, 0.99),
+           percentil(latencias, total, 0.999),
+           percentil(latencias, total, 1.0));
+    if (salvaguarda) {
+        printf("%d checkpoints of %d applications asked for during "
+               "the run\n", salvaguardas, listadas);
+        close(listagem);
+    } else if (listadas > 0) {
+        printf("%d full u listings of at least %d applications "
+               "completed during the run\n", listagens, listadas);
+        close(listagem);
+    }
+
+    for (i = 0; i < num_conexoes; i++) {
+        close(conexoes[i].fd);
+    }
+    close(epoll_fd);
+    free(eventos);
+    free(conexoes);
+    free(latencias);
+    return 0;
+}
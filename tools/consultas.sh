@@ -0,0 +1,30 @@
+#!/bin/sh
+# Measures the latency of a on one connection, first alone and then
+# while another connection keeps listing every application with u.
+# Each run gets a fresh server.
+#
+#   tools/consultas.sh <proj> <carga> <pedidos> <aplicacoes-listadas>
+
+proj=$1
+carga=$2
+pedidos=$3
+listadas=$4
+socket=${TMPDIR:-/tmp}/consultas.$$.sock
+
+for aplicacoes in 0 "$listadas"; do
+    ./$proj --servidor "$socket" &
+    servidor=$!
+    while [ ! -S "$socket" ]; do
+        sleep 0.1
+    done
+
+    if [ "$aplicacoes" -eq 0 ]; then
+        echo "a alone:"
+    else
+        echo "a during full u listings:"
+    fi
+    ./$carga "$socket" 1 "$pedidos" "$aplicacoes" || exit 1
+
+    kill "$servidor"
+    wait "$servidor"
+done
@@ -0,0 +1,139 @@
+/**
+ * @file gerar.c
+ * @brief Generates representative command streams for training and timing
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * The stream starts by creating a set of batches and then mixes commands
+ * the way production traffic does: mostly `a` and `l`, some `u` and `d`,
+ * and a few `c`, `r` and `t`. The same seed always gives the same stream.
+ *
+ *   $ ./gerar <semente> <comandos> > carga.in
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+/**< Number of distinct vaccine names */
+#define GERAR_VACINAS 24
+
+/**< Number of batches created before the mixed commands */
+#define GERAR_LOTES_INICIAIS 300
+
+/**< Number of distinct user names */
+#define GERAR_UTENTES 20000
+
+/**< Percentage thresholds of each command in the mix, cumulative */
+#define PERC_A 60
+#define PERC_L 80
+#define PERC_U 88
+#define PERC_D 93
+#define PERC_C 96
+#define PERC_R 97
+
+/**
+ * @brief Returns the next pseudo-random number (xorshift64)
+ * @param estado Generator state, never zero
+ * @return Next number in the sequence
+ */
+static unsigned long long proximo(unsigned long long* estado) {
+    unsigned long long x = *estado;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *estado = x;
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, n)
+ * @param estado Generator state
+ * @param n Upper bound
+ * @return Number below n
+ */
+static int aleatorio(unsigned long long* estado, int n) {
+    return (int)(proximo(estado) % (unsigned long long)n);
+}
+
+/**
+ * @brief Prints a user name, quoted with an inner space for some users
+ * @param estado Generator state
+ */
+static void imprimir_utente(unsigned long long* estado) {
+    int id = aleatorio(estado, GERAR_UTENTES);
+
+    if (id % 5 == 0) {
+        printf("\"Utente %d Silva\"", id);
+    } else {
+        printf("utente%d", id);
+    }
+}
+
+/**
+ * @brief Prints a `c` command for a new batch
+ * @param estado Generator state
+ * @param numero Sequence number giving the batch a unique name
+ */
+static void imprimir_lote(unsigned long long* estado, int numero) {
+    printf("c %X %d-%d-%d %d vacina%d\n", 0xA000 + numero,
+           1 + aleatorio(estado, 28), 1 + aleatorio(estado, 12),
+           2025 + aleatorio(estado, 3), 100 + aleatorio(estado, 5000),
+           aleatorio(estado, GERAR_VACINAS));
+}
+
+/**
+ * @brief Prints the command stream
+ * @param argc Number of arguments
+ * @param argv Seed and number of mixed commands
+ * @return 0 on success, 1 on usage error
+ */
+int main(int argc, char* argv[]) {
+    unsigned long long estado;
+    int comandos, lotes = 0, dia = 1, i;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <semente> <comandos>\n", argv[0]);
+        return 1;
+    }
+    estado = strtoull(argv[1], NULL, 10) * 2654435761ULL + 1;
+    comandos = atoi(argv[2]);
+
+    for (; lotes < GERAR_LOTES_INICIAIS; lotes++) {
+        imprimir_lote(&estado, lotes);
+    }
+
+    for (i = 0; i < comandos; i++) {
+        int tipo = aleatorio(&estado, 100);
+
+        if (tipo < PERC_A) {
+            printf("a ");
+            imprimir_utente(&estado);
+            printf(" vacina%d\n", aleatorio(&estado, GERAR_VACINAS));
+        } else if (tipo < PERC_L) {
+            if (aleatorio(&estado, 2)) {
+                printf("l\n");
+            } else {
+                printf("l vacina%d vacina%d\n",
+                       aleatorio(&estado, GERAR_VACINAS),
+                       aleatorio(&estado, GERAR_VACINAS));
+            }
+        } else if (tipo < PERC_U) {
+            printf("u ");
+            imprimir_utente(&estado);
+            printf("\n");
+        } else if (tipo < PERC_D) {
+            printf("d ");
+            imprimir_utente(&estado);
+            printf(" %d-1-2025\n", dia);
+        } else if (tipo < PERC_C) {
+            imprimir_lote(&estado, lotes++);
+        } else if (tipo < PERC_R) {
+            printf("r %X\n", 0xA000 + aleatorio(&estado, lotes));
+        } else if (dia < 31) {
+            printf("t %d-1-2025\n", ++dia);
+        } else {
+            printf("t\n");
+        }
+    }
+
+    printf("q\n");
+    return 0;
+}
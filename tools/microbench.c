@@ -0,0 +1,755 @@
+/**
+ * @file microbench.c
+ * @brief Micro-benchmarks of the core kernels, each timed in isolation
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Every kernel runs on generated input of a few sizes. After some warmup
+ * repetitions, each repetition is timed separately and the minimum and
+ * median time per operation are reported. Setup and cleanup done between
+ * repetitions, such as restoring an array before sorting it again, are
+ * not timed.
+ *
+ *   $ make microbench
+ *   $ build/microbench [-w <warmup>] [-r <repeticoes>] [<kernel>...]
+ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sistema.h"
+
+/**< Warmup repetitions run before timing */
+#define MICRO_AQUECIMENTO 3
+
+/**< Timed repetitions of each kernel and size */
+#define MICRO_REPETICOES 15
+
+/**< Names hashed per repetition of the hash kernels */
+#define MICRO_NOMES_HASH 1024
+
+/**< Lines parsed per repetition of the argument parsers */
+#define MICRO_LINHAS 1024
+
+/**< Maximum number of sizes per kernel */
+#define MICRO_TAMANHOS 4
+
+/* Kernels defined in project.c, which has no header of its own */
+int eh_lote_valido(char* lote);
+int eh_nome_valido(char* nome);
+void mergeSort(LoteVacina** array_lote, int e, int d);
+LoteVacina* encontrar_lote_mais_antigo(IndiceLotes* indice,
+                                       char* nome_vacina);
+int comparar_aplicacoes_por_data(const void* a, const void* b);
+void ordenar_aplicacoes(User** array_users, int num_users);
+int obter_dados_aplicacao(char* linha, char** nome_usuario,
+                          char** nome_vacina);
+
+/**
+ * @brief Input and state of one kernel at one size
+ */
+typedef struct Caso {
+    int n;                      /**< Size the kernel runs at */
+    char** nomes;               /**< Generated strings */
+    int num_nomes;              /**< Number of generated strings */
+    LoteVacina** lotes;         /**< Generated batches, original order */
+    int num_lotes;              /**< Number of generated batches */
+    LoteVacina** trabalho;      /**< Batches sorted in place */
+    User** aplicacoes;          /**< Generated applications, newest first */
+    User** trabalho_users;      /**< Applications sorted in place */
+    User* criados;              /**< Records made by criar_user */
+    Arena* arena;               /**< Arena of the records */
+    IndiceLotes* indice_lotes;  /**< Batch index */
+    IndiceUtentes* utentes;     /**< User index */
+    const Vacina* vacina;       /**< Vaccine queried in the user index */
+    char* texto;                /**< Generated command lines */
+    FILE* entrada;              /**< Stream reading texto */
+    char* linha;                /**< Line read from entrada */
+    size_t capacidade_linha;    /**< Allocated size of linha */
+    unsigned long long estado;  /**< Random generator state */
+    unsigned long long soma;    /**< Results, so no call is optimized out */
+} Caso;
+
+/**
+ * @brief One benchmarked kernel
+ */
+typedef struct {
+    const char* nome;                   /**< Kernel name */
+    const char* unidade;                /**< Meaning of the size */
+    int tamanhos[MICRO_TAMANHOS];       /**< Sizes, ending with 0 */
+    void (*criar)(Caso*);               /**< Builds the input */
+    void (*preparar)(Caso*);            /**< Untimed, before each run */
+    long (*executar)(Caso*);            /**< Timed; returns operations */
+    void (*limpar)(Caso*);              /**< Untimed, after each run */
+} Kernel;
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds
+ * @return Nanoseconds since an arbitrary starting point
+ */
+static long long agora(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, n) (xorshift64)
+ * @param caso Case holding the generator state
+ * @param n Upper bound
+ * @return Number below n
+ */
+static int aleatorio(Caso* caso, int n) {
+    caso->estado ^= caso->estado << 13;
+    caso->estado ^= caso->estado >> 7;
+    caso->estado ^= caso->estado << 17;
+    return (int)(caso->estado % (unsigned long long)n);
+}
+
+/**
+ * @brief Allocates memory or exits like the program does
+ * @param tamanho Number of bytes
+ * @return Allocated memory
+ */
+static void* reservar(size_t tamanho) {
+    void* p = malloc(tamanho);
+
+    if (!p) {
+        printf("No memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * @brief Generates strings, each made with the given format
+ * @param caso Case receiving the strings
+ * @param total Number of strings
+ * @param formato printf format taking one int
+ */
+static void gerar_nomes(Caso* caso, int total, const char* formato) {
+    char buffer[64];
+    int i;
+
+    caso->nomes = (char**)reservar(total * sizeof(char*));
+    caso->num_nomes = total;
+    for (i = 0; i < total; i++) {
+        snprintf(buffer, sizeof(buffer), formato, aleatorio(caso, 1 << 30));
+        caso->nomes[i] = strdup(buffer);
+    }
+}
+
+/**
+ * @brief Generates n batches with random expiry dates in the index
+ * @param caso Case receiving the batches
+ * @param vacinas Number of distinct vaccine names to spread them over
+ */
+static void gerar_lotes(Caso* caso, int vacinas) {
+    char nome[MAX_NOME], lote[MAX_NOME_LOTE];
+    int i;
+
+    caso->lotes = (LoteVacina**)reservar(caso->n * sizeof(LoteVacina*));
+    caso->trabalho = (LoteVacina**)reservar(caso->n * sizeof(LoteVacina*));
+    caso->num_lotes = caso->n;
+    caso->indice_lotes = criar_indice_lotes();
+    gerar_nomes(caso, vacinas, "vacina%d");
+
+    for (i = 0; i < caso->n; i++) {
+        snprintf(nome, sizeof(nome), "%s", caso->nomes[i % vacinas]);
+        snprintf(lote, sizeof(lote), "%X", aleatorio(caso, 1 << 30));
+        caso->lotes[i] = criar_lote(nome, lote,
+                                    data_criar(1, 1, 2025) +
+                                    aleatorio(caso, 730), 100);
+        indexar_lote(caso->indice_lotes, caso->lotes[i]);
+    }
+}
+
+/**
+ * @brief Frees everything a case may have allocated
+ * @param caso Case to clean up
+ */
+static void destruir_caso(Caso* caso) {
+    int i;
+
+    for (i = 0; i < caso->num_nomes; i++) free(caso->nomes[i]);
+    for (i = 0; i < caso->num_lotes; i++) free(caso->lotes[i]);
+    free(caso->nomes);
+    free(caso->lotes);
+    if (caso->indice_lotes) free_indice_lotes(caso->indice_lotes);
+    if (caso->utentes) free_indice_utentes(caso->utentes);
+    if (caso->aplicacoes) free_users(caso->aplicacoes[0]);
+    free_users(caso->criados);
+    free_arena(caso->arena);
+    free(caso->trabalho);
+    free(caso->aplicacoes);
+    free(caso->trabalho_users);
+    if (caso->entrada) fclose(caso->entrada);
+    free(caso->texto);
+    free(caso->linha);
+}
+
+/**
+ * @brief Returns the arena of a case, created on first use
+ * @param caso Benchmark case
+ * @return Arena records are created in
+ */
+static Arena* arena_do_caso(Caso* caso) {
+    if (!caso->arena) {
+        caso->arena = criar_arena();
+    }
+    return caso->arena;
+}
+
+/**
+ * @brief Builds MICRO_NOMES_HASH random names of length n
+ * @param caso Case receiving the names
+ */
+static void criar_hash(Caso* caso) {
+    int i, j;
+
+    caso->nomes = (char**)reservar(MICRO_NOMES_HASH * sizeof(char*));
+    caso->num_nomes = MICRO_NOMES_HASH;
+    for (i = 0; i < MICRO_NOMES_HASH; i++) {
+        caso->nomes[i] = (char*)reservar(caso->n + 1);
+        for (j = 0; j < caso->n; j++) {
+            caso->nomes[i][j] = 'a' + aleatorio(caso, 26);
+        }
+        caso->nomes[i][caso->n] = '\0';
+    }
+}
+
+/**
+ * @brief Hashes every name
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_hash(Caso* caso) {
+    int i;
+
+    for (i = 0; i < MICRO_NOMES_HASH; i++) {
+        caso->soma += hash_texto(caso->nomes[i]);
+    }
+    return MICRO_NOMES_HASH;
+}
+
+/**
+ * @brief Hashes a key made of two strings, such as a user and a vaccine
+ *
+ * The first hash seeds the second, so ("ab", "c") and ("a", "bc")
+ * hash differently. Only the benchmark uses it, to time a two-part key
+ * against hash_texto.
+ *
+ * @param primeiro First part of the key
+ * @param segundo Second part of the key
+ * @return 64-bit hash value
+ */
+static unsigned long long hash_par(const char* primeiro,
+                                   const char* segundo) {
+    return hash_bytes(segundo, strlen(segundo), hash_texto(primeiro));
+}
+
+/**
+ * @brief Hashes every name together with a vaccine name
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_hash_par(Caso* caso) {
+    int i;
+
+    for (i = 0; i < MICRO_NOMES_HASH; i++) {
+        caso->soma += hash_par(caso->nomes[i], "tosse_convulsa");
+    }
+    return MICRO_NOMES_HASH;
+}
+
+/**
+ * @brief Builds a user index with n users, half vaccinated on day 1
+ * @param caso Benchmark case
+ */
+static void criar_vacinado(Caso* caso) {
+    int i;
+
+    gerar_nomes(caso, caso->n, "utente %d");
+    caso->indice_lotes = criar_indice_lotes();
+    caso->lotes = (LoteVacina**)reservar(sizeof(LoteVacina*));
+    caso->num_lotes = 1;
+    caso->lotes[0] = criar_lote("vacina", "A0", data_criar(1, 1, 2030), 1);
+    indexar_lote(caso->indice_lotes, caso->lotes[0]);
+    caso->vacina = procurar_vacina(caso->indice_lotes, "vacina");
+
+    caso->utentes = criar_indice_utentes();
+    for (i = 0; i < caso->n; i++) {
+        recorde_vacinacao_hoje(caso->utentes, caso->nomes[i], caso->vacina,
+                               aleatorio(caso, 2));
+    }
+}
+
+/**
+ * @brief Asks the index about every user
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_vacinado(Caso* caso) {
+    int i;
+
+    for (i = 0; i < caso->n; i++) {
+        caso->soma += eh_vacinado_hoje(caso->utentes, caso->nomes[i],
+                                       caso->vacina, 1);
+    }
+    return caso->n;
+}
+
+/**
+ * @brief Indexes n batches over n / 4 + 1 vaccines
+ * @param caso Benchmark case
+ */
+static void criar_mais_antigo(Caso* caso) {
+    gerar_lotes(caso, caso->n / 4 + 1);
+}
+
+/**
+ * @brief Finds the batch to use for every vaccine
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_mais_antigo(Caso* caso) {
+    int i, vacinas = caso->n / 4 + 1;
+
+    for (i = 0; i < vacinas; i++) {
+        caso->soma += (unsigned long long)(size_t)
+            encontrar_lote_mais_antigo(caso->indice_lotes, caso->nomes[i]);
+    }
+    return vacinas;
+}
+
+/**
+ * @brief Builds n batches with random expiry dates
+ * @param caso Benchmark case
+ */
+static void criar_merge(Caso* caso) {
+    gerar_lotes(caso, 8);
+}
+
+/**
+ * @brief Restores the batches to their unsorted order
+ * @param caso Benchmark case
+ */
+static void preparar_merge(Caso* caso) {
+    memcpy(caso->trabalho, caso->lotes, caso->n * sizeof(LoteVacina*));
+}
+
+/**
+ * @brief Sorts the batches with mergeSort and mergelotes
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_merge(Caso* caso) {
+    mergeSort(caso->trabalho, 0, caso->n - 1);
+    return caso->n;
+}
+
+/**
+ * @brief Builds n applications, newest first as in the list
+ * @param caso Benchmark case
+ */
+static void criar_aplicacoes(Caso* caso) {
+    User* lista = NULL;
+    Data dia = data_criar(1, 1, 2025);
+    int i;
+
+    caso->aplicacoes = (User**)reservar(caso->n * sizeof(User*));
+    caso->trabalho_users = (User**)reservar(caso->n * sizeof(User*));
+    for (i = 0; i < caso->n; i++) {
+        User* novo;
+
+        dia += aleatorio(caso, 8) == 0;
+        novo = criar_user(arena_do_caso(caso), "utente", "vacina", "A0",
+                          dia);
+        novo->next = lista;
+        lista = novo;
+    }
+    for (i = 0; i < caso->n; i++) {
+        caso->aplicacoes[i] = lista;
+        lista = lista->next;
+    }
+}
+
+/**
+ * @brief Restores the applications to list order
+ * @param caso Benchmark case
+ */
+static void preparar_aplicacoes(Caso* caso) {
+    memcpy(caso->trabalho_users, caso->aplicacoes, caso->n * sizeof(User*));
+}
+
+/**
+ * @brief Sorts the applications by date
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_ordenar(Caso* caso) {
+    ordenar_aplicacoes(caso->trabalho_users, caso->n);
+    return caso->n;
+}
+
+/**
+ * @brief Compares every pair of neighbouring applications
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_comparar(Caso* caso) {
+    int i;
+
+    for (i = 1; i < caso->n; i++) {
+        caso->soma += comparar_aplicacoes_por_data(&caso->aplicacoes[i - 1],
+                                                   &caso->aplicacoes[i]) > 0;
+    }
+    return caso->n - 1;
+}
+
+/**
+ * @brief Builds n batch ids
+ * @param caso Benchmark case
+ */
+static void criar_lotes_texto(Caso* caso) {
+    gerar_nomes(caso, caso->n, "%X");
+}
+
+/**
+ * @brief Validates every batch id
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_lote_valido(Caso* caso) {
+    int i;
+
+    for (i = 0; i < caso->n; i++) {
+        caso->soma += eh_lote_valido(caso->nomes[i]);
+    }
+    return caso->n;
+}
+
+/**
+ * @brief Builds n vaccine names
+ * @param caso Benchmark case
+ */
+static void criar_nomes_vacina(Caso* caso) {
+    gerar_nomes(caso, caso->n, "tosse_convulsa_%d");
+}
+
+/**
+ * @brief Validates every vaccine name
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_nome_valido(Caso* caso) {
+    int i;
+
+    for (i = 0; i < caso->n; i++) {
+        caso->soma += eh_nome_valido(caso->nomes[i]);
+    }
+    return caso->n;
+}
+
+/**
+ * @brief Builds n quoted user names
+ * @param caso Benchmark case
+ */
+static void criar_nomes_utente(Caso* caso) {
+    gerar_nomes(caso, caso->n, "\"Utente %d Silva\"");
+}
+
+/**
+ * @brief Creates one record per user name
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_criar_user(Caso* caso) {
+    int i;
+
+    for (i = 0; i < caso->n; i++) {
+        User* novo = criar_user(caso->arena, caso->nomes[i], "vacina", "A0",
+                                i);
+        novo->next = caso->criados;
+        caso->criados = novo;
+    }
+    return caso->n;
+}
+
+/**
+ * @brief Builds n applications of distinct users, newest first
+ * @param caso Benchmark case
+ */
+static void criar_lista_utentes(Caso* caso) {
+    User* lista = NULL;
+    int i;
+
+    criar_nomes_utente(caso);
+    caso->aplicacoes = (User**)reservar(caso->n * sizeof(User*));
+    for (i = 0; i < caso->n; i++) {
+        User* novo = criar_user(arena_do_caso(caso), caso->nomes[i],
+                                "vacina", "A0", i);
+
+        novo->next = lista;
+        lista = novo;
+    }
+    for (i = 0; i < caso->n; i++) {
+        caso->aplicacoes[i] = lista;
+        lista = lista->next;
+    }
+}
+
+/**
+ * @brief Looks for an absent user along the list, as d and u do
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_procurar_utente(Caso* caso) {
+    User* registo;
+
+    for (registo = caso->aplicacoes[0]; registo; registo = registo->next) {
+        caso->soma += strcmp(registo->nome, "\"Utente 0 Silva\"") == 0;
+    }
+    return caso->n;
+}
+
+/**
+ * @brief Builds MICRO_LINHAS arguments of a with quoted names of length n
+ * @param caso Benchmark case
+ */
+static void criar_linhas_aplicacao(Caso* caso) {
+    size_t tamanho = (size_t)MICRO_LINHAS * (caso->n + 16);
+    char* p;
+    int i, j;
+
+    caso->texto = (char*)reservar(tamanho);
+    p = caso->texto;
+    for (i = 0; i < MICRO_LINHAS; i++) {
+        *p++ = '"';
+        for (j = 0; j < caso->n; j++) {
+            *p++ = j % 8 == 7 ? ' ' : 'a' + aleatorio(caso, 26);
+        }
+        memcpy(p, "\" vacina\n", 9);
+        p += 9;
+    }
+    caso->entrada = fmemopen(caso->texto, p - caso->texto, "r");
+    if (!caso->entrada) {
+        printf("No memory\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Rewinds the arguments to their first line
+ * @param caso Benchmark case
+ */
+static void preparar_linhas_aplicacao(Caso* caso) {
+    rewind(caso->entrada);
+}
+
+/**
+ * @brief Reads and parses every line as a does
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_dados_aplicacao(Caso* caso) {
+    char *nome_usuario, *nome_vacina;
+    int i;
+
+    for (i = 0; i < MICRO_LINHAS; i++) {
+        getline(&caso->linha, &caso->capacidade_linha, caso->entrada);
+        caso->soma += obter_dados_aplicacao(caso->linha, &nome_usuario,
+                                            &nome_vacina);
+        caso->soma += (unsigned char)nome_usuario[caso->n - 1];
+    }
+    return MICRO_LINHAS;
+}
+
+/**
+ * @brief Builds n quoted user names and the arena records go to
+ * @param caso Benchmark case
+ */
+static void criar_nomes_arena(Caso* caso) {
+    criar_nomes_utente(caso);
+    arena_do_caso(caso);
+}
+
+/**
+ * @brief Frees the records created by the run
+ * @param caso Benchmark case
+ */
+static void limpar_criar_user(Caso* caso) {
+    free_users(caso->criados);
+    caso->criados = NULL;
+}
+
+/**
+ * @brief Fills a new arena with one record per user name
+ * @param caso Benchmark case
+ */
+static void preparar_libertar(Caso* caso) {
+    caso->arena = criar_arena();
+    executar_criar_user(caso);
+}
+
+/**
+ * @brief Frees the records as free_sistema does at q
+ * @param caso Benchmark case
+ * @return Number of operations
+ */
+static long executar_libertar(Caso* caso) {
+    if (ARENA_POR_OBJETO) {
+        free_users(caso->criados);
+    }
+    free_arena(caso->arena);
+    caso->criados = NULL;
+    caso->arena = NULL;
+    return caso->n;
+}
+
+/** Every kernel with the sizes it is measured at */
+static const Kernel kernels[] = {
+    {"hash_texto", "name length", {8, 32, 200, 0},
+     criar_hash, NULL, executar_hash, NULL},
+    {"hash_par", "name length", {8, 32, 200, 0},
+     criar_hash, NULL, executar_hash_par, NULL},
+    {"eh_vacinado_hoje", "users", {1000, 100000, 0},
+     criar_vacinado, NULL, executar_vacinado, NULL},
+    {"encontrar_lote_mais_antigo", "batches", {16, 1000, 0},
+     criar_mais_antigo, NULL, executar_mais_antigo, NULL},
+    {"mergeSort", "batches", {10, 100, 1000, 0},
+     criar_merge, preparar_merge, executar_merge, NULL},
+    {"ordenar_aplicacoes", "applications", {1000, 10000, 100000, 0},
+     criar_aplicacoes, preparar_aplicacoes, executar_ordenar, NULL},
+    {"comparar_aplicacoes_por_data", "applications", {100000, 0},
+     criar_aplicacoes, NULL, executar_comparar, NULL},
+    {"eh_lote_valido", "batch ids", {10000, 0},
+     criar_lotes_texto, NULL, executar_lote_valido, NULL},
+    {"eh_nome_valido", "names", {10000, 0},
+     criar_nomes_vacina, NULL, executar_nome_valido, NULL},
+    {"criar_user", "records", {1000, 100000, 0},
+     criar_nomes_arena, NULL, executar_criar_user, limpar_criar_user},
+    {"libertar_aplicacoes", "records", {1000, 100000, 1000000, 0},
+     criar_nomes_utente, preparar_libertar, executar_libertar, NULL},
+    {"procurar_utente", "records", {1000, 100000, 0},
+     criar_lista_utentes, NULL, executar_procurar_utente, NULL},
+    {"obter_dados_aplicacao", "name length", {16, 256, 4096, 0},
+     criar_linhas_aplicacao, preparar_linhas_aplicacao,
+     executar_dados_aplicacao, NULL},
+};
+
+/**
+ * @brief Sorts the measured times in ascending order
+ * @param tempos Times per operation
+ * @param n Number of times
+ */
+static void ordenar_tempos(double* tempos, int n) {
+    int i, j;
+
+    for (i = 1; i < n; i++) {
+        double chave = tempos[i];
+
+        for (j = i - 1; j >= 0 && tempos[j] > chave; j--) {
+            tempos[j + 1] = tempos[j];
+        }
+        tempos[j + 1] = chave;
+    }
+}
+
+/**
+ * @brief Times one kernel at one size and prints a report line
+ * @param kernel Kernel to measure
+ * @param n Size to run it at
+ * @param aquecimento Untimed warmup repetitions
+ * @param repeticoes Timed repetitions
+ * @return Sum of the kernel's results
+ */
+static unsigned long long medir(const Kernel* kernel, int n,
+                                int aquecimento, int repeticoes) {
+    double* tempos = (double*)reservar(repeticoes * sizeof(double));
+    Caso caso;
+    int i;
+
+    memset(&caso, 0, sizeof(caso));
+    caso.n = n;
+    caso.estado = 88172645463325252ULL;
+    kernel->criar(&caso);
+
+    for (i = -aquecimento; i < repeticoes; i++) {
+        long long inicio;
+        long operacoes;
+
+        if (kernel->preparar) kernel->preparar(&caso);
+        inicio = agora();
+        operacoes = kernel->executar(&caso);
+        if (i >= 0) tempos[i] = (double)(agora() - inicio) / operacoes;
+        if (kernel->limpar) kernel->limpar(&caso);
+    }
+
+    ordenar_tempos(tempos, repeticoes);
+    printf("%-30s %8d %-13s %10.2f %10.2f\n", kernel->nome, n,
+           kernel->unidade, tempos[0], tempos[repeticoes / 2]);
+
+    destruir_caso(&caso);
+    free(tempos);
+    return caso.soma;
+}
+
+/**
+ * @brief Checks if a kernel was selected on the command line
+ * @param nome Kernel name
+ * @param filtros Names given on the command line
+ * @param num_filtros Number of names given, 0 selects every kernel
+ * @return 1 if the kernel should run, 0 otherwise
+ */
+static int selecionado(const char* nome, char** filtros, int num_filtros) {
+    int i;
+
+    if (num_filtros == 0) return 1;
+    for (i = 0; i < num_filtros; i++) {
+        if (strcmp(nome, filtros[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the selected kernels at every size
+ * @param argc Number of arguments
+ * @param argv Options and names of the kernels to run
+ * @return 0
+ */
+int main(int argc, char* argv[]) {
+    int aquecimento = MICRO_AQUECIMENTO, repeticoes = MICRO_REPETICOES;
+    char* filtros[sizeof(kernels) / sizeof(kernels[0])];
+    int num_filtros = 0, i, j;
+    unsigned long long soma = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            aquecimento = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeticoes = atoi(argv[++i]);
+        } else if (num_filtros < (int)(sizeof(filtros) / sizeof(char*))) {
+            filtros[num_filtros++] = argv[i];
+        }
+    }
+    if (repeticoes < 1) repeticoes = 1;
+
+    printf("%-30s %8s %-13s %10s %10s\n", "kernel", "n", "",
+           "min ns/op", "median");
+    for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i++) {
+        if (!selecionado(kernels[i].nome, filtros, num_filtros)) continue;
+
+        for (j = 0; j < MICRO_TAMANHOS && kernels[i].tamanhos[j]; j++) {
+            soma += medir(&kernels[i], kernels[i].tamanhos[j],
+                          aquecimento, repeticoes);
+        }
+    }
+
+    /* Printed to stderr so the result of every call is used */
+    fprintf(stderr, "checksum %llx\n", soma);
+    return 0;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file replay.c
+ * @brief Replays a recorded command stream against the system handlers
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Runs the same stream N times, each time against a fresh system, through
+ * the executar_comando of project.c. Reports commands per second, the time
+ * spent setting up, running and tearing down the system, the time per
+ * command type, and an FNV-1a checksum of the output. Every run must
+ * produce the same checksum; with -r, it must also match the checksum of a
+ * reference output, such as one recorded from another build. With -t, the
+ * bucket occupancy of the hash tables is printed after the first run.
+ * With -T, every run records its spans and the last run's are written
+ * to a Chrome trace, so the time per run shows what tracing costs.
+ *
+ *   $ gcc -O3 -Wall -Wextra -Werror -Wno-unused-result -DPROJ_SEM_MAIN \
+ *         -I. -o replay tools/replay.c $(ls *.c)
+ *   $ ./replay [pt] [-n <vezes>] [-o <saida>] [-r <referencia>] [-t]
+ *              [-T <traco>] <registo>
+ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sistema.h"
+
+/**< FNV-1a 64-bit offset basis */
+#define FNV_BASE 14695981039346656037ULL
+
+/**< FNV-1a 64-bit prime */
+#define FNV_PRIMO 1099511628211ULL
+
+/**< Buffer size of the checksum output stream */
+#define REPLAY_BUFFER (1 << 16)
+
+/**
+ * @brief Running checksum of everything written to the output stream
+ */
+typedef struct {
+    unsigned long long hash;    /**< FNV-1a hash of the bytes so far */
+    unsigned long long bytes;   /**< Number of bytes so far */
+    FILE* copia;                /**< Optional file receiving the output */
+} Soma;
+
+/**
+ * @brief Time and count of one command type over a run
+ */
+typedef struct {
+    long long nanos;            /**< Total time spent in the command */
+    long contagem;              /**< Number of times it ran */
+} TempoComando;
+
+/**
+ * @brief Returns the current monotonic time in nanoseconds
+ * @return Nanoseconds since an arbitrary starting point
+ */
+static long long agora(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/**
+ * @brief Output stream write function that only updates the checksum
+ * @param cookie Checksum state
+ * @param buf Bytes written
+ * @param n Number of bytes
+ * @return Number of bytes consumed
+ */
+static ssize_t escrever_soma(void* cookie, const char* buf, size_t n) {
+    Soma* soma = (Soma*)cookie;
+    unsigned long long hash = soma->hash;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        hash = (hash ^ (unsigned char)buf[i]) * FNV_PRIMO;
+    }
+    soma->hash = hash;
+    soma->bytes += n;
+
+    if (soma->copia) fwrite(buf, 1, n, soma->copia);
+    return n;
+}
+
+/**
+ * @brief Reads a whole file into memory
+ * @param caminho Path of the file
+ * @param tamanho Output for the file size
+ * @return Newly allocated contents, or NULL on error
+ */
+static char* ler_ficheiro(const char* caminho, size_t* tamanho) {
+    FILE* f = fopen(caminho, "rb");
+    char* conteudo;
+    long n;
+
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    conteudo = (char*)malloc(n > 0 ? n : 1);
+    if (!conteudo || fread(conteudo, 1, n, f) != (size_t)n) {
+        free(conteudo);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    *tamanho = n;
+    return conteudo;
+}
+
+/**
+ * @brief Computes the checksum of a recorded output
+ * @param caminho Path of the output file
+ * @param soma Output for the checksum
+ * @return 0 on success, -1 if the file cannot be read
+ */
+static int somar_ficheiro(const char* caminho, Soma* soma) {
+    size_t tamanho;
+    char* conteudo = ler_ficheiro(caminho, &tamanho);
+
+    if (!conteudo) return -1;
+    soma->hash = FNV_BASE;
+    soma->bytes = 0;
+    soma->copia = NULL;
+    escrever_soma(soma, conteudo, tamanho);
+    free(conteudo);
+    return 0;
+}
+
+/**
+ * @brief Prints how the hash tables of a system are filled
+ * @param sistema System after running the stream
+ */
+static void imprimir_ocupacao(Sistema* sistema) {
+    OcupacaoHash ocupacao;
+
+    ocupacao_indice_utentes(sistema->indice_utentes, &ocupacao);
+    ocupacao_imprimir(stdout, "user index", &ocupacao);
+    ocupacao_indice_lotes(sistema->indice_lotes, &ocupacao);
+    ocupacao_imprimir(stdout, "vaccine index", &ocupacao);
+}
+
+/**
+ * @brief Runs the whole stream once against a fresh system
+ *
+ * Reads commands exactly as main does on standard input.
+ *
+ * @param registo Recorded stream
+ * @param tamanho Size of the stream
+ * @param idioma Language of the messages
+ * @param soma Checksum state, initialised by the caller
+ * @param tempos Per-command time, indexed by command character
+ * @param fases Output for setup, command and teardown time
+ * @param ocupacao 1 to print the occupancy of the hash tables
+ * @param caminho_traco File the spans are written to, or NULL
+ * @return Number of commands run
+ */
+static long executar_registo(char* registo, size_t tamanho,
+                             Idioma idioma, Soma* soma,
+                             TempoComando* tempos, long long* fases,
+                             int ocupacao, const char* caminho_traco) {
+    cookie_io_functions_t funcoes = {NULL, escrever_soma, NULL, NULL};
+    FILE* entrada = fmemopen(registo, tamanho, "r");
+    FILE* saida = fopencookie(soma, "w", funcoes);
+    Sistema* sistema;
+    long comandos = 0;
+    long long t0, t1, inicio_comandos;
+    char comando;
+
+    if (!entrada || !saida) {
+        printf("No memory\n");
+        exit(1);
+    }
+    setvbuf(saida, NULL, _IOFBF, REPLAY_BUFFER);
+
+    t0 = agora();
+    sistema = criar_sistema(idioma);
+    if (caminho_traco) {
+        sistema->traco = criar_traco(caminho_traco);
+    }
+    t1 = agora();
+    fases[0] += t1 - t0;
+    inicio_comandos = t1;
+
+    while (fscanf(entrada, " %c", &comando) != EOF) {
+        int continuar = executar_comando(sistema, comando, entrada, saida);
+        long long t2 = agora();
+
+        tempos[(unsigned char)comando].nanos += t2 - t1;
+        tempos[(unsigned char)comando].contagem++;
+        comandos++;
+        t1 = t2;
+        if (!continuar) break;
+    }
+    fflush(saida);
+    fases[1] += agora() - inicio_comandos;
+
+    if (ocupacao) {
+        imprimir_ocupacao(sistema);
+    }
+
+    t0 = agora();
+    free_sistema(sistema);
+    fases[2] += agora() - t0;
+
+    fclose(saida);
+    fclose(entrada);
+    return comandos;
+}
+
+/**
+ * @brief Replays a recorded stream and prints the report
+ * @param argc Number of arguments
+ * @param argv Options and path of the recorded stream
+ * @return 0 if every checksum matched, 1 otherwise
+ */
+int main(int argc, char* argv[]) {
+    const char* caminho_registo = NULL;
+    const char* caminho_saida = NULL;
+    const char* caminho_referencia = NULL;
+    const char* caminho_traco = NULL;
+    TempoComando tempos[256];
+    long long fases[3] = {0, 0, 0};
+    long long nanos_comandos = 0;
+    unsigned long long primeira = 0;
+    Idioma idioma = IDIOMA_INGLES;
+    int vezes = 1, iguais = 1, ocupacao = 0;
+    long comandos = 0;
+    size_t tamanho;
+    char* registo;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            vezes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            caminho_saida = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            caminho_referencia = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0) {
+            ocupacao = 1;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            caminho_traco = argv[++i];
+        } else if (!idioma_por_argumento(argv[i], &idioma)) {
+            caminho_registo = argv[i];
+        }
+    }
+
+    if (!caminho_registo || vezes <= 0) {
+        fprintf(stderr, "usage: %s [pt] [-n <vezes>] [-o <saida>] "
+                "[-r <referencia>] [-t] [-T <traco>] <registo>\n", argv[0]);
+        return 1;
+    }
+
+    registo = ler_ficheiro(caminho_registo, &tamanho);
+    if (!registo) {
+        perror(caminho_registo);
+        return 1;
+    }
+    memset(tempos, 0, sizeof(tempos));
+
+    for (i = 0; i < vezes; i++) {
+        Soma soma = {FNV_BASE, 0, NULL};
+        long long antes = fases[1];
+
+        /* Only the first run is copied, the rest must match it */
+        if (i == 0 && caminho_saida) {
+            soma.copia = fopen(caminho_saida, "wb");
+            if (!soma.copia) {
+                perror(caminho_saida);
+                return 1;
+            }
+        }
+
+        comandos = executar_registo(registo, tamanho, idioma, &soma,
+                                    tempos, fases, ocupacao && i == 0,
+                                    caminho_traco);
+        nanos_comandos = fases[1] - antes;
+        if (soma.copia) fclose(soma.copia);
+
+        printf("run %d: %ld commands in %.3f ms, %.0f commands/s, "
+               "output %llu bytes, checksum %016llx\n",
+               i + 1, comandos, nanos_comandos / 1e6,
+               nanos_comandos > 0 ? comandos * 1e9 / nanos_comandos : 0.0,
+               soma.bytes, soma.hash);
+
+        if (i == 0) {
+            primeira = soma.hash;
+        } else if (soma.hash != primeira) {
+            iguais = 0;
+        }
+    }
+
+    printf("phases (mean per run): setup %.3f ms, commands %.3f ms, "
+           "teardown %.3f ms\n", fases[0] / 1e6 / vezes,
+           fases[1] / 1e6 / vezes, fases[2] / 1e6 / vezes);
+    for (i = 0; i < 256; i++) {
+        if (tempos[i].contagem > 0) {
+            printf("  %c: %ld commands, %.3f ms per run, %.0f ns each\n",
+                   i, tempos[i].contagem / vezes,
+                   tempos[i].nanos / 1e6 / vezes,
+                   (double)tempos[i].nanos / tempos[i].contagem);
+        }
+    }
+
+    printf("runs: %s\n", iguais ? "identical" : "DIFFERENT");
+    if (caminho_referencia) {
+        Soma referencia;
+
+        if (somar_ficheiro(caminho_referencia, &referencia) < 0) {
+            perror(caminho_referencia);
+            iguais = 0;
+        } else {
+            printf("reference: checksum %016llx, %s\n", referencia.hash,
+                   referencia.hash == primeira ? "identical" : "DIFFERENT");
+            iguais = iguais && referencia.hash == primeira;
+        }
+    }
+
+    free(registo);
+    return iguais ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Measures the latency of a on one connection over a preloaded state,
+# first alone and then while another connection asks for a background
+# checkpoint with g every <intervalo> responses. Each run gets a fresh
+# server.
+#
+#   tools/salvaguarda.sh <proj> <carga> <pedidos> <aplicacoes> <intervalo>
+
+proj=$1
+carga=$2
+pedidos=$3
+aplicacoes=$4
+socket=${TMPDIR:-/tmp}/salvaguarda.$$.sock
+ficheiro=${TMPDIR:-/tmp}/salvaguarda.$$.snap
+
+for intervalo in 0 "$5"; do
+    ./$proj --servidor "$socket" &
+    servidor=$!
+    while [ ! -S "$socket" ]; do
+        sleep 0.1
+    done
+
+    if [ "$intervalo" -eq 0 ]; then
+        echo "a alone:"
+    else
+        echo "a with a checkpoint every $intervalo responses:"
+    fi
+    ./$carga "$socket" 1 "$pedidos" "$aplicacoes" "$ficheiro" \
+        "$intervalo" || exit 1
+
+    kill "$servidor"
+    wait "$servidor"
+done
+rm -f "$ficheiro"
@@ -0,0 +1,371 @@
+/**
+ * @file stress.c
+ * @brief Stress test of snapshot queries answered while the system changes
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * One writer runs a random mix of c, a, r, d and t against a system and
+ * takes l and u snapshots as it goes, which reader threads answer in
+ * parallel, as the server's reader does. Every full listing is checked
+ * against what the writer saw when it took the snapshot: u must list
+ * every application alive then, and l every batch. Built with
+ * ThreadSanitizer by make stress, so any record changed or freed under
+ * a reader is reported. With an age, applications older than it are
+ * sealed into segments as time advances, and d deletes sealed records
+ * while readers list them.
+ *
+ *   $ gcc -O1 -g -fsanitize=thread -pthread -DPROJ_SEM_MAIN -I. \
+ *         -o stress tools/stress.c $(ls *.c)
+ *   $ ./stress [<leitores> [<comandos> [<semente> [<idade-fria>]]]]
+ */
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sistema.h"
+
+/**< Number of distinct user names */
+#define STRESS_UTENTES 300
+
+/**< Number of distinct vaccine names */
+#define STRESS_VACINAS 6
+
+/**< Doses of each batch created */
+#define STRESS_DOSES 40
+
+/**< Snapshots waiting or being answered, per reader */
+#define STRESS_PENDENTES 4
+
+/**< Maximum length of one command line */
+#define STRESS_LINHA 128
+
+/**
+ * @brief A snapshot handed to the readers
+ */
+typedef struct Pedido {
+    Consulta* consulta;         /**< Snapshot to answer */
+    long esperadas;             /**< Lines of the response, or -1 */
+    long linhas;                /**< Lines the reader wrote */
+    struct Pedido* next;        /**< Next request in the same queue */
+} Pedido;
+
+/**
+ * @brief Queues between the writer and the readers
+ */
+typedef struct Fila {
+    pthread_mutex_t trinco;     /**< Guards the queues and terminar */
+    pthread_cond_t pedidos;     /**< Signalled as requests are queued */
+    pthread_cond_t respostas;   /**< Signalled as requests are answered */
+    Pedido* pendentes;          /**< Requests to answer, oldest first */
+    Pedido* ultimo;             /**< Last request in pendentes */
+    Pedido* respondidos;        /**< Answered requests, newest first */
+    int terminar;               /**< 1 once the readers should stop */
+} Fila;
+
+/**
+ * @brief Returns the next pseudo-random number (xorshift64)
+ * @param estado Generator state, never zero
+ * @return Next number in the sequence
+ */
+static unsigned long long proximo(unsigned long long* estado) {
+    unsigned long long x = *estado;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *estado = x;
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, n)
+ * @param estado Generator state
+ * @param n Upper bound
+ * @return Number below n
+ */
+static int aleatorio(unsigned long long* estado, int n) {
+    return (int)(proximo(estado) % (unsigned long long)n);
+}
+
+/**
+ * @brief Answers requests until told to stop
+ * @param argumento Queues shared with the writer
+ * @return NULL
+ */
+static void* correr_leitor(void* argumento) {
+    Fila* fila = (Fila*)argumento;
+
+    while (1) {
+        Pedido* pedido;
+        char* resposta = NULL;
+        size_t len = 0, i;
+        FILE* saida;
+
+        pthread_mutex_lock(&fila->trinco);
+        while (!fila->pendentes && !fila->terminar) {
+            pthread_cond_wait(&fila->pedidos, &fila->trinco);
+        }
+        pedido = fila->pendentes;
+        if (pedido) {
+            fila->pendentes = pedido->next;
+        }
+        pthread_mutex_unlock(&fila->trinco);
+
+        if (!pedido) {
+            return NULL;
+        }
+
+        saida = open_memstream(&resposta, &len);
+        if (!saida) {
+            printf("No memory\n");
+            exit(1);
+        }
+        responder_consulta(pedido->consulta, saida);
+        fclose(saida);
+
+        for (i = 0; i < len; i++) {
+            pedido->linhas += resposta[i] == '\n';
+        }
+        free(resposta);
+
+        pthread_mutex_lock(&fila->trinco);
+        pedido->next = fila->respondidos;
+        fila->respondidos = pedido;
+        pthread_cond_signal(&fila->respostas);
+        pthread_mutex_unlock(&fila->trinco);
+    }
+}
+
+/**
+ * @brief Counts the applications a full u would list now
+ * @param sistema Pointer to the system
+ * @return Number of applications not deleted
+ */
+static long contar_vivas(Sistema* sistema) {
+    User* registo;
+    CursorFrio frio;
+    long vivas = 0;
+
+    for (registo = sistema->lista_users; registo; registo = registo->next) {
+        vivas += eh_registo_visivel(registo, sistema->versao);
+    }
+
+    cursor_frio_abrir(&frio, sistema->frio, sistema->frio ?
+                      sistema->frio->num_segmentos : 0, INT_MIN, INT_MAX,
+                      sistema->versao);
+    while (cursor_frio_proximo(&frio)) {
+        vivas++;
+    }
+    cursor_frio_fechar(&frio);
+    return vivas;
+}
+
+/**
+ * @brief Releases answered snapshots and checks their responses
+ * @param sistema Pointer to the system
+ * @param fila Queues shared with the readers
+ * @param esperar 1 to wait for at least one answer
+ * @param erros Incremented for every response of the wrong size
+ * @return Number of snapshots released
+ */
+static int recolher_respostas(Sistema* sistema, Fila* fila, int esperar,
+                              long* erros) {
+    Pedido* pedido;
+    int recolhidos = 0;
+
+    pthread_mutex_lock(&fila->trinco);
+    while (esperar && !fila->respondidos) {
+        pthread_cond_wait(&fila->respostas, &fila->trinco);
+    }
+    pedido = fila->respondidos;
+    fila->respondidos = NULL;
+    pthread_mutex_unlock(&fila->trinco);
+
+    while (pedido) {
+        Pedido* seguinte = pedido->next;
+
+        if (pedido->esperadas >= 0 && pedido->linhas != pedido->esperadas) {
+            fprintf(stderr, "listing of %ld lines, expected %ld\n",
+                    pedido->linhas, pedido->esperadas);
+            (*erros)++;
+        }
+        terminar_consulta(sistema, pedido->consulta);
+        free(pedido);
+        recolhidos++;
+        pedido = seguinte;
+    }
+    return recolhidos;
+}
+
+/**
+ * @brief Writes a random command line that changes the system
+ * @param sistema Pointer to the system
+ * @param estado Generator state
+ * @param linha Output buffer of STRESS_LINHA bytes
+ * @param lotes Number of batch ids handed out so far, updated
+ */
+static void gerar_comando(Sistema* sistema, unsigned long long* estado,
+                          char* linha, int* lotes) {
+    char data[DATA_TEXTO_MAX];
+    int sorte = aleatorio(estado, 100);
+
+    if (sorte < 60 || *lotes == 0) {
+        if (sorte < 3 || *lotes == 0) {
+            data_formatar(sistema->data_sistema + 30 +
+                          aleatorio(estado, 400), data);
+            snprintf(linha, STRESS_LINHA, "c A%X %s %d V%d\n", (*lotes)++,
+                     data, STRESS_DOSES, aleatorio(estado, STRESS_VACINAS));
+        } else {
+            snprintf(linha, STRESS_LINHA, "a U%d V%d\n",
+                     aleatorio(estado, STRESS_UTENTES),
+                     aleatorio(estado, STRESS_VACINAS));
+        }
+    } else if (sorte < 66) {
+        snprintf(linha, STRESS_LINHA, "r A%X\n", aleatorio(estado, *lotes));
+    } else if (sorte < 94) {
+        if (sorte < 80) {
+            snprintf(linha, STRESS_LINHA, "d U%d\n",
+                     aleatorio(estado, STRESS_UTENTES));
+        } else {
+            data_formatar(sistema->data_sistema, data);
+            snprintf(linha, STRESS_LINHA, "d U%d %s\n",
+                     aleatorio(estado, STRESS_UTENTES), data);
+        }
+    } else {
+        data_formatar(sistema->data_sistema + 1, data);
+        snprintf(linha, STRESS_LINHA, "t %s\n", data);
+    }
+}
+
+/**
+ * @brief Runs the writer against the readers and reports the outcome
+ * @param argc Number of arguments
+ * @param argv Readers, commands, seed and age of sealed applications
+ * @return 0 if every listing matched and nothing leaked, 1 otherwise
+ */
+int main(int argc, char* argv[]) {
+    int num_leitores = argc > 1 ? atoi(argv[1]) : 4;
+    long comandos = argc > 2 ? atol(argv[2]) : 20000;
+    unsigned long long estado = argc > 3 ? strtoull(argv[3], NULL, 10) : 1;
+    int idade_fria = argc > 4 ? atoi(argv[4]) : -1;
+    Sistema* sistema = criar_sistema(IDIOMA_INGLES);
+    FILE* nada = fopen("/dev/null", "w");
+    pthread_t* leitores;
+    Fila fila;
+    long k, erros = 0, consultas = 0;
+    int i, lotes = 0, em_curso = 0;
+
+    if (num_leitores <= 0 || comandos <= 0 || estado == 0) {
+        fprintf(stderr, "usage: %s [<leitores> [<comandos> [<semente> "
+                "[<idade-fria>]]]]\n", argv[0]);
+        return 1;
+    }
+
+    leitores = (pthread_t*)malloc(num_leitores * sizeof(pthread_t));
+    if (!leitores || !nada) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    if (idade_fria >= 0) {
+        sistema->frio = criar_arquivo_frio("/tmp", idade_fria);
+    }
+
+    memset(&fila, 0, sizeof(fila));
+    pthread_mutex_init(&fila.trinco, NULL);
+    pthread_cond_init(&fila.pedidos, NULL);
+    pthread_cond_init(&fila.respostas, NULL);
+    for (i = 0; i < num_leitores; i++) {
+        pthread_create(&leitores[i], NULL, correr_leitor, &fila);
+    }
+
+    for (k = 0; k < comandos; k++) {
+        char linha[STRESS_LINHA];
+        int sorte = aleatorio(&estado, 100);
+        FILE* entrada;
+
+        if (sorte < 40) {
+            /* A query: full u, full l, or u of one user */
+            Pedido* pedido = (Pedido*)calloc(1, sizeof(Pedido));
+            char comando = sorte < 28 ? 'u' : 'l';
+
+            if (!pedido) {
+                printf("No memory\n");
+                exit(1);
+            }
+            if (sorte < 4) {
+                snprintf(linha, sizeof(linha), " U%d\n",
+                         aleatorio(&estado, STRESS_UTENTES));
+                pedido->esperadas = -1;
+            } else {
+                strcpy(linha, "\n");
+                pedido->esperadas = comando == 'u' ? contar_vivas(sistema) :
+                                    sistema->indice_lotes->num_lotes;
+            }
+
+            entrada = fmemopen(linha, strlen(linha), "r");
+            pedido->consulta = preparar_consulta(sistema, comando, entrada,
+                                                 nada);
+            fclose(entrada);
+            if (!pedido->consulta) {
+                printf("No memory\n");
+                exit(1);
+            }
+
+            pthread_mutex_lock(&fila.trinco);
+            if (fila.pendentes) {
+                fila.ultimo->next = pedido;
+            } else {
+                fila.pendentes = pedido;
+            }
+            fila.ultimo = pedido;
+            pthread_cond_signal(&fila.pedidos);
+            pthread_mutex_unlock(&fila.trinco);
+            em_curso++;
+            consultas++;
+        } else {
+            gerar_comando(sistema, &estado, linha, &lotes);
+            entrada = fmemopen(linha + 1, strlen(linha) - 1, "r");
+            executar_comando(sistema, linha[0], entrada, nada);
+            fclose(entrada);
+        }
+
+        em_curso -= recolher_respostas(sistema, &fila,
+                                       em_curso >= num_leitores *
+                                                   STRESS_PENDENTES,
+                                       &erros);
+    }
+
+    pthread_mutex_lock(&fila.trinco);
+    fila.terminar = 1;
+    pthread_cond_broadcast(&fila.pedidos);
+    pthread_mutex_unlock(&fila.trinco);
+    for (i = 0; i < num_leitores; i++) {
+        pthread_join(leitores[i], NULL);
+    }
+    while (em_curso > 0) {
+        em_curso -= recolher_respostas(sistema, &fila, 1, &erros);
+    }
+
+    if (sistema->apagados_pendentes != 0 || sistema->epocas->num_retirados) {
+        fprintf(stderr, "%d deleted and %d retired records left over\n",
+                sistema->apagados_pendentes, sistema->epocas->num_retirados);
+        erros++;
+    }
+
+    printf("%ld commands, %ld snapshots answered by %d readers, "
+           "%ld mismatches\n", comandos, consultas, num_leitores, erros);
+    if (sistema->frio) {
+        printf("%d segments sealed\n", sistema->frio->num_segmentos);
+    }
+
+    free_sistema(sistema);
+    pthread_cond_destroy(&fila.respostas);
+    pthread_cond_destroy(&fila.pedidos);
+    pthread_mutex_destroy(&fila.trinco);
+    fclose(nada);
+    free(leitores);
+    return erros > 0;
+}
@@ -0,0 +1,329 @@
+/**
+ * @file traco.c
+ * @brief Spans of the commands, written as Chrome trace events
+ * @author ist1113656 (Taha Adar Ozsoy)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "traco.h"
+#include "sistema.h"
+
+/**
+ * @brief Category of each FaseTraco in the trace
+ */
+static const char* const nomes_fases[TRACO_FASES] = {
+    "command", "parse", "lookup", "sort", "output"
+};
+
+/**
+ * @brief Creates an empty trace, its ring already allocated
+ * @param caminho File the trace will be written to
+ * @return Pointer to the newly created trace
+ */
+Traco* criar_traco(const char* caminho) {
+    Traco* traco = (Traco*)malloc(sizeof(Traco));
+
+    if (!traco) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    traco->eventos = (EventoTraco*)malloc(TRACO_EVENTOS *
+                                          sizeof(EventoTraco));
+    traco->caminho = strdup(caminho);
+    if (!traco->eventos || !traco->caminho) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    /* Touched now, so no span pays for mapping a page of the ring */
+    memset(traco->eventos, 0, TRACO_EVENTOS * sizeof(EventoTraco));
+    traco->escritos = 0;
+    traco->comando = 0;
+    traco->threads[0] = (unsigned long)pthread_self();
+    traco->num_threads = 1;
+    traco->ciclos_inicio = sistema_ciclos();
+    traco->relogio_inicio = sistema_relogio();
+
+    return traco;
+}
+
+/**
+ * @brief Frees the trace, without writing it
+ * @param traco Pointer to the trace, or NULL
+ */
+void free_traco(Traco* traco) {
+    if (!traco) return;
+
+    free(traco->eventos);
+    free(traco->caminho);
+    free(traco);
+}
+
+/**
+ * @brief Returns the start of a span
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @return sistema_ciclos, or 0 when not tracing
+ */
+unsigned long long traco_inicio(const Traco* traco) {
+    return traco ? sistema_ciclos() : 0;
+}
+
+/**
+ * @brief Marks the start of a command
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param inicio sistema_ciclos when it started
+ */
+void traco_comecar(Traco* traco, unsigned long long inicio) {
+    if (traco) {
+        traco->comando = inicio;
+    }
+}
+
+/**
+ * @brief Returns when the current command started
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @return What traco_comecar was given, or 0 when not tracing
+ */
+unsigned long long traco_inicio_comando(const Traco* traco) {
+    return traco ? traco->comando : 0;
+}
+
+/**
+ * @brief Claims the slot of the next span
+ * @param traco Pointer to the trace
+ * @return The slot, overwriting the oldest span once the ring is full
+ */
+static EventoTraco* proximo_evento(Traco* traco) {
+    return &traco->eventos[traco->escritos++ & (TRACO_EVENTOS - 1)];
+}
+
+/**
+ * @brief Records a span of the thread that runs the commands
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param fase Category of the span
+ * @param nome Function it times, a string that outlives the trace
+ * @param inicio traco_inicio when it started
+ * @return When it ended, or 0 when not tracing
+ */
+unsigned long long traco_fim(Traco* traco, FaseTraco fase, const char* nome,
+                             unsigned long long inicio) {
+    EventoTraco* evento;
+
+    if (!traco) return 0;
+
+    evento = proximo_evento(traco);
+    evento->nome = nome;
+    evento->inicio = inicio;
+    evento->fim = sistema_ciclos();
+    evento->tid = 1;
+    evento->fase = fase;
+    evento->comando = '\0';
+    return evento->fim;
+}
+
+/**
+ * @brief Records the span of a whole command
+ *
+ * Its times are the ones contar_comando read, so tracing a command
+ * reads the counter no more than counting it does.
+ *
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param comando Command letter
+ * @param inicio sistema_ciclos when it started
+ * @param fim sistema_ciclos when it ended
+ */
+void traco_comando(Traco* traco, char comando, unsigned long long inicio,
+                   unsigned long long fim) {
+    EventoTraco* evento;
+
+    if (!traco) return;
+
+    evento = proximo_evento(traco);
+    evento->nome = NULL;
+    evento->inicio = inicio;
+    evento->fim = fim;
+    evento->tid = 1;
+    evento->fase = TRACO_COMANDO;
+    evento->comando = comando;
+}
+
+/**
+ * @brief Starts recording spans off the ring on the calling thread
+ * @param local Spans to record to
+ */
+void traco_local_iniciar(TracoLocal* local) {
+    local->num_eventos = 0;
+    local->thread = (unsigned long)pthread_self();
+}
+
+/**
+ * @brief Records a span off the ring, that ends now
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param local Spans started with traco_local_iniciar
+ * @param fase Category of the span
+ * @param nome Function it times, a string that outlives the trace
+ * @param inicio traco_inicio when it started
+ * @return When it ended, or 0 when not tracing
+ */
+unsigned long long traco_local_fim(const Traco* traco, TracoLocal* local,
+                                   FaseTraco fase, const char* nome,
+                                   unsigned long long inicio) {
+    unsigned long long fim;
+    EventoTraco* evento;
+
+    if (!traco) return 0;
+
+    fim = sistema_ciclos();
+    if (local->num_eventos == TRACO_LOCAL) {
+        return fim;
+    }
+    evento = &local->eventos[local->num_eventos++];
+    evento->nome = nome;
+    evento->inicio = inicio;
+    evento->fim = fim;
+    evento->fase = fase;
+    evento->comando = '\0';
+    return fim;
+}
+
+/**
+ * @brief Returns the tid of a thread, giving it the next one if new
+ * @param traco Pointer to the trace
+ * @param thread pthread_self of the thread
+ * @return Its tid, from 1
+ */
+static unsigned short tid_thread(Traco* traco, unsigned long thread) {
+    int i;
+
+    for (i = 0; i < traco->num_threads; i++) {
+        if (traco->threads[i] == thread) {
+            return i + 1;
+        }
+    }
+    if (traco->num_threads == TRACO_THREADS) {
+        return TRACO_THREADS;
+    }
+    traco->threads[traco->num_threads++] = thread;
+    return traco->num_threads;
+}
+
+/**
+ * @brief Moves spans recorded off the ring into it
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param local Spans to move, emptied
+ */
+void traco_juntar(Traco* traco, TracoLocal* local) {
+    unsigned short tid;
+    int i;
+
+    if (!traco || local->num_eventos == 0) return;
+
+    tid = tid_thread(traco, local->thread);
+    for (i = 0; i < local->num_eventos; i++) {
+        EventoTraco* evento = proximo_evento(traco);
+
+        *evento = local->eventos[i];
+        evento->tid = tid;
+    }
+    local->num_eventos = 0;
+}
+
+/**
+ * @brief Writes the name of a span as a JSON string
+ *
+ * Names are C identifiers and command letters; a letter that is a
+ * quote, a backslash or not printable ASCII is escaped.
+ *
+ * @param saida Stream to write to
+ * @param evento The span
+ */
+static void escrever_nome(FILE* saida, const EventoTraco* evento) {
+    unsigned char c = (unsigned char)evento->comando;
+
+    if (evento->nome) {
+        fprintf(saida, "\"%s\"", evento->nome);
+    } else if (c == '"' || c == '\\') {
+        fprintf(saida, "\"\\%c\"", c);
+    } else if (c < 0x20 || c >= 0x7f) {
+        fprintf(saida, "\"\\u%04x\"", c);
+    } else {
+        fprintf(saida, "\"%c\"", c);
+    }
+}
+
+/**
+ * @brief Writes the spans in the ring as Chrome trace events
+ *
+ * Ticks are converted to microseconds by the rate observed since the
+ * trace was created. tid 1 is named commands, the others reader N.
+ *
+ * @param traco Pointer to the trace
+ * @param saida Stream to write to
+ */
+void escrever_traco(const Traco* traco, FILE* saida) {
+    unsigned long long primeiro = 0, n;
+    unsigned long long ciclos = sistema_ciclos() - traco->ciclos_inicio;
+    double micros = ciclos ? (sistema_relogio() - traco->relogio_inicio) /
+                             1e3 / ciclos : 0;
+    int i;
+
+    if (traco->escritos > TRACO_EVENTOS) {
+        primeiro = traco->escritos - TRACO_EVENTOS;
+    }
+
+    fprintf(saida, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(saida, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":1,\"args\":{\"name\":\"commands\"}}");
+    for (i = 1; i < traco->num_threads; i++) {
+        fprintf(saida, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"reader %d\"}}", i + 1, i);
+    }
+
+    for (n = primeiro; n < traco->escritos; n++) {
+        const EventoTraco* evento = &traco->eventos[n & (TRACO_EVENTOS - 1)];
+
+        fprintf(saida, ",\n{\"name\":");
+        escrever_nome(saida, evento);
+        fprintf(saida, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,"
+                "\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                nomes_fases[evento->fase],
+                (evento->inicio - traco->ciclos_inicio) * micros,
+                (evento->fim - evento->inicio) * micros, evento->tid);
+    }
+    fprintf(saida, "\n]}\n");
+}
+
+/**
+ * @brief Writes the trace to its file
+ * @param traco Pointer to the trace
+ * @return 1 on success, 0 if the file could not be written
+ */
+int gravar_traco(const Traco* traco) {
+    FILE* ficheiro = fopen(traco->caminho, "w");
+    unsigned long long perdidos = 0;
+    int ok;
+
+    if (!ficheiro) {
+        fprintf(stderr, "%s: cannot write trace\n", traco->caminho);
+        return 0;
+    }
+
+    escrever_traco(traco, ficheiro);
+    ok = !ferror(ficheiro);
+    ok = (fclose(ficheiro) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "%s: cannot write trace\n", traco->caminho);
+        return 0;
+    }
+
+    if (traco->escritos > TRACO_EVENTOS) {
+        perdidos = traco->escritos - TRACO_EVENTOS;
+    }
+    fprintf(stderr, "%s: trace of %llu spans written, %llu overwritten\n",
+            traco->caminho, traco->escritos - perdidos, perdidos);
+    return 1;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file traco.h
+ * @brief Spans of the commands, written as Chrome trace events
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * Each command is a span, and the parsing, lookups, sorting and output
+ * inside it are spans nested in it. Spans go to a ring allocated once,
+ * so recording one takes a read of the time-stamp counter and a few
+ * stores; when the ring is full the oldest spans are overwritten. The
+ * ring is written as JSON when the system is freed, and opens in
+ * chrome://tracing or ui.perfetto.dev.
+ */
+#ifndef TRACO_H
+#define TRACO_H
+
+#include <stdio.h>
+
+/**< Spans the ring holds (a power of two) */
+#define TRACO_EVENTOS (1 << 18)
+
+/**< Spans a snapshot can record while it is answered */
+#define TRACO_LOCAL 8
+
+/**< Threads told apart in the trace; later ones share the last tid */
+#define TRACO_THREADS 64
+
+/**
+ * @brief What a span measures, its category in the trace
+ */
+typedef enum {
+    TRACO_COMANDO,      /**< A whole command */
+    TRACO_LEITURA,      /**< Parsing its arguments */
+    TRACO_PROCURA,      /**< Finding batches, vaccines or users */
+    TRACO_ORDENACAO,    /**< Sorting what it lists */
+    TRACO_ESCRITA,      /**< Writing a listing */
+    TRACO_FASES         /**< Number of categories */
+} FaseTraco;
+
+/**
+ * @brief One span, in ticks of sistema_ciclos
+ */
+typedef struct EventoTraco {
+    const char* nome;           /**< Function it times, or NULL for a
+                                     command */
+    unsigned long long inicio;  /**< When it started */
+    unsigned long long fim;     /**< When it ended */
+    unsigned short tid;         /**< Thread it ran on, 1 for commands */
+    unsigned char fase;         /**< FaseTraco */
+    char comando;               /**< Command letter of a TRACO_COMANDO */
+} EventoTraco;
+
+/**
+ * @brief Ring of the latest spans
+ *
+ * Only the thread that runs the commands writes to it. Spans recorded
+ * while a snapshot is answered, possibly on a reader thread, are kept
+ * in the snapshot and moved here when it is released.
+ */
+typedef struct Traco {
+    EventoTraco* eventos;           /**< TRACO_EVENTOS slots */
+    unsigned long long escritos;    /**< Spans ever recorded */
+    unsigned long long comando;     /**< When the current command started */
+    char* caminho;                  /**< File the trace is written to */
+    unsigned long long ciclos_inicio;   /**< sistema_ciclos at creation */
+    long long relogio_inicio;           /**< sistema_relogio at creation */
+
+    /**< pthread_self of the threads with tid 1 and up */
+    unsigned long threads[TRACO_THREADS];
+    int num_threads;                /**< Threads given a tid so far */
+} Traco;
+
+/**
+ * @brief Spans recorded off the ring, moved into it by traco_juntar
+ */
+typedef struct TracoLocal {
+    EventoTraco eventos[TRACO_LOCAL];   /**< Spans, in the order they ended */
+    int num_eventos;                    /**< Spans recorded */
+    unsigned long thread;               /**< pthread_self that recorded */
+} TracoLocal;
+
+/**
+ * @brief Creates an empty trace, its ring already allocated
+ *
+ * The thread that calls it, which runs the commands, is tid 1.
+ *
+ * @param caminho File the trace will be written to
+ * @return Pointer to the newly created trace
+ */
+Traco* criar_traco(const char* caminho);
+
+/**
+ * @brief Frees the trace, without writing it
+ * @param traco Pointer to the trace, or NULL
+ */
+void free_traco(Traco* traco);
+
+/**
+ * @brief Returns the start of a span
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @return sistema_ciclos, or 0 when not tracing
+ */
+unsigned long long traco_inicio(const Traco* traco);
+
+/**
+ * @brief Marks the start of a command
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param inicio sistema_ciclos when it started
+ */
+void traco_comecar(Traco* traco, unsigned long long inicio);
+
+/**
+ * @brief Returns when the current command started
+ *
+ * Spans that read its arguments start there, so they cost one read of
+ * the counter instead of two.
+ *
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @return What traco_comecar was given, or 0 when not tracing
+ */
+unsigned long long traco_inicio_comando(const Traco* traco);
+
+/**
+ * @brief Records a span of the thread that runs the commands
+ *
+ * It ends now; a span that starts right after it can start at the
+ * returned time, saving a read of the counter.
+ *
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param fase Category of the span
+ * @param nome Function it times, a string that outlives the trace
+ * @param inicio traco_inicio when it started
+ * @return When it ended, or 0 when not tracing
+ */
+unsigned long long traco_fim(Traco* traco, FaseTraco fase, const char* nome,
+                             unsigned long long inicio);
+
+/**
+ * @brief Records the span of a whole command
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param comando Command letter
+ * @param inicio sistema_ciclos when it started
+ * @param fim sistema_ciclos when it ended
+ */
+void traco_comando(Traco* traco, char comando, unsigned long long inicio,
+                   unsigned long long fim);
+
+/**
+ * @brief Starts recording spans off the ring on the calling thread
+ * @param local Spans to record to
+ */
+void traco_local_iniciar(TracoLocal* local);
+
+/**
+ * @brief Records a span off the ring, that ends now
+ *
+ * Spans past the first TRACO_LOCAL are dropped.
+ *
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param local Spans started with traco_local_iniciar
+ * @param fase Category of the span
+ * @param nome Function it times, a string that outlives the trace
+ * @param inicio traco_inicio when it started
+ * @return When it ended, or 0 when not tracing
+ */
+unsigned long long traco_local_fim(const Traco* traco, TracoLocal* local,
+                                   FaseTraco fase, const char* nome,
+                                   unsigned long long inicio);
+
+/**
+ * @brief Moves spans recorded off the ring into it
+ * @param traco Pointer to the trace, or NULL when not tracing
+ * @param local Spans to move, emptied
+ */
+void traco_juntar(Traco* traco, TracoLocal* local);
+
+/**
+ * @brief Writes the spans in the ring as Chrome trace events
+ *
+ * Every span is a complete ("X") event with its start and duration in
+ * microseconds since the trace was created.
+ *
+ * @param traco Pointer to the trace
+ * @param saida Stream to write to
+ */
+void escrever_traco(const Traco* traco, FILE* saida);
+
+/**
+ * @brief Writes the trace to its file
+ *
+ * Reports on stderr how many spans were written and how many the ring
+ * overwrote, or that the file could not be written.
+ *
+ * @param traco Pointer to the trace
+ * @return 1 on success, 0 if the file could not be written
+ */
+int gravar_traco(const Traco* traco);
+
+#endif
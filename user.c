@@ -7,49 +7,39 @@
 #include "user.h"
 #include "vacina.h"
 
-#define BUFFER_SIZE 65535
-
 #include <string.h>
 
 /**
  * @brief Creates a new user vaccination record
  * 
  * Allocates memory for a user record and copies the provided information.
+ * Names shorter than USER_NOME_CURTO are kept in the record, so only
+ * longer ones take a second allocation.
  * 
+ * @param arena Arena the record and its name are allocated from
  * @param nome User's name
- * @param vacina Name of the vaccine
+ * @param vacina Name of the vaccine, which must outlive the record
  * @param lote Batch identifier used
- * @param dia Day of application
- * @param mes Month of application
- * @param ano Year of application
+ * @param data Date of application
  * @return Pointer to the newly created user record
  */
-User* criar_user(char* nome, char* vacina, char* lote,
-                int dia, int mes, int ano) {
-    User* novo_user = (User*)malloc(sizeof(User));
-
-    if (!novo_user) {
-        printf("No memory\n");
-        exit(1);
-    }
+User* criar_user(Arena* arena, char* nome, const char* vacina, char* lote,
+                 Data data) {
+    User* novo_user = (User*)arena_reservar(arena, sizeof(User));
 
     size_t nome_len = strlen(nome);
-    novo_user->nome = (char*)malloc(strlen(nome) + 1);
-    if (!novo_user->nome) {
-        free(novo_user);
-        printf("No memory\n");
-        exit(1);
-    }
+    novo_user->nome = nome_len < USER_NOME_CURTO ? novo_user->nome_curto :
+                      (char*)arena_reservar(arena, nome_len + 1);
     
     memcpy(novo_user->nome, nome, nome_len + 1);
-    memcpy(novo_user->nome_vacina, vacina, strlen(vacina) + 1);
+    novo_user->nome_vacina = vacina;
     memcpy(novo_user->lote_usado, lote, strlen(lote) + 1);
 
-    novo_user->dia_de_applicacao = dia;
-    novo_user->mes_de_aplicacao = mes;
-    novo_user->ano_de_aplicacao = ano;
-    novo_user->data_aplicacao_int = ddmmyy_int(dia, mes, ano);
+    novo_user->data_aplicacao = data;
     novo_user->next = NULL;
+    novo_user->anterior_dia = NULL;
+    novo_user->proximo_dia = NULL;
+    novo_user->apagado_em = 0;
 
     return novo_user;
 }
@@ -57,21 +47,34 @@ User* criar_user(char* nome, char* vacina, char* lote,
 /**
  * @brief Records a vaccine application for a user
  * 
- * Creates a new user record and adds it to the beginning of the linked list.
+ * Creates a new user record, adds it to the beginning of the linked list
+ * and counts it in the filter of users with applications.
  * 
  * @param head Pointer to the head pointer of the user list
+ * @param filtro Filter of users with applications
  * @param nome User's name
- * @param vacina Name of the vaccine
+ * @param vacina Name of the vaccine, which must outlive the record
  * @param lote Batch identifier used
- * @param dia Day of application
- * @param mes Month of application
- * @param ano Year of application
+ * @param data Date of application
+ * @return Pointer to the new record
  */
-void aplicar_vacina(User** head, char* nome, char* vacina,
-                   char* lote, int dia, int mes, int ano) {
-    User* novo_user = criar_user(nome, vacina, lote, dia, mes, ano);
+User* aplicar_vacina(User** head, Arena* arena, FiltroBloom* filtro,
+                     char* nome, const char* vacina, char* lote, Data data) {
+    User* novo_user = criar_user(arena, nome, vacina, lote, data);
     novo_user->next = *head;  
     *head = novo_user;
+    bloom_adicionar(filtro, nome);
+    return novo_user;
+}
+
+/**
+ * @brief Frees the name of a record, unless it is kept in the record
+ * @param registo Record whose name is freed
+ */
+static void libertar_nome(User* registo) {
+    if (registo->nome != registo->nome_curto) {
+        arena_libertar(registo->nome, strlen(registo->nome) + 1);
+    }
 }
 
 /**
@@ -86,188 +89,383 @@ void free_users(User* head) {
     while (current) {
         User* temp = current;
         current = current->next;
-        free(temp->nome);
-        free(temp);
+        libertar_user(temp);
     }
 }
 
 /**
- * @brief Creates a new hash table for tracking today's vaccinations
+ * @brief Marks a record as deleted without unlinking it
+ * 
+ * Readers of an older version keep walking through the record, so its
+ * next pointer stays as it is until the record is collected.
+ * 
+ * @param registo Record still in the list
+ * @param versao Version of the deletion, above 0
+ */
+void marcar_apagado(User* registo, unsigned long versao) {
+    __atomic_store_n(&registo->apagado_em, versao, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Checks if a record is part of a given version of the list
+ * 
+ * @param registo Record in the list
+ * @param versao Version seen
+ * @return 1 unless the record was deleted at or before versao
+ */
+int eh_registo_visivel(User* registo, unsigned long versao) {
+    unsigned long apagado = __atomic_load_n(&registo->apagado_em,
+                                            __ATOMIC_RELAXED);
+
+    return apagado == 0 || apagado > versao;
+}
+
+/**
+ * @brief Returns the record after another, as a reader walking the list
+ * 
+ * @param registo Record in the list
+ * @return Next record, or NULL at the end
+ */
+User* proximo_registo(User* registo) {
+    return __atomic_load_n(&registo->next, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Frees one record and its name to their arena
+ * 
+ * Records are found in no other structure, so the arena is found from
+ * the record itself and this can be handed to epoca_retirar.
+ * 
+ * @param registo Record no longer in the list
+ */
+void libertar_user(void* registo) {
+    libertar_nome((User*)registo);
+    arena_libertar(registo, sizeof(User));
+}
+
+/**
+ * @brief Unlinks the records deleted up to a version, to be freed later
  * 
- * Initializes the hash table with empty buckets and the current date.
+ * A reader may be standing on an unlinked record, so its next pointer
+ * is left alone and the record is only retired. Records deleted after
+ * ate stay linked for the readers that still see them.
  * 
- * @param day Current day
- * @param month Current month
- * @param year Current year
- * @return Pointer to the newly created hash table
+ * @param head Pointer to the head pointer of the user list
+ * @param ate Latest deletion version no reader can see anymore
+ * @param epocas Epochs the records are retired to
+ * @return Number of records unlinked
  */
-HojeVaxTable* criar_vax_table_hoje(int day, int month, int year) {
-    int i;
-    HojeVaxTable* table = (HojeVaxTable*)malloc(sizeof(HojeVaxTable));
+int recolher_apagados(User** head, unsigned long ate, Epocas* epocas) {
+    User** ligacao = head;
+    int recolhidos = 0;
+
+    while (*ligacao) {
+        User* registo = *ligacao;
+
+        if (registo->apagado_em != 0 && registo->apagado_em <= ate) {
+            __atomic_store_n(ligacao, registo->next, __ATOMIC_RELEASE);
+            epoca_retirar(epocas, registo, libertar_user);
+            recolhidos++;
+        } else {
+            ligacao = &registo->next;
+        }
+    }
+
+    return recolhidos;
+}
+
+/**
+ * @brief Allocates an array of empty hash buckets
+ * @param capacidade Number of buckets
+ * @return Pointer to the bucket array
+ */
+static Utente** criar_buckets(unsigned int capacidade) {
+    Utente** table = (Utente**)calloc(capacidade, sizeof(Utente*));
+
     if (!table) {
         printf("No memory\n");
         exit(1);
     }
-    
-    for (i = 0; i < HASH_SIZE; i++) {
-        table->table[i] = NULL;
+
+    return table;
+}
+
+/**
+ * @brief Creates an empty user index
+ * 
+ * @return Pointer to the newly created index
+ */
+IndiceUtentes* criar_indice_utentes(void) {
+    IndiceUtentes* indice = (IndiceUtentes*)malloc(sizeof(IndiceUtentes));
+    if (!indice) {
+        printf("No memory\n");
+        exit(1);
     }
     
-    table->current_day = day;
-    table->current_month = month;
-    table->current_year = year;
+    indice->arena = criar_arena();
+    indice->table = criar_buckets(HASH_SIZE);
+    indice->capacidade = HASH_SIZE;
+    indice->num_utentes = 0;
+    indice->utentes_vivos = 0;
+    indice->maior_cadeia = 0;
     
-    return table;
+    return indice;
 }
 
 /**
- * @brief Frees all memory allocated for the today's vaccination hash table
+ * @brief Frees all memory allocated for the user index
  * 
- * Releases memory for all records in each bucket and the table itself.
+ * Entries are never freed on their own, so they all go with the
+ * index's arena; only the leak-checking build releases every user
+ * entry with its vaccine list first.
  * 
- * @param table Pointer to the hash table
+ * @param indice Pointer to the index
  */
-void free_hoje_vax_table(HojeVaxTable* table) {
-    int i;
-    if (!table) return;
+void free_indice_utentes(IndiceUtentes* indice) {
+    unsigned int i;
+    if (!indice) return;
     
-    for (i = 0; i < HASH_SIZE; i++) {
-        VaxHoje* current = table->table[i];
+    for (i = 0; ARENA_POR_OBJETO && i < indice->capacidade; i++) {
+        Utente* current = indice->table[i];
         while (current) {
-            VaxHoje* temp = current;
+            Utente* temp = current;
             current = current->next;
-            free(temp->nome_user);
-            free(temp->nome_vacina);
-            free(temp);
+            while (temp->doses) {
+                UltimaDose* dose = temp->doses;
+                temp->doses = dose->next;
+                arena_libertar(dose, sizeof(UltimaDose));
+            }
+            arena_libertar(temp->nome, strlen(temp->nome) + 1);
+            arena_libertar(temp, sizeof(Utente));
         }
     }
     
-    free(table);
+    free_arena(indice->arena);
+    free(indice->table);
+    free(indice);
+}
+
+/**
+ * @brief Finds the index entry of a user
+ * @param indice Pointer to the user index
+ * @param nome_user User's name
+ * @return Pointer to the entry or NULL if the user was never vaccinated
+ */
+static Utente* procurar_utente(IndiceUtentes* indice, const char* nome_user) {
+    Utente* current =
+        indice->table[hash_texto(nome_user) & (indice->capacidade - 1)];
+
+    while (current) {
+        if (strcmp(current->nome, nome_user) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Doubles the number of buckets and redistributes the users
+ * 
+ * The users of bucket i can only go to buckets i and i + capacidade,
+ * so the length of every new chain is counted on the way.
+ * 
+ * @param indice Pointer to the user index
+ */
+static void expandir_indice(IndiceUtentes* indice) {
+    unsigned int i, nova_capacidade = indice->capacidade * 2;
+    Utente** nova_table = criar_buckets(nova_capacidade);
+
+    indice->maior_cadeia = 0;
+    for (i = 0; i < indice->capacidade; i++) {
+        Utente* current = indice->table[i];
+        unsigned int cadeias[2] = {0, 0};
+
+        while (current) {
+            Utente* temp = current;
+            unsigned int index =
+                hash_texto(temp->nome) & (nova_capacidade - 1);
+            current = current->next;
+            temp->next = nova_table[index];
+            nova_table[index] = temp;
+            cadeias[index != i]++;
+        }
+        if (cadeias[0] > indice->maior_cadeia) {
+            indice->maior_cadeia = cadeias[0];
+        }
+        if (cadeias[1] > indice->maior_cadeia) {
+            indice->maior_cadeia = cadeias[1];
+        }
+    }
+
+    free(indice->table);
+    indice->table = nova_table;
+    indice->capacidade = nova_capacidade;
 }
 
 /**
- * @brief Computes a hash value for the user-vaccine pair
+ * @brief Finds or creates the index entry of a user
  * 
- * Generates a hash index in the range [0, HASH_SIZE-1] using
- * a simple multiplication-based hash function.
+ * The table doubles once it holds more users than buckets,
+ * so chains stay short as the history grows. A miss walks the whole
+ * chain, so the length of the chain the user joins comes for free.
  * 
+ * @param indice Pointer to the user index
  * @param nome_user User's name
- * @param nome_vacina Name of the vaccine
- * @return Hash value
+ * @return Pointer to the entry
  */
-static unsigned int hash_function(const char* nome_user,
-                                 const char* nome_vacina) {
-    unsigned int hash = 0;
-    
-    while (*nome_user) {
-        hash = (hash * 31) + (*nome_user++);
+static Utente* obter_utente(IndiceUtentes* indice, const char* nome_user) {
+    unsigned long long hash = hash_texto(nome_user);
+    unsigned int index = hash & (indice->capacidade - 1);
+    unsigned int cadeia = 1;
+    size_t nome_len;
+    Utente* utente;
+
+    for (utente = indice->table[index]; utente; utente = utente->next) {
+        if (strcmp(utente->nome, nome_user) == 0) {
+            return utente;
+        }
+        cadeia++;
     }
-    
-    while (*nome_vacina) {
-        hash = (hash * 31) + (*nome_vacina++);
+
+    if (indice->num_utentes >= indice->capacidade) {
+        expandir_indice(indice);
+        index = hash & (indice->capacidade - 1);
+        cadeia = 1;
+        for (utente = indice->table[index]; utente; utente = utente->next) {
+            cadeia++;
+        }
     }
-    
-    return hash % HASH_SIZE;
+
+    nome_len = strlen(nome_user);
+    utente = (Utente*)arena_reservar(indice->arena, sizeof(Utente));
+    utente->nome = arena_copiar(indice->arena, nome_user, nome_len);
+    utente->doses = NULL;
+    utente->aplicacoes = 0;
+    utente->next = indice->table[index];
+    indice->table[index] = utente;
+    indice->num_utentes++;
+    if (cadeia > indice->maior_cadeia) {
+        indice->maior_cadeia = cadeia;
+    }
+
+    return utente;
+}
+
+/**
+ * @brief Finds the latest application of a vaccine to a user
+ * @param utente User's index entry
+ * @param vacina Index entry of the vaccine
+ * @return Pointer to the record or NULL if never applied
+ */
+static UltimaDose* procurar_dose(Utente* utente,
+                                 const struct Vacina* vacina) {
+    UltimaDose* current = utente->doses;
+
+    while (current && current->vacina != vacina) {
+        current = current->next;
+    }
+
+    return current;
 }
 
 /**
  * @brief Checks if a user has been vaccinated today with a specific vaccine
  * 
- * Searches the hash table for a record matching the user-vaccine pair.
+ * Looks up the user and compares the day of their latest dose of the
+ * vaccine with the current date.
  * 
- * @param table Pointer to the hash table
+ * @param indice Pointer to the user index
  * @param nome_user User's name
- * @param nome_vacina Name of the vaccine
+ * @param vacina Index entry of the vaccine (NULL if it has no batches)
+ * @param hoje Current date
  * @return 1 if the user was vaccinated today 
  * with the given vaccine, 0 otherwise
  */
-int eh_vacinado_hoje(HojeVaxTable* table, char* nome_user, char* nome_vacina) {
-    unsigned int index = hash_function(nome_user, nome_vacina);
-    
-    VaxHoje* current = table->table[index];
-    while (current) {
-        if (strcmp(current->nome_user, nome_user) == 0 && 
-            strcmp(current->nome_vacina, nome_vacina) == 0) {
-            return 1;
-        }
-        current = current->next;
+int eh_vacinado_hoje(IndiceUtentes* indice, char* nome_user,
+                     const struct Vacina* vacina, Data hoje) {
+    Utente* utente;
+    UltimaDose* dose;
+
+    if (!vacina || !(utente = procurar_utente(indice, nome_user))) {
+        return 0;
     }
-    
-    return 0; 
+
+    dose = procurar_dose(utente, vacina);
+    return dose && dose->ultimo_dia == hoje;
 }
 
 /**
  * @brief Records a vaccination performed today
  * 
- * Creates a new record in the hash table for the user-vaccine pair.
+ * Stores the current date as the user's latest dose of the vaccine,
+ * and counts the user as live again if d had deleted the rest.
  * 
- * @param table Pointer to the hash table
+ * @param indice Pointer to the user index
  * @param nome_user User's name
- * @param nome_vacina Name of the vaccine
+ * @param vacina Index entry of the vaccine
+ * @param hoje Current date
  */
-void recorde_vacinacao_hoje(HojeVaxTable* table, char* nome_user,
-                           char* nome_vacina) {
-    unsigned int index = hash_function(nome_user, nome_vacina);
-    char* name_copy;
-    char* vaccine_copy;
-    
-    VaxHoje* new_record = (VaxHoje*)malloc(sizeof(VaxHoje));
-    if (!new_record) {
-        printf("No memory\n");
-        exit(1);
+void recorde_vacinacao_hoje(IndiceUtentes* indice, char* nome_user,
+                            const struct Vacina* vacina, Data hoje) {
+    Utente* utente = obter_utente(indice, nome_user);
+    UltimaDose* dose = procurar_dose(utente, vacina);
+
+    if (!dose) {
+        dose = (UltimaDose*)arena_reservar(indice->arena, sizeof(UltimaDose));
+        dose->vacina = vacina;
+        dose->next = utente->doses;
+        utente->doses = dose;
     }
-    
-    name_copy = (char*)malloc(strlen(nome_user) + 1);
-    vaccine_copy = (char*)malloc(strlen(nome_vacina) + 1);
-    
-    if (!name_copy || !vaccine_copy) {
-        free(new_record);
-        if (name_copy) free(name_copy);
-        if (vaccine_copy) free(vaccine_copy);
-        printf("No memory\n");
-        exit(1);
+
+    dose->ultimo_dia = hoje;
+    if (utente->aplicacoes++ == 0) {
+        indice->utentes_vivos++;
     }
-    
-    strcpy(name_copy, nome_user);
-    strcpy(vaccine_copy, nome_vacina);
-    
-    new_record->nome_user = name_copy;
-    new_record->nome_vacina = vaccine_copy;
-    
-    new_record->next = table->table[index];
-    table->table[index] = new_record;
 }
 
 /**
- * @brief Resets the hash table if the current date has changed
+ * @brief Counts applications of a user that d deleted
  * 
- * Clears all records in the hash table and updates the current date.
+ * The user stops counting as live once none is left; the entry itself
+ * stays, with the latest doses, as eh_vacinado_hoje needs them.
  * 
- * @param table Pointer to the hash table
- * @param day New current day
- * @param month New current month
- * @param year New current year
+ * @param indice Pointer to the user index
+ * @param nome_user User's name
+ * @param n Number of applications deleted
  */
-void reset_table_hoje(HojeVaxTable* table, int day, int month, int year) {
-    int i;
-    if (table->current_day != day || 
-        table->current_month != month || 
-        table->current_year != year) {
-        
-        for (i = 0; i < HASH_SIZE; i++) {
-            VaxHoje* current = table->table[i];
-            while (current) {
-                VaxHoje* temp = current;
-                current = current->next;
-                free(temp->nome_user);
-                free(temp->nome_vacina);
-                free(temp);
-            }
-            table->table[i] = NULL;
+void descontar_aplicacoes(IndiceUtentes* indice, const char* nome_user,
+                          int n) {
+    Utente* utente;
+
+    if (n == 0 || !(utente = procurar_utente(indice, nome_user))) {
+        return;
+    }
+
+    utente->aplicacoes -= n;
+    if (utente->aplicacoes == 0) {
+        indice->utentes_vivos--;
+    }
+}
+
+/**
+ * @brief Measures how evenly users are spread over the buckets
+ * @param indice Pointer to the user index
+ * @param ocupacao Output for the occupancy report
+ */
+void ocupacao_indice_utentes(const IndiceUtentes* indice,
+                             OcupacaoHash* ocupacao) {
+    unsigned int i;
+
+    memset(ocupacao, 0, sizeof(*ocupacao));
+    for (i = 0; i < indice->capacidade; i++) {
+        unsigned long cadeia = 0;
+        const Utente* current;
+
+        for (current = indice->table[i]; current; current = current->next) {
+            cadeia++;
         }
-        
-        table->current_day = day;
-        table->current_month = month;
-        table->current_year = year;
+        ocupacao_contar(ocupacao, cadeia);
     }
-}
\ No newline at end of file
+}
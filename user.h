@@ -6,11 +6,8 @@
 #ifndef USER_H
 #define USER_H
 
-/**< Maximum buffer size for input processing */
-#define BUFFER_SIZE 65535 
-
-/**< Size of hash table for today's vaccinations */
-#define HASH_SIZE 1009 
+/**< Initial number of buckets of the user index (a power of two) */
+#define HASH_SIZE 1024
 
 /**< Maximum length of the name of the vacine 
 * that can be stored in the system as data */
@@ -20,53 +17,74 @@
 *  that can be stored in the system as data*/
 #define MAX_NOME_LOTE 21 
 
+/**< Bytes of a user's name stored in the record itself, with its null */
+#define USER_NOME_CURTO 24
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#include "data.h"
+#include "bloom.h"
+#include "hash.h"
+#include "epoca.h"
+#include "arena.h"
+
 /**
  * @brief Represents a vaccination record for a user
+ *
+ * Scans of the list read nome, next, apagado_em and the name itself,
+ * so they come first and share the record's first cache line when the
+ * name fits in nome_curto. The vaccine's name is not copied, which
+ * keeps the record within the allocator's small chunks.
  */
 typedef struct User {
-    char* nome;   /**< User's name (dynamically allocated) */
-    char nome_vacina[MAX_NOME];  /**< Name of the vaccine administered */
+    char* nome;   /**< User's name: nome_curto, or allocated if longer */
+    struct User* next;  /**< Pointer to next user in linked list */
+
+    /**< Version of the deletion, or 0 while the record is live */
+    unsigned long apagado_em;
+
+    char nome_curto[USER_NOME_CURTO];   /**< Name, if short enough */
+    Data data_aplicacao;                  /**< Date of application */
 
     /**< Batch identifier used for vaccination */
     char lote_usado[MAX_NOME_LOTE];
 
-    int dia_de_applicacao;                /**< Day of application */
-    int mes_de_aplicacao;                 /**< Month of application */
-    int ano_de_aplicacao;                 /**< Year of application */
-    int data_aplicacao_int; /**< Integer representation of application date */
-    struct User* next;  /**< Pointer to next user in linked list */
+    /**< Name of the vaccine administered, owned by its index entry */
+    const char* nome_vacina;
+
+    /**< Neighbours among the applications of the same day */
+    struct User* anterior_dia;
+    struct User* proximo_dia;
 } User;
 
 /**
  * @brief Creates a new user vaccination record
+ * @param arena Arena the record and its name are allocated from
  * @param nome User's name
- * @param vacina Name of the vaccine
+ * @param vacina Name of the vaccine, which must outlive the record
  * @param lote Batch identifier used
- * @param dia Day of application
- * @param mes Month of application
- * @param ano Year of application
+ * @param data Date of application
  * @return Pointer to the newly created user record
  */
-User* criar_user(char* nome, char* vacina, char* lote,
-                 int dia, int mes, int ano);
+User* criar_user(Arena* arena, char* nome, const char* vacina, char* lote,
+                 Data data);
 
 /**
  * @brief Records a vaccine application for a user
  * @param head Pointer to the head pointer of the user list
+ * @param arena Arena the record is allocated from
+ * @param filtro Filter of users with applications
  * @param nome User's name
- * @param vacina Name of the vaccine
+ * @param vacina Name of the vaccine, which must outlive the record
  * @param lote Batch identifier used
- * @param dia Day of application
- * @param mes Month of application
- * @param ano Year of application
+ * @param data Date of application
+ * @return Pointer to the new record
  */
-void aplicar_vacina(User** head, char* nome, char* vacina,
-                   char* lote, int dia, int mes, int ano);
+User* aplicar_vacina(User** head, Arena* arena, FiltroBloom* filtro,
+                     char* nome, const char* vacina, char* lote, Data data);
 
 /**
  * @brief Frees all memory allocated for user records
@@ -75,68 +93,133 @@ void aplicar_vacina(User** head, char* nome, char* vacina,
 void free_users(User* head);
 
 /**
- * @brief Represents a record of vaccination performed today
+ * @brief Marks a record as deleted without unlinking it
+ * @param registo Record still in the list
+ * @param versao Version of the deletion, above 0
  */
-typedef struct VaxHoje {
-    char* nome_user;          /**< User's name (dynamically allocated) */
+void marcar_apagado(User* registo, unsigned long versao);
 
-    /**< Name of the vaccine (dynamically allocated) */
-    char* nome_vacina;
+/**
+ * @brief Checks if a record is part of a given version of the list
+ *
+ * Safe to call on a thread other than the one that marks the record.
+ *
+ * @param registo Record in the list
+ * @param versao Version seen
+ * @return 1 unless the record was deleted at or before versao
+ */
+int eh_registo_visivel(User* registo, unsigned long versao);
 
-    struct VaxHoje* next;     /**< Pointer to next record in hash bucket */
-} VaxHoje;
+/**
+ * @brief Returns the record after another, as a reader walking the list
+ *
+ * Safe to call while the writer unlinks records.
+ *
+ * @param registo Record in the list
+ * @return Next record, or NULL at the end
+ */
+User* proximo_registo(User* registo);
 
 /**
- * @brief Hash table to track vaccinations performed on the current day
+ * @brief Frees one record and its name to their arena
+ * @param registo Record no longer in the list
  */
-typedef struct {
-    VaxHoje* table[HASH_SIZE];
-    int current_day;
-    int current_month;
-    int current_year;
-} HojeVaxTable;
+void libertar_user(void* registo);
 
 /**
- * @brief Creates a new hash table for tracking today's vaccinations
- * @param day Current day
- * @param month Current month
- * @param year Current year
- * @return Pointer to the newly created hash table
+ * @brief Unlinks the records deleted up to a version, to be freed later
+ * @param head Pointer to the head pointer of the user list
+ * @param ate Latest deletion version no reader can see anymore
+ * @param epocas Epochs the records are retired to
+ * @return Number of records unlinked
  */
-HojeVaxTable* criar_vax_table_hoje(int day, int month, int year);
+int recolher_apagados(User** head, unsigned long ate, Epocas* epocas);
 
 /**
- * @brief Frees all memory allocated for the today's vaccination hash table
- * @param table Pointer to the hash table
+ * @brief Last day a user received doses of one vaccine
  */
-void free_hoje_vax_table(HojeVaxTable* table);
+typedef struct UltimaDose {
+    const struct Vacina* vacina;  /**< Index entry of the vaccine */
+    Data ultimo_dia;              /**< Date of the latest application */
+    struct UltimaDose* next;      /**< Next vaccine given to the same user */
+} UltimaDose;
+
+/**
+ * @brief Index entry for one user
+ */
+typedef struct Utente {
+    char* nome;                   /**< User's name (dynamically allocated) */
+    UltimaDose* doses;            /**< Latest application of each vaccine */
+    unsigned int aplicacoes;      /**< Applications not deleted by d */
+    struct Utente* next;          /**< Pointer to next user in hash bucket */
+} Utente;
+
+/**
+ * @brief Hash table of every user that was ever vaccinated
+ *
+ * Answers whether a user already got a vaccine on the current date
+ * without keeping any per-day state. Entries stay after d deletes all
+ * of a user's applications, so num_utentes counts every user ever
+ * vaccinated and utentes_vivos those with applications on record.
+ */
+typedef struct IndiceUtentes {
+    Arena* arena;                 /**< Entries, names and doses */
+    Utente** table;               /**< Buckets of users hashed by name */
+    unsigned int capacidade;      /**< Number of buckets */
+    unsigned int num_utentes;     /**< Number of users in the index */
+    unsigned int utentes_vivos;   /**< Users with applications on record */
+    unsigned int maior_cadeia;    /**< Users in the longest bucket */
+} IndiceUtentes;
+
+/**
+ * @brief Creates an empty user index
+ * @return Pointer to the newly created index
+ */
+IndiceUtentes* criar_indice_utentes(void);
+
+/**
+ * @brief Frees all memory allocated for the user index
+ * @param indice Pointer to the index
+ */
+void free_indice_utentes(IndiceUtentes* indice);
 
 /**
  * @brief Checks if a user has been vaccinated today with a specific vaccine
- * @param table Pointer to the hash table
+ * @param indice Pointer to the user index
  * @param nome_user User's name
- * @param nome_vacina Name of the vaccine
+ * @param vacina Index entry of the vaccine (NULL if it has no batches)
+ * @param hoje Current date
  * @return 1 if the user was vaccinated today
  * with the given vaccine, 0 otherwise
  */
-int eh_vacinado_hoje(HojeVaxTable* table, char* nome_user, char* nome_vacina);
+int eh_vacinado_hoje(IndiceUtentes* indice, char* nome_user,
+                     const struct Vacina* vacina, Data hoje);
 
 /**
  * @brief Records a vaccination performed today
- * @param table Pointer to the hash table
+ * @param indice Pointer to the user index
+ * @param nome_user User's name
+ * @param vacina Index entry of the vaccine
+ * @param hoje Current date
+ */
+void recorde_vacinacao_hoje(IndiceUtentes* indice, char* nome_user,
+                            const struct Vacina* vacina, Data hoje);
+
+/**
+ * @brief Counts applications of a user that d deleted
+ * @param indice Pointer to the user index
  * @param nome_user User's name
- * @param nome_vacina Name of the vaccine
+ * @param n Number of applications deleted
  */
-void recorde_vacinacao_hoje(HojeVaxTable* table, char* nome_user,
-                           char* nome_vacina);
+void descontar_aplicacoes(IndiceUtentes* indice, const char* nome_user,
+                          int n);
 
 /**
- * @brief Resets the hash table if the current date has changed
- * @param table Pointer to the hash table
- * @param day New current day
- * @param month New current month
- * @param year New current year
+ * @brief Measures how evenly users are spread over the buckets
+ * @param indice Pointer to the user index
+ * @param ocupacao Output for the occupancy report
  */
-void reset_table_hoje(HojeVaxTable* table, int day, int month, int year);
+void ocupacao_indice_utentes(const IndiceUtentes* indice,
+                             OcupacaoHash* ocupacao);
 
-#endif
\ No newline at end of file
+#endif
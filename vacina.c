@@ -5,32 +5,16 @@
  */
 #include "vacina.h"
 
-/**
- * @brief Converts date components to a single integer representation
- * 
- * @param dia Day component of the date
- * @param mes Month component of the date
- * @param ano Year component of the date
- * @return Integer representation of the date
- * in format YYYYMMDD for easy comparison
- */
-int ddmmyy_int(int dia, int mes, int ano) {
-    return ano * 10000 + mes * 100 + dia;
-}
-
 /**
  * @brief Creates a new vaccine batch with the provided information
  * 
  * @param nome Name of the vaccine
  * @param lote Batch identifier
- * @param dia Expiration day
- * @param mes Expiration month
- * @param ano Expiration year
+ * @param validade Expiration date
  * @param dosas Number of available doses
  * @return Pointer to the newly created batch structure
  */
-LoteVacina* criar_lote(char* nome, char* lote, int dia, int mes,
-                      int ano, int dosas){
+LoteVacina* criar_lote(char* nome, char* lote, Data validade, int dosas){
     LoteVacina* novo_lote = (LoteVacina*)malloc(sizeof(LoteVacina));
 
     if (!novo_lote) {
@@ -40,12 +24,12 @@ LoteVacina* criar_lote(char* nome, char* lote, int dia, int mes,
 
     strcpy(novo_lote->nome, nome);
     strcpy(novo_lote->lote, lote);
-    novo_lote->dia_de_expiracao = dia;
-    novo_lote->mes_de_expiracao = mes;
-    novo_lote->ano_de_expiracao = ano;
+    novo_lote->data_expiracao = validade;
     novo_lote->dosas_disponiveis = dosas;
     novo_lote->total_aplicacoes = 0;
-    novo_lote->data_expiracao_int = ddmmyy_int(dia, mes, ano);
+    novo_lote->ativo = 0;
+    novo_lote->vacina = NULL;
+    novo_lote->proximo_ativo = NULL;
     novo_lote->next = NULL;
 
     return novo_lote; 
@@ -73,4 +57,387 @@ void free_lotes(LoteVacina* head) {
         current = current->next;       
         free(temp);                     
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Compares two batches for sorting
+ * 
+ * First by expiration date, then alphabetically by batch ID
+ * 
+ * @param lote_a First batch
+ * @param lote_b Second batch
+ * @return Negative if a<b, positive if a>b, 0 if equal
+ */
+int comparar_lotes(LoteVacina* lote_a, LoteVacina* lote_b) {
+    if (lote_a->data_expiracao != lote_b->data_expiracao) {
+        return lote_a->data_expiracao - lote_b->data_expiracao;
+    }
+    
+    return strcmp(lote_a->lote, lote_b->lote);
+}
+
+/**
+ * @brief Computes the bucket of a vaccine name
+ * @param nome Name of the vaccine
+ * @return Hash value in the range [0, HASH_VACINAS-1]
+ */
+static unsigned int hash_vacina(const char* nome) {
+    return hash_texto(nome) & (HASH_VACINAS - 1);
+}
+
+/**
+ * @brief Creates an empty batch index
+ * @return Pointer to the newly created index
+ */
+IndiceLotes* criar_indice_lotes(void) {
+    IndiceLotes* indice = (IndiceLotes*)calloc(1, sizeof(IndiceLotes));
+
+    if (!indice) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    return indice;
+}
+
+/**
+ * @brief Frees the index and its vaccine entries
+ * 
+ * Batches belong to the batch list and are freed by free_lotes.
+ * 
+ * @param indice Pointer to the index
+ */
+void free_indice_lotes(IndiceLotes* indice) {
+    int i;
+    if (!indice) return;
+
+    for (i = 0; i < HASH_VACINAS; i++) {
+        Vacina* current = indice->tabela[i];
+        while (current) {
+            Vacina* temp = current;
+            current = current->next;
+            free(temp);
+        }
+    }
+
+    free(indice);
+}
+
+/**
+ * @brief Finds the index entry of a vaccine
+ * @param indice Pointer to the index
+ * @param nome Name of the vaccine
+ * @return Pointer to the entry or NULL if no batch of it was ever created
+ */
+Vacina* procurar_vacina(IndiceLotes* indice, const char* nome) {
+    Vacina* current = indice->tabela[hash_vacina(nome)];
+
+    while (current) {
+        if (strcmp(current->nome, nome) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Finds or creates the index entry of a vaccine
+ * @param indice Pointer to the index
+ * @param nome Name of the vaccine
+ * @return Pointer to the entry
+ */
+static Vacina* obter_vacina(IndiceLotes* indice, const char* nome) {
+    unsigned int index;
+    Vacina* vacina = procurar_vacina(indice, nome);
+
+    if (vacina) {
+        return vacina;
+    }
+
+    vacina = (Vacina*)calloc(1, sizeof(Vacina));
+    if (!vacina) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    strcpy(vacina->nome, nome);
+    vacina->id = indice->num_vacinas++;
+    index = hash_vacina(nome);
+    vacina->next = indice->tabela[index];
+    indice->tabela[index] = vacina;
+
+    if (indice->ultima_vacina) {
+        indice->ultima_vacina->proxima_criada = vacina;
+    } else {
+        indice->primeira_vacina = vacina;
+    }
+    indice->ultima_vacina = vacina;
+
+    return vacina;
+}
+
+/**
+ * @brief Finds the schedule position of a batch, or where it would go
+ * @param indice Pointer to the index
+ * @param lote Batch to locate
+ * @return Index of the first scheduled batch not ordered before it
+ */
+static int posicao_calendario(IndiceLotes* indice, LoteVacina* lote) {
+    int e = 0, d = indice->num_lotes;
+
+    while (e < d) {
+        int m = e + (d - e) / 2;
+        if (comparar_lotes(indice->calendario[m], lote) < 0) {
+            e = m + 1;
+        } else {
+            d = m;
+        }
+    }
+
+    return e;
+}
+
+/**
+ * @brief Links a new batch to its vaccine and its active list
+ * 
+ * The batch joins its vaccine's active list ahead of any batch with the
+ * same expiry, so among equally old batches the newest one is used first.
+ * 
+ * @param indice Pointer to the index
+ * @param lote Batch to link
+ */
+static void ligar_lote(IndiceLotes* indice, LoteVacina* lote) {
+    Vacina* vacina = obter_vacina(indice, lote->nome);
+    LoteVacina** ligacao = &vacina->ativos;
+
+    lote->vacina = vacina;
+    if (lote->dosas_disponiveis <= 0) {
+        return;
+    }
+
+    while (*ligacao && (*ligacao)->data_expiracao < lote->data_expiracao) {
+        ligacao = &(*ligacao)->proximo_ativo;
+    }
+    lote->proximo_ativo = *ligacao;
+    *ligacao = lote;
+    lote->ativo = 1;
+    vacina->lotes_ativos++;
+    vacina->doses_disponiveis += lote->dosas_disponiveis;
+}
+
+/**
+ * @brief Adds a new, non-expired batch to the index
+ * @param indice Pointer to the index
+ * @param lote Batch to add
+ */
+void indexar_lote(IndiceLotes* indice, LoteVacina* lote) {
+    int pos = posicao_calendario(indice, lote);
+
+    memmove(&indice->calendario[pos + 1], &indice->calendario[pos],
+            (indice->num_lotes - pos) * sizeof(LoteVacina*));
+    indice->calendario[pos] = lote;
+    indice->num_lotes++;
+
+    ligar_lote(indice, lote);
+}
+
+/**
+ * @brief Sorts batches as comparar_lotes orders them (bottom-up mergesort)
+ * @param lotes Batches to sort
+ * @param auxiliar Scratch space for n batches
+ * @param n Number of batches
+ */
+static void ordenar_lotes(LoteVacina** lotes, LoteVacina** auxiliar, int n) {
+    int largura, e;
+
+    for (largura = 1; largura < n; largura *= 2) {
+        for (e = 0; e < n - largura; e += 2 * largura) {
+            int m = e + largura;
+            int d = m + largura < n ? m + largura : n;
+            int i = e, j = m, k = e;
+
+            while (i < m && j < d) {
+                if (comparar_lotes(lotes[i], lotes[j]) <= 0) {
+                    auxiliar[k++] = lotes[i++];
+                } else {
+                    auxiliar[k++] = lotes[j++];
+                }
+            }
+            while (i < m) auxiliar[k++] = lotes[i++];
+            while (j < d) auxiliar[k++] = lotes[j++];
+            memcpy(&lotes[e], &auxiliar[e], (d - e) * sizeof(LoteVacina*));
+        }
+    }
+}
+
+/**
+ * @brief Adds many new, non-expired batches to the index at once
+ * 
+ * Vaccines and active lists are updated batch by batch in creation
+ * order, which keeps the newest-first rule among equal expiries. The
+ * schedule is merged from its end, so every batch moves only once.
+ * 
+ * @param indice Pointer to the index
+ * @param lotes Batches to add, in creation order
+ * @param n Number of batches, with room for them in the schedule
+ */
+void indexar_lotes(IndiceLotes* indice, LoteVacina** lotes, int n) {
+    LoteVacina** ordenados;
+    int i, j, k;
+
+    if (n <= 0) {
+        return;
+    }
+
+    ordenados = (LoteVacina**)malloc(2 * n * sizeof(LoteVacina*));
+    if (!ordenados) {
+        printf("No memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++) {
+        ligar_lote(indice, lotes[i]);
+        ordenados[i] = lotes[i];
+    }
+    ordenar_lotes(ordenados, ordenados + n, n);
+
+    i = indice->num_lotes - 1;
+    j = n - 1;
+    k = indice->num_lotes + n - 1;
+    while (j >= 0) {
+        if (i >= 0 && comparar_lotes(indice->calendario[i], ordenados[j]) > 0) {
+            indice->calendario[k--] = indice->calendario[i--];
+        } else {
+            indice->calendario[k--] = ordenados[j--];
+        }
+    }
+    indice->num_lotes += n;
+
+    free(ordenados);
+}
+
+/**
+ * @brief Takes a batch out of its vaccine's active list
+ * 
+ * Exhausted and expired batches sit at the front of the list,
+ * so the search stops almost immediately for them. The doses the
+ * batch still has stop counting as available for its vaccine.
+ * 
+ * @param lote Batch that can no longer supply doses
+ */
+void desativar_lote(LoteVacina* lote) {
+    LoteVacina** ligacao;
+
+    if (!lote->ativo) {
+        return;
+    }
+
+    ligacao = &lote->vacina->ativos;
+    while (*ligacao != lote) {
+        ligacao = &(*ligacao)->proximo_ativo;
+    }
+    *ligacao = lote->proximo_ativo;
+    lote->proximo_ativo = NULL;
+    lote->ativo = 0;
+    lote->vacina->lotes_ativos--;
+    lote->vacina->doses_disponiveis -= lote->dosas_disponiveis;
+}
+
+/**
+ * @brief Removes a batch from the index before it is freed
+ * @param indice Pointer to the index
+ * @param lote Batch to remove
+ */
+void desindexar_lote(IndiceLotes* indice, LoteVacina* lote) {
+    int pos = posicao_calendario(indice, lote);
+
+    desativar_lote(lote);
+    memmove(&indice->calendario[pos], &indice->calendario[pos + 1],
+            (indice->num_lotes - pos - 1) * sizeof(LoteVacina*));
+    indice->num_lotes--;
+    if (pos < indice->expirados) {
+        indice->expirados--;
+    }
+}
+
+/**
+ * @brief Retires every batch that expired before the given date
+ * 
+ * Advances the expiry cursor over the schedule, so each batch is
+ * retired exactly once no matter how often time moves forward.
+ * 
+ * @param indice Pointer to the index
+ * @param hoje New current date
+ */
+void expirar_lotes(IndiceLotes* indice, Data hoje) {
+    while (indice->expirados < indice->num_lotes &&
+           indice->calendario[indice->expirados]->data_expiracao < hoje) {
+        desativar_lote(indice->calendario[indice->expirados]);
+        indice->expirados++;
+    }
+}
+
+/**
+ * @brief Measures how evenly vaccines are spread over the buckets
+ * @param indice Pointer to the index
+ * @param ocupacao Output for the occupancy report
+ */
+void ocupacao_indice_lotes(const IndiceLotes* indice, OcupacaoHash* ocupacao) {
+    int i;
+
+    memset(ocupacao, 0, sizeof(*ocupacao));
+    for (i = 0; i < HASH_VACINAS; i++) {
+        unsigned long cadeia = 0;
+        const Vacina* current;
+
+        for (current = indice->tabela[i]; current; current = current->next) {
+            cadeia++;
+        }
+        ocupacao_contar(ocupacao, cadeia);
+    }
+}
+
+/**
+ * @brief Empties a set of batch ids
+ * @param conjunto Set to empty
+ */
+void conjunto_lotes_limpar(ConjuntoLotes* conjunto) {
+    memset(conjunto->ids, 0, sizeof(conjunto->ids));
+}
+
+/**
+ * @brief Finds the slot of a batch id, or the free slot it would take
+ * @param conjunto Set to search
+ * @param id Batch id
+ * @return Slot index
+ */
+static unsigned int slot_conjunto(const ConjuntoLotes* conjunto,
+                                  const char* id) {
+    unsigned int slot = hash_texto(id) & (CONJUNTO_LOTES - 1);
+
+    while (conjunto->ids[slot] && strcmp(conjunto->ids[slot], id) != 0) {
+        slot = (slot + 1) & (CONJUNTO_LOTES - 1);
+    }
+    return slot;
+}
+
+/**
+ * @brief Checks if a batch id is in a set
+ * @param conjunto Set to search
+ * @param id Batch id
+ * @return 1 if present, 0 otherwise
+ */
+int conjunto_lotes_contem(const ConjuntoLotes* conjunto, const char* id) {
+    return conjunto->ids[slot_conjunto(conjunto, id)] != NULL;
+}
+
+/**
+ * @brief Adds a batch id that is not yet in a set
+ * @param conjunto Set with fewer than MAX_LOTES ids
+ * @param id Batch id, which must outlive the set
+ */
+void conjunto_lotes_inserir(ConjuntoLotes* conjunto, const char* id) {
+    conjunto->ids[slot_conjunto(conjunto, id)] = id;
+}
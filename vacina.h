@@ -12,6 +12,9 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "data.h"
+#include "hash.h"
+
 /**< Maximum number of vaccine batches that can be stored in the system */
 #define MAX_LOTES 1000
 
@@ -23,45 +26,84 @@
  *  that can be stored in the system as data*/
 #define MAX_NOME_LOTE 21
 
+/**< Size of hash table indexing vaccines by name (a power of two) */
+#define HASH_VACINAS 1024
+
+/**< Slots of a set of batch ids (a power of two above 2 * MAX_LOTES) */
+#define CONJUNTO_LOTES 2048
+
 /**
  * @brief Represents a vaccine batch
  */
 typedef struct LoteVacina {
     char nome[MAX_NOME];            /**< Name of the vaccine */
     char lote[MAX_NOME_LOTE];       /**< Batch identifier in hexadecimal */
-    int dia_de_expiracao;           /**< Expiration day */
-    int mes_de_expiracao;           /**< Expiration month */
-    int ano_de_expiracao;           /**< Expiration year */
+    Data data_expiracao;            /**< Expiration date */
     int dosas_disponiveis;          /**< Number of available doses */
     int total_aplicacoes;           /**< Number of applied doses */
+    int ativo;          /**< 1 while the batch can still supply doses */
+    struct Vacina* vacina;          /**< Index entry of the batch's vaccine */
 
-    /**< Integer representation of expiration date */
-    int data_expiracao_int;
+    /**< Next batch of the same vaccine that can still supply doses */
+    struct LoteVacina* proximo_ativo;
 
     struct LoteVacina* next;        /**< Pointer to next batch in linked list */
 } LoteVacina;
 
 /**
- * @brief Converts date components to a single integer representation
- * @param dia Day component of the date
- * @param mes Month component of the date
- * @param ano Year component of the date
- * @return Integer representation of the date in format YYYYMMDD
+ * @brief Index entry grouping the batches of one vaccine
+ */
+typedef struct Vacina {
+    char nome[MAX_NOME];            /**< Name of the vaccine */
+
+    /**< Batches with doses left and not expired, oldest expiry first */
+    LoteVacina* ativos;
+
+    int doses_disponiveis;          /**< Doses left in the active batches */
+    int doses_aplicadas;            /**< Applications still on record */
+    int lotes_ativos;               /**< Number of active batches */
+    int id;                         /**< Position in creation order */
+
+    struct Vacina* proxima_criada;  /**< Next vaccine in creation order */
+    struct Vacina* next;            /**< Pointer to next entry in hash bucket */
+} Vacina;
+
+/**
+ * @brief Dose-selection index and expiry schedule for all batches
+ *
+ * The schedule keeps every batch ordered as comparar_lotes does. Batches
+ * before the expiry cursor have already expired and were taken out of their
+ * vaccine's active list, so dose selection never sees them.
  */
-int ddmmyy_int(int dia, int mes, int ano);
+typedef struct IndiceLotes {
+    Vacina* tabela[HASH_VACINAS];   /**< Vaccines hashed by name */
+    Vacina* primeira_vacina;        /**< First vaccine ever created */
+    Vacina* ultima_vacina;          /**< Last vaccine ever created */
+    int num_vacinas;                /**< Number of vaccines ever created */
+    LoteVacina* calendario[MAX_LOTES]; /**< Batches ordered by expiry */
+    int num_lotes;                  /**< Number of batches in the schedule */
+    int expirados;                  /**< Number of expired batches */
+} IndiceLotes;
+
+/**
+ * @brief Set of batch ids, for at most MAX_LOTES batches
+ *
+ * Uses open addressing over a fixed table, so it needs no allocation
+ * and is never more than half full.
+ */
+typedef struct ConjuntoLotes {
+    const char* ids[CONJUNTO_LOTES];    /**< Ids in the set, or NULL */
+} ConjuntoLotes;
 
 /**
  * @brief Creates a new vaccine batch
  * @param nome Name of the vaccine
  * @param lote Batch identifier
- * @param dia Expiration day
- * @param mes Expiration month
- * @param ano Expiration year
+ * @param validade Expiration date
  * @param dosas Number of available doses
  * @return Pointer to the newly created batch
  */
-LoteVacina* criar_lote(char* nome, char* lote, int dia,
-                      int mes, int ano, int dosas);
+LoteVacina* criar_lote(char* nome, char* lote, Data validade, int dosas);
 
 /**
  * @brief Adds a new batch to the beginning of the linked list
@@ -76,4 +118,100 @@ void adicionar_lote(LoteVacina** head, LoteVacina* novo_lote);
  */
 void free_lotes(LoteVacina* head);
 
-#endif 
\ No newline at end of file
+/**
+ * @brief Compares two batches by expiration date and then batch ID
+ * @param lote_a First batch
+ * @param lote_b Second batch
+ * @return Negative if a<b, positive if a>b, 0 if equal
+ */
+int comparar_lotes(LoteVacina* lote_a, LoteVacina* lote_b);
+
+/**
+ * @brief Creates an empty batch index
+ * @return Pointer to the newly created index
+ */
+IndiceLotes* criar_indice_lotes(void);
+
+/**
+ * @brief Frees the index and its vaccine entries (batches are not freed)
+ * @param indice Pointer to the index
+ */
+void free_indice_lotes(IndiceLotes* indice);
+
+/**
+ * @brief Finds the index entry of a vaccine
+ * @param indice Pointer to the index
+ * @param nome Name of the vaccine
+ * @return Pointer to the entry or NULL if no batch of it was ever created
+ */
+Vacina* procurar_vacina(IndiceLotes* indice, const char* nome);
+
+/**
+ * @brief Adds a new, non-expired batch to the index
+ * @param indice Pointer to the index
+ * @param lote Batch to add
+ */
+void indexar_lote(IndiceLotes* indice, LoteVacina* lote);
+
+/**
+ * @brief Adds many new, non-expired batches to the index at once
+ *
+ * Leaves the index as indexar_lote would, called on each batch in
+ * order, but sorts the new batches once and merges them into the
+ * schedule instead of shifting it for every batch.
+ *
+ * @param indice Pointer to the index
+ * @param lotes Batches to add, in creation order
+ * @param n Number of batches, with room for them in the schedule
+ */
+void indexar_lotes(IndiceLotes* indice, LoteVacina** lotes, int n);
+
+/**
+ * @brief Removes a batch from the index before it is freed
+ * @param indice Pointer to the index
+ * @param lote Batch to remove
+ */
+void desindexar_lote(IndiceLotes* indice, LoteVacina* lote);
+
+/**
+ * @brief Takes a batch out of its vaccine's active list
+ * @param lote Batch that can no longer supply doses
+ */
+void desativar_lote(LoteVacina* lote);
+
+/**
+ * @brief Retires every batch that expired before the given date
+ * @param indice Pointer to the index
+ * @param hoje New current date
+ */
+void expirar_lotes(IndiceLotes* indice, Data hoje);
+
+/**
+ * @brief Measures how evenly vaccines are spread over the buckets
+ * @param indice Pointer to the index
+ * @param ocupacao Output for the occupancy report
+ */
+void ocupacao_indice_lotes(const IndiceLotes* indice, OcupacaoHash* ocupacao);
+
+/**
+ * @brief Empties a set of batch ids
+ * @param conjunto Set to empty
+ */
+void conjunto_lotes_limpar(ConjuntoLotes* conjunto);
+
+/**
+ * @brief Checks if a batch id is in a set
+ * @param conjunto Set to search
+ * @param id Batch id
+ * @return 1 if present, 0 otherwise
+ */
+int conjunto_lotes_contem(const ConjuntoLotes* conjunto, const char* id);
+
+/**
+ * @brief Adds a batch id that is not yet in a set
+ * @param conjunto Set with fewer than MAX_LOTES ids
+ * @param id Batch id, which must outlive the set
+ */
+void conjunto_lotes_inserir(ConjuntoLotes* conjunto, const char* id);
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file varrer.c
+ * @brief Scans of command arguments 32 or 16 bytes at a time
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * The default build only targets SSE2, so the AVX2 loops are compiled
+ * for that instruction set alone and only run on processors that have
+ * it. A text shorter than a block is compared a word of 8 bytes at a
+ * time, or byte by byte, and the last block of a longer one ends at
+ * its end, overlapping the one before, so no byte past it is read.
+ */
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <string.h>
+
+#include "varrer.h"
+
+#if defined(__SSE2__)
+/**< Compiles a function for AVX2, whatever the build targets */
+#define VARRER_AVX2 __attribute__((target("avx2")))
+
+/**< One in every byte of a word */
+#define VARRER_UNS 0x0101010101010101ULL
+
+/**< High bit of every byte of a word */
+#define VARRER_ALTOS 0x8080808080808080ULL
+
+/**
+ * @brief Tells if the processor runs AVX2 instructions
+ * @return Non-zero if it does
+ */
+static int tem_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+/**
+ * @brief Looks for a byte in one block of 32
+ * @param p First byte of the block
+ * @param alvo The byte, in every lane
+ * @return Pointer to the byte, or NULL if the block does not have it
+ */
+static inline VARRER_AVX2 char* bloco_avx2(const char* p, __m256i alvo) {
+    unsigned int iguais = (unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), alvo));
+
+    return iguais ? (char*)p + __builtin_ctz(iguais) : NULL;
+}
+
+/**
+ * @brief Looks for a byte 32 bytes at a time
+ *
+ * Four blocks are compared per iteration and only searched one by one
+ * when one of them has the byte. The last block ends at fim and may
+ * overlap bytes already compared, which do not have it.
+ *
+ * @param p First byte of the text, at least 32 bytes long
+ * @param fim Byte after the last one of the text
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if the text does not have it
+ */
+static VARRER_AVX2 char* byte_avx2(const char* p, const char* fim, char c) {
+    __m256i alvo = _mm256_set1_epi8(c);
+    char* achado;
+
+    for (; fim - p >= 128; p += 128) {
+        __m256i a = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)p), alvo);
+        __m256i b = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(p + 32)), alvo);
+        __m256i d = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(p + 64)), alvo);
+        __m256i e = _mm256_cmpeq_epi8(
+            _mm256_loadu_si256((const __m256i*)(p + 96)), alvo);
+        __m256i algum = _mm256_or_si256(_mm256_or_si256(a, b),
+                                         _mm256_or_si256(d, e));
+
+        if (!_mm256_testz_si256(algum, algum)) break;
+    }
+    for (; fim - p >= 32; p += 32) {
+        if ((achado = bloco_avx2(p, alvo)) != NULL) return achado;
+    }
+    return p < fim ? bloco_avx2(fim - 32, alvo) : NULL;
+}
+
+/**
+ * @brief Looks for a byte in one block of 16
+ * @param p First byte of the block
+ * @param alvo The byte, in every lane
+ * @return Pointer to the byte, or NULL if the block does not have it
+ */
+static inline char* bloco_sse2(const char* p, __m128i alvo) {
+    unsigned int iguais = (unsigned int)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), alvo));
+
+    return iguais ? (char*)p + __builtin_ctz(iguais) : NULL;
+}
+
+/**
+ * @brief Looks for a byte 16 bytes at a time
+ * @param p First byte of the text, at least 16 bytes long
+ * @param fim Byte after the last one of the text
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if the text does not have it
+ */
+static char* byte_sse2(const char* p, const char* fim, char c) {
+    __m128i alvo = _mm_set1_epi8(c);
+    char* achado;
+
+    for (; fim - p >= 16; p += 16) {
+        if ((achado = bloco_sse2(p, alvo)) != NULL) return achado;
+    }
+    return p < fim ? bloco_sse2(fim - 16, alvo) : NULL;
+}
+
+/**
+ * @brief Looks for a byte in one word of 8
+ *
+ * A byte equal to c becomes zero after the xor; the usual test for a
+ * zero byte may also mark bytes after it, never before, so the lowest
+ * mark is exact.
+ *
+ * @param p First byte of the word
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if the word does not have it
+ */
+static inline char* palavra_byte(const char* p, char c) {
+    unsigned long long v;
+
+    memcpy(&v, p, sizeof(v));
+    v ^= VARRER_UNS * (unsigned char)c;
+    v = (v - VARRER_UNS) & ~v & VARRER_ALTOS;
+    return v ? (char*)p + __builtin_ctzll(v) / 8 : NULL;
+}
+
+/**
+ * @brief Checks that one block of 32 only has uppercase hex digits
+ *
+ * Comparisons are signed, so bytes above 127 fall below '0' and are
+ * rejected like any other.
+ *
+ * @param p First byte of the block
+ * @return 1 if it does, 0 otherwise
+ */
+static inline VARRER_AVX2 int bloco_hex_avx2(const char* p) {
+    __m256i bloco = _mm256_loadu_si256((const __m256i*)p);
+    __m256i digito = _mm256_and_si256(
+        _mm256_cmpgt_epi8(bloco, _mm256_set1_epi8('0' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bloco));
+    __m256i letra = _mm256_and_si256(
+        _mm256_cmpgt_epi8(bloco, _mm256_set1_epi8('A' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('F' + 1), bloco));
+
+    return (unsigned int)_mm256_movemask_epi8(
+        _mm256_or_si256(digito, letra)) == 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Checks 32 bytes at a time that a text only has hex digits
+ * @param p First byte of the text, at least 32 bytes long
+ * @param fim Byte after the last one of the text
+ * @return 1 if it does, 0 otherwise
+ */
+static VARRER_AVX2 int hex_avx2(const char* p, const char* fim) {
+    for (; fim - p >= 32; p += 32) {
+        if (!bloco_hex_avx2(p)) return 0;
+    }
+    return p == fim || bloco_hex_avx2(fim - 32);
+}
+
+/**
+ * @brief Checks that one block of 16 only has uppercase hex digits
+ * @param p First byte of the block
+ * @return 1 if it does, 0 otherwise
+ */
+static inline int bloco_hex_sse2(const char* p) {
+    __m128i bloco = _mm_loadu_si128((const __m128i*)p);
+    __m128i digito = _mm_and_si128(
+        _mm_cmpgt_epi8(bloco, _mm_set1_epi8('0' - 1)),
+        _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), bloco));
+    __m128i letra = _mm_and_si128(
+        _mm_cmpgt_epi8(bloco, _mm_set1_epi8('A' - 1)),
+        _mm_cmpgt_epi8(_mm_set1_epi8('F' + 1), bloco));
+
+    return _mm_movemask_epi8(_mm_or_si128(digito, letra)) == 0xFFFF;
+}
+
+/**
+ * @brief Checks 16 bytes at a time that a text only has hex digits
+ * @param p First byte of the text, at least 16 bytes long
+ * @param fim Byte after the last one of the text
+ * @return 1 if it does, 0 otherwise
+ */
+static int hex_sse2(const char* p, const char* fim) {
+    for (; fim - p >= 16; p += 16) {
+        if (!bloco_hex_sse2(p)) return 0;
+    }
+    return p == fim || bloco_hex_sse2(fim - 16);
+}
+#endif
+
+/**
+ * @brief Finds the first occurrence of a byte
+ *
+ * The lowest set bit of a block's comparison gives the position. Like
+ * strchr, the result is not const, so callers can keep parsing the
+ * text through it.
+ *
+ * @param inicio First byte of the text
+ * @param fim Byte after the last one of the text
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if the text does not have it
+ */
+char* varrer_byte(const char* inicio, const char* fim, char c) {
+    const char* p = inicio;
+
+#if defined(__SSE2__)
+    if (fim - p >= 32 && tem_avx2()) {
+        return byte_avx2(p, fim, c);
+    } else if (fim - p >= 16) {
+        return byte_sse2(p, fim, c);
+    } else if (fim - p >= 8) {
+        char* achado = palavra_byte(p, c);
+
+        return achado ? achado : palavra_byte(fim - 8, c);
+    }
+#endif
+    for (; p < fim; p++) {
+        if (*p == c) return (char*)p;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Checks that a text only has uppercase hex digits (0-9, A-F)
+ * @param inicio First byte of the text
+ * @param fim Byte after the last one of the text
+ * @return 1 if every byte is one, 0 otherwise
+ */
+int varrer_hex(const char* inicio, const char* fim) {
+    const char* p = inicio;
+
+#if defined(__SSE2__)
+    if (fim - p >= 32 && tem_avx2()) {
+        return hex_avx2(p, fim);
+    } else if (fim - p >= 16) {
+        return hex_sse2(p, fim);
+    }
+#endif
+    for (; p < fim; p++) {
+        if ((unsigned char)(*p - '0') > 9 &&
+            (unsigned char)(*p - 'A') > 5) {
+            return 0;
+        }
+    }
+    return 1;
+}
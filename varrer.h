@@ -0,0 +1,31 @@
+/**
+ * @file varrer.h
+ * @brief Scans of command arguments many bytes at a time
+ * @author ist1113656 (Taha Adar Ozsoy)
+ *
+ * The parsers of a, d, u and c look for the quote or space ending a
+ * name and check batch ids with these. Both scans take the end of the
+ * text, so they never read past it. On x86-64 they use AVX2 when the
+ * processor has it and SSE2 otherwise; elsewhere they go byte by byte.
+ */
+#ifndef VARRER_H
+#define VARRER_H
+
+/**
+ * @brief Finds the first occurrence of a byte
+ * @param inicio First byte of the text
+ * @param fim Byte after the last one of the text
+ * @param c Byte to find
+ * @return Pointer to the byte, or NULL if the text does not have it
+ */
+char* varrer_byte(const char* inicio, const char* fim, char c);
+
+/**
+ * @brief Checks that a text only has uppercase hex digits (0-9, A-F)
+ * @param inicio First byte of the text
+ * @param fim Byte after the last one of the text
+ * @return 1 if every byte is one, 0 otherwise
+ */
+int varrer_hex(const char* inicio, const char* fim);
+
+#endif